@@ -0,0 +1,44 @@
+#include <pch.h>
+#include "AssetRegistry.h"
+#include "Painter/TextPainter.h"
+#include "Texture/TextureCache.h"
+#include "Utility/MappedFile.h"
+
+namespace game
+{
+std::vector<AssetRegistry::AssetInfo> AssetRegistry::Assets() const
+{
+    std::scoped_lock lock{ m_mutex };
+    std::vector<AssetInfo> assets;
+    assets.reserve(m_recordsByPath.size());
+    for (auto const& [key, record] : m_recordsByPath)
+    {
+        // Leave out the references held by the registry itself
+        auto const isSharingContent{ std::ranges::any_of(m_recordsBySize,
+            [&record](auto const& entry) { return entry.second == record; }) };
+        auto const referenceCount{ static_cast<size_t>(record.use_count()) -
+            (isSharingContent ? 2 : 1) };
+        assets.push_back(AssetInfo{ record->Path, std::get<1>(key), referenceCount,
+            record->IsLoaded() });
+    }
+    return assets;
+}
+
+bool AssetRegistry::HaveSameContents(std::filesystem::path const& a,
+    std::filesystem::path const& b)
+{
+    auto const first{ MappedFile::Open(a) };
+    auto const second{ MappedFile::Open(b) };
+    return first && second && std::ranges::equal(first->Bytes(), second->Bytes());
+}
+
+std::shared_ptr<PngTexture> AssetLoader<PngTexture>::Load(std::filesystem::path const& path)
+{
+    return LoadCookedTexture(path);
+}
+
+std::shared_ptr<TextPainter> AssetLoader<TextPainter>::Load(std::filesystem::path const& path)
+{
+    return TextPainter::FromBitmapFont(path);
+}
+}
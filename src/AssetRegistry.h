@@ -0,0 +1,226 @@
+#pragma once
+#include <map>
+#include <typeindex>
+#include "Utility/ThreadPool.h"
+
+struct PngTexture;
+
+namespace game
+{
+struct TextPainter;
+
+// What the registry keeps for each asset it has been asked for, whatever its type
+struct AssetRecordBase
+{
+    explicit AssetRecordBase(std::filesystem::path path) : Path{ std::move(path) } { }
+    virtual ~AssetRecordBase() = default;
+
+    virtual bool IsLoaded() const = 0;
+
+    std::filesystem::path const Path;
+};
+
+template<typename T>
+struct AssetRecord : AssetRecordBase
+{
+    using AssetRecordBase::AssetRecordBase;
+
+    bool IsLoaded() const override
+    {
+        return Asset.wait_for(std::chrono::seconds{ 0 }) == std::future_status::ready;
+    }
+
+    std::shared_future<std::shared_ptr<T>> Asset;
+};
+
+// A cheap, copyable reference to an asset that may still be loading. The registry keeps every
+// asset it has loaded for its own lifetime, whether or not any handle to it is still held.
+template<typename T>
+struct AssetHandle
+{
+    AssetHandle() = default;
+    explicit AssetHandle(std::shared_ptr<AssetRecord<T> const> record) :
+        m_record{ std::move(record) }
+    { }
+
+    explicit operator bool() const
+    {
+        return m_record != nullptr;
+    }
+
+    bool IsLoaded() const
+    {
+        return m_record && m_record->IsLoaded();
+    }
+
+    // Waits for the asset if it is still loading
+    std::shared_ptr<T> const& Get() const
+    {
+        return m_record->Asset.get();
+    }
+
+    std::shared_future<std::shared_ptr<T>> const& Future() const
+    {
+        return m_record->Asset;
+    }
+
+    std::filesystem::path const& Path() const
+    {
+        return m_record->Path;
+    }
+
+private:
+    std::shared_ptr<AssetRecord<T> const> m_record;
+};
+
+// Where assets of a type come from, when they are loaded straight from a file of their own
+template<typename T>
+struct AssetLoader;
+
+// Loads assets by path, each only once however often it is asked for. Files with the same
+// contents under different paths also share one asset; a file is only compared, byte for
+// byte, with files of the same size already loaded. Loads run on the thread pool, if there
+// is one, and on the calling thread otherwise.
+struct AssetRegistry
+{
+    // Snapshot of one registered asset
+    struct AssetInfo
+    {
+        std::filesystem::path Path;
+        std::type_index Type;
+        // Handles held outside the registry
+        size_t ReferenceCount;
+        bool IsLoaded;
+    };
+
+    explicit AssetRegistry(ThreadPool* threadPool) : m_threadPool{ threadPool } { }
+
+    AssetRegistry(AssetRegistry const&) = delete;
+    AssetRegistry& operator=(AssetRegistry const&) = delete;
+
+    template<typename T>
+    AssetHandle<T> Load(std::filesystem::path const& path)
+    {
+        return Load<T>(path, [](std::filesystem::path const& file)
+            {
+                return AssetLoader<T>::Load(file);
+            });
+    }
+
+    // As above, for assets built by load(path) rather than by AssetLoader. Loads of the same
+    // path, type and variant are expected to build the same asset, so only the first load is
+    // run. Assets built from one file in different ways, such as a mesh with different
+    // textures, must be given different variants, or they would be shared.
+    // A load that needs other assets should ask for them before calling this, so they are
+    // queued ahead of it and it can't end up waiting on work queued behind it.
+    template<typename T, typename F>
+    AssetHandle<T> Load(std::filesystem::path const& path, F&& load,
+        std::string const& variant = {})
+    {
+        PathKey key{ path.lexically_normal().string(), std::type_index{ typeid(T) }, variant };
+        std::scoped_lock lock{ m_mutex };
+        if (auto const found{ m_recordsByPath.find(key) }; found != m_recordsByPath.end())
+        {
+            return AssetHandle<T>{
+                std::static_pointer_cast<AssetRecord<T> const>(found->second) };
+        }
+        auto const record{ std::make_shared<AssetRecord<T>>(path) };
+        auto loadShared{ [this, key, path, load{ std::forward<F>(load) }]()
+            -> std::shared_ptr<T>
+            {
+                if (auto const original{ FindOrAddContent<T>(key, path) })
+                {
+                    SPDLOG_INFO("'{}' has the same contents as '{}', sharing it",
+                        path.string(), original->Path.string());
+                    return original->Asset.get();
+                }
+                return load(path);
+            } };
+        if (m_threadPool)
+        {
+            record->Asset = m_threadPool->Enqueue(std::move(loadShared)).share();
+        }
+        else
+        {
+            record->Asset = std::async(std::launch::deferred, std::move(loadShared)).share();
+        }
+        m_recordsByPath.emplace(key, record);
+        return AssetHandle<T>{ record };
+    }
+
+    std::vector<AssetInfo> Assets() const;
+
+private:
+    // Normalized path, type and variant
+    using PathKey = std::tuple<std::string, std::type_index, std::string>;
+    // File size, type and variant
+    using ContentKey = std::tuple<uintmax_t, std::type_index, std::string>;
+
+    ThreadPool* const m_threadPool;
+    mutable std::mutex m_mutex;
+    std::map<PathKey, std::shared_ptr<AssetRecordBase>> m_recordsByPath;
+    // Assets whose contents others may share, by the size of the file they were loaded from
+    std::multimap<ContentKey, std::shared_ptr<AssetRecordBase>> m_recordsBySize;
+
+    static bool HaveSameContents(std::filesystem::path const& a, std::filesystem::path const& b);
+
+    // Returns the record of an asset of the same type and variant already loaded from a file
+    // with the same contents, or registers the asset at path as the one to share them,
+    // returning nullptr. Files that couldn't be read are never shared.
+    // Files are compared without holding the lock, so other loads aren't held up by it. Files
+    // registered meanwhile are compared on the next pass, before this one is registered.
+    template<typename T>
+    std::shared_ptr<AssetRecord<T> const> FindOrAddContent(PathKey const& key,
+        std::filesystem::path const& path)
+    {
+        std::error_code error;
+        auto const size{ std::filesystem::file_size(path, error) };
+        if (error)
+        {
+            return nullptr;
+        }
+        ContentKey contentKey{ size, std::get<1>(key), std::get<2>(key) };
+        std::vector<std::shared_ptr<AssetRecordBase>> compared;
+        while (true)
+        {
+            std::vector<std::shared_ptr<AssetRecordBase>> candidates;
+            {
+                std::scoped_lock lock{ m_mutex };
+                auto const [first, last]{ m_recordsBySize.equal_range(contentKey) };
+                for (auto candidate{ first }; candidate != last; ++candidate)
+                {
+                    if (std::ranges::find(compared, candidate->second) == compared.end())
+                    {
+                        candidates.push_back(candidate->second);
+                    }
+                }
+                if (candidates.empty())
+                {
+                    m_recordsBySize.emplace(std::move(contentKey), m_recordsByPath.at(key));
+                    return nullptr;
+                }
+            }
+            for (auto const& candidate : candidates)
+            {
+                if (HaveSameContents(path, candidate->Path))
+                {
+                    return std::static_pointer_cast<AssetRecord<T> const>(candidate);
+                }
+                compared.push_back(candidate);
+            }
+        }
+    }
+};
+
+template<>
+struct AssetLoader<PngTexture>
+{
+    static std::shared_ptr<PngTexture> Load(std::filesystem::path const& path);
+};
+
+template<>
+struct AssetLoader<TextPainter>
+{
+    static std::shared_ptr<TextPainter> Load(std::filesystem::path const& path);
+};
+}
@@ -1,10 +1,17 @@
 #include <pch.h>
 #include "Configuration.h"
 
-Configuration::Configuration() : m_videoConfiguration{ 640, 360, true }
+Configuration::Configuration() :
+    m_videoConfiguration{ 640, 360, true, 0, RenderMode::Forward, 1.0f, 16384 },
+    m_streamingConfiguration{ 16 * 1024 * 1024 }
 { }
 
 VideoConfiguration Configuration::GetVideoConfiguration()
 {
     return m_videoConfiguration;
+}
+
+StreamingConfiguration Configuration::GetStreamingConfiguration()
+{
+    return m_streamingConfiguration;
 }
\ No newline at end of file
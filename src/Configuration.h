@@ -1,16 +1,45 @@
 #pragma once
 
+enum class RenderMode
+{
+    // Texture each pixel as soon as it passes the depth test
+    Forward,
+    // Rasterize depth and triangle IDs only, then texture each visible pixel once
+    VisibilityBuffer,
+};
+
 struct VideoConfiguration
 {
     uint16_t Width;
     uint16_t Height;
     bool IsFullscreen;
+    // Number of threads used to rasterize each frame. 0 picks one per hardware thread,
+    // 1 draws everything on the render thread without tile binning.
+    uint16_t RenderThreadCount;
+    RenderMode Mode;
+    // Largest error, in pixels, that a simplified level of detail of a mesh may put on
+    // screen before a finer one is drawn instead
+    float LevelOfDetailPixelError;
+    // Most triangles to draw in a frame. Past it, meshes are drawn at coarser levels of detail
+    // than the pixel error allows, those that put the least error on screen first. 0 for no
+    // limit.
+    uint32_t TriangleBudget;
+};
+
+struct StreamingConfiguration
+{
+    // Bytes of mesh levels of detail finer than the coarsest that may stay resident. The
+    // coarsest level of every mesh is always resident on top of this, as are textures,
+    // which aren't streamed.
+    size_t MeshMemoryBudget;
 };
 
 struct Configuration
 {
     Configuration();
     VideoConfiguration GetVideoConfiguration();
+    StreamingConfiguration GetStreamingConfiguration();
 private:
     VideoConfiguration m_videoConfiguration;
+    StreamingConfiguration m_streamingConfiguration;
 };
\ No newline at end of file
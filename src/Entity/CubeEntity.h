@@ -1,14 +1,16 @@
 #pragma once
 #include "Entity.h"
 #include "../Mesh/Mesh.h"
+#include "../ResourceManager.h"
 
 struct CubeEntity : public Entity
 {
     CubeEntity()
     {
-        //m_meshes.push_back(Mesh::FromObjFile("cube.obj", "cube.png"));
-        m_meshes.push_back(Mesh::FromObjFile("f22.obj", "f22.png"));
-        //m_meshes.push_back(Mesh::AdjoiningTriangles());
+        //m_meshes.push_back(game::ResourceManager::LoadMesh("cube.obj", "cube.png").Get());
+        m_meshes.push_back(m_mesh.Get());
+        //m_meshes.push_back(Mesh::AdjoiningTriangles(
+        //    game::ResourceManager::LoadTexture("cube.png").Get()));
         //m_position.z() = 5.0f;
         //m_rotation.x() = static_cast<float>(M_PI);
     }
@@ -19,4 +21,10 @@ struct CubeEntity : public Entity
         // m_rotation.y() += 0.000001f * deltaTime.count();
         // m_rotation.x() += 0.000001f * deltaTime.count();
     }
+
+private:
+    // Held for as long as the entity lives, so the registry counts it as in use. Asked for in
+    // the format the resource manager loads it in, so the two share it.
+    game::AssetHandle<Mesh> const m_mesh{ game::ResourceManager::LoadMesh("f22.obj", "f22.png",
+        PngTexture::Format::Palettized) };
 };
\ No newline at end of file
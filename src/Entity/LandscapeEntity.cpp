@@ -6,5 +6,10 @@ LandscapeEntity::LandscapeEntity()
 {
     m_position.y() = 2.0f;
     //m_rotation.x() = static_cast<float>(M_PI);
-    m_meshes.push_back(game::ResourceManager::GetMesh(game::MeshResourceKind::SandyLandscape));
+    // Add the landscape in chunks so the parts outside the view can be culled
+    for (auto const& chunk : game::ResourceManager::GetMeshChunks(
+        game::MeshResourceKind::SandyLandscape))
+    {
+        m_meshes.push_back(chunk);
+    }
 }
@@ -18,6 +18,7 @@ try // Don't catch unhandled exceptions for debug builds
     SPDLOG_DEBUG("Debug logging enabled");
 #endif
     SPDLOG_INFO("Entrypoint");
+    auto const startTime{ std::chrono::steady_clock::now() };
 
     for (const auto& argPair : arguments)
     {
@@ -31,11 +32,14 @@ try // Don't catch unhandled exceptions for debug builds
     // Initialize subsystems in their own scope so we can perform additional
     // cleanup after they are destructed.
     {
-        game::ResourceManager::Initialize();
-        Simulation simulation{};
+        // Resources load on worker threads while the window and renderer are set up, and
+        // whatever uses one first waits for it
+        game::ResourceManager::Initialize(configuration.GetStreamingConfiguration());
         Display display{ resolution };
         game::Renderer renderer{ display.GetWindow(), resolution };
+        renderer.SetMeshStreamer(&game::ResourceManager::GetMeshStreamer());
         Input input{};
+        Simulation simulation{};
 
 #ifdef DEBUG
         renderer.AddOverlay(std::make_shared<game::DebugOverlay>());
@@ -43,6 +47,7 @@ try // Don't catch unhandled exceptions for debug builds
 
         // Run sim loop
         SPDLOG_INFO("Begin sim loop");
+        bool isFirstFrame{ true };
         while (true)
         {
             // Get input
@@ -58,9 +63,16 @@ try // Don't catch unhandled exceptions for debug builds
 
             // Render
             renderer.Render(simulationState);
+            if (std::exchange(isFirstFrame, false))
+            {
+                SPDLOG_INFO("First frame rendered {} ms after startup",
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - startTime).count());
+            }
         }
         SPDLOG_INFO("End sim loop, destruct subsystems");
     }
+    game::ResourceManager::Shutdown();
 
     SPDLOG_INFO("Exit");
     return 0;
@@ -69,6 +81,8 @@ try // Don't catch unhandled exceptions for debug builds
 catch (std::exception const& e)
 {
     SPDLOG_CRITICAL("!!! Unhandled Exception: {}", e.what());
+    // Loads still running would otherwise outlive the logger
+    game::ResourceManager::Shutdown();
     // Shut down logger to make sure all messages are flushed before the process
     // is terminated.
     spdlog::shutdown();
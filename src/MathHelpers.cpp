@@ -70,6 +70,25 @@ float CrossProduct2D(Eigen::Vector2f const& a, Eigen::Vector2f const& b)
     return a.x() * b.y() - a.y() * b.x();
 }
 
+BoundingSphere MergeBoundingSpheres(BoundingSphere const& a, BoundingSphere const& b)
+{
+    Eigen::Vector3f const offset{ b.Center - a.Center };
+    float const distance{ offset.norm() };
+    if ((distance + b.Radius) <= a.Radius)
+    {
+        return a;
+    }
+    if ((distance + a.Radius) <= b.Radius)
+    {
+        return b;
+    }
+    float const radius{ (distance + a.Radius + b.Radius) / 2.0f };
+    return BoundingSphere{
+        .Center = a.Center + (offset * ((radius - a.Radius) / distance)),
+        .Radius = radius,
+    };
+}
+
 std::optional<Eigen::Vector3f> LinePlaneIntersect(Plane const& plane,
     Eigen::Vector3f const& lineStart, Eigen::Vector3f const& lineEnd)
 {
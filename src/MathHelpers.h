@@ -31,10 +31,17 @@ struct fmt::formatter<
 
 namespace game
 {
+// Clipping a triangle against a plane adds at most one vertex, so a triangle clipped by
+// six planes never has more than this many.
+constexpr size_t c_maxPolygonVertices{ 9 };
+
+// Convex polygon in homogeneous clip space with fixed-capacity storage, so clipping never
+// touches the heap
 struct Polygon
 {
-    std::vector<Eigen::Vector3f> Vertices;
-    std::vector<Eigen::Vector2f> TextureCoordinates;
+    std::array<Eigen::Vector4f, c_maxPolygonVertices> Vertices;
+    std::array<Eigen::Vector2f, c_maxPolygonVertices> TextureCoordinates;
+    size_t VertexCount;
 };
 
 struct Plane
@@ -43,10 +50,10 @@ struct Plane
     Eigen::Vector3f Normal;
 };
 
-struct Triangle
+struct BoundingSphere
 {
-    std::array<Eigen::Vector3f, 3> Vertices;
-    std::array<Eigen::Vector2f, 3> TextureCoordinates;
+    Eigen::Vector3f Center;
+    float Radius;
 };
 
 Eigen::Matrix4f PerspectiveProjectionTransformMatrix(float const& fieldOfViewRadians,
@@ -61,6 +68,9 @@ Eigen::Matrix4f Rotation(Eigen::Vector3f rotation);
 
 float CrossProduct2D(Eigen::Vector2f const& a, Eigen::Vector2f const& b);
 
+// Smallest sphere enclosing both spheres
+BoundingSphere MergeBoundingSpheres(BoundingSphere const& a, BoundingSphere const& b);
+
 constexpr float Lerp(float const& a, float const& b, float const& t)
 {
     return a + t * (b - a);
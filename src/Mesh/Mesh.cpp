@@ -1,17 +1,41 @@
 #include <pch.h>
+#include <thread>
 #include "Mesh.h"
+#include "ObjParser.h"
+#include "../Texture/TextureCache.h"
+#include "../Utility/MappedFile.h"
 
 namespace
 {
     constexpr size_t c_verticesPerFace{ 3 };
-    constexpr std::array<uint32_t, 6> c_faceColors{
-        0xFFFF0000,
-        0xFF00FF00,
-        0xFF0000FF,
-        0xFFFFFF00,
-        0xFFFF00FF,
-        0xFF00FFFF,
-    };
+    // OBJ files are only split over threads in ranges of at least this many bytes, below
+    // which starting the threads costs more than they save
+    constexpr size_t c_minimumBytesPerParseThread{ 256 * 1024 };
+}
+
+MeshBounds MeshBounds::FromVertices(std::vector<Eigen::Vector3f> const& vertices)
+{
+    if (vertices.empty())
+    {
+        return MeshBounds{ Eigen::Vector3f::Zero(), Eigen::Vector3f::Zero(),
+            game::BoundingSphere{ Eigen::Vector3f::Zero(), 0.0f } };
+    }
+    Eigen::Vector3f min{ vertices.front() };
+    Eigen::Vector3f max{ vertices.front() };
+    for (auto const& vertex : vertices)
+    {
+        min = min.cwiseMin(vertex);
+        max = max.cwiseMax(vertex);
+    }
+    // Centering the sphere on the box is not quite minimal, but measuring the radius from
+    // the vertices keeps it much tighter than the box's corners would.
+    Eigen::Vector3f const center{ (min + max) / 2.0f };
+    float radiusSquared{ 0.0f };
+    for (auto const& vertex : vertices)
+    {
+        radiusSquared = std::max(radiusSquared, (vertex - center).squaredNorm());
+    }
+    return MeshBounds{ min, max, game::BoundingSphere{ center, std::sqrt(radiusSquared) } };
 }
 
 std::shared_ptr<Mesh> Mesh::FromObjFile(std::filesystem::path objFilePath,
@@ -23,101 +47,136 @@ std::shared_ptr<Mesh> Mesh::FromObjFile(std::filesystem::path objFilePath,
         SPDLOG_ERROR("OBJ file '{}' does not exist", objFilePath.string());
         return nullptr;
     }
-    std::ifstream objFile{ objFilePath, std::ios::in };
-    if (!objFile.is_open())
+    auto const objFile{ game::MappedFile::Open(objFilePath) };
+    if (!objFile)
     {
         SPDLOG_ERROR("Could not open OBJ file '{}' for reading", objFilePath.string());
         return nullptr;
     }
-
-    std::vector<Eigen::Vector3f> vertices;
-    std::vector<Eigen::Vector2f> textureCoordinates;
-    std::vector<MeshFace> faces;
-    std::string line;
-    while (std::getline(objFile, line))
+    auto const bytes{ objFile->Bytes() };
+    size_t const threadCount{ std::clamp<size_t>(bytes.size() / c_minimumBytesPerParseThread,
+        1, std::max(std::thread::hardware_concurrency(), 1u)) };
+    auto geometry{ game::ParseObj(
+        std::string_view{ reinterpret_cast<char const*>(bytes.data()), bytes.size() },
+        objFilePath.string(), threadCount) };
+    if (!geometry)
     {
-        std::istringstream iss{ line };
-        std::string prefix;
-        iss >> prefix;
-        if (prefix == "v")
-        {
-            float x, y, z;
-            iss >> x >> y >> z;
-            vertices.emplace_back(x, y, z);
-        }
-        else if (prefix == "vt")
+        return nullptr;
+    }
+    std::shared_ptr<PngTexture> texture{ nullptr };
+    if (textureFilePath)
+    {
+        texture = game::LoadCookedTexture(textureFilePath.value());
+    }
+
+    SPDLOG_INFO("Loaded OBJ file '{}' with {} vertices, {} texture coordinates, {} faces",
+        objFilePath.string(), geometry->Vertices.size(), geometry->TextureCoordinates.size(),
+        geometry->Faces.size());
+    auto bounds{ MeshBounds::FromVertices(geometry->Vertices) };
+    return std::make_shared<Mesh>(std::move(geometry->Vertices),
+        std::move(geometry->TextureCoordinates), std::move(geometry->Faces), texture, bounds);
+}
+
+std::vector<std::shared_ptr<Mesh>> Mesh::SplitIntoChunks(uint16_t chunksPerSide) const
+{
+    Eigen::Vector3f const extent{ Bounds.Max - Bounds.Min };
+    auto const chunkCoordinate{ [chunksPerSide](float value, float min, float size)
         {
-            float u, v;
-            iss >> u >> v;
-            textureCoordinates.emplace_back(u, v);
-        }
-        else if (prefix == "vn")
+            if (size <= 0.0f)
+            {
+                return size_t{ 0 };
+            }
+            auto const cell{ static_cast<size_t>(((value - min) / size) * chunksPerSide) };
+            return std::min(cell, static_cast<size_t>(chunksPerSide - 1));
+        } };
+
+    std::vector<std::vector<size_t>> chunkFaces(chunksPerSide * chunksPerSide);
+    for (size_t faceIndex{ 0 }; faceIndex < Faces.size(); ++faceIndex)
+    {
+        auto const& indices{ Faces.at(faceIndex).MeshVertexIndices };
+        Eigen::Vector3f const centroid{ (Vertices.at(indices.at(0)) +
+            Vertices.at(indices.at(1)) + Vertices.at(indices.at(2))) / 3.0f };
+        auto const chunkX{ chunkCoordinate(centroid.x(), Bounds.Min.x(), extent.x()) };
+        auto const chunkZ{ chunkCoordinate(centroid.z(), Bounds.Min.z(), extent.z()) };
+        chunkFaces.at((chunkZ * chunksPerSide) + chunkX).push_back(faceIndex);
+    }
+
+    // Maps indices into this mesh to indices into the chunk being built
+    constexpr size_t c_unmapped{ std::numeric_limits<size_t>::max() };
+    std::vector<size_t> vertexMap(Vertices.size(), c_unmapped);
+    std::vector<size_t> textureCoordinateMap(TextureCoordinates.size(), c_unmapped);
+
+    std::vector<std::shared_ptr<Mesh>> chunks;
+    for (auto const& faceIndices : chunkFaces)
+    {
+        if (faceIndices.empty())
         {
-            // Skip for now
+            continue;
         }
-        else if (prefix == "f")
+        std::vector<Eigen::Vector3f> chunkVertices;
+        std::vector<Eigen::Vector2f> chunkTextureCoordinates;
+        std::vector<MeshFace> chunkFaceList;
+        chunkFaceList.reserve(faceIndices.size());
+        for (auto faceIndex : faceIndices)
         {
-            std::string faceStr;
-            std::vector<size_t> vertexIndices;
-            std::vector<size_t> textureCoordinateIndices;
-            while (iss >> faceStr)
+            MeshFace face{ Faces.at(faceIndex) };
+            for (size_t i{ 0 }; i < c_verticesPerFace; ++i)
             {
-                auto slashCount{ std::count(faceStr.begin(), faceStr.end(), '/') };
-                if (slashCount == 0)
+                auto& vertexIndex{ face.MeshVertexIndices.at(i) };
+                if (vertexMap.at(vertexIndex) == c_unmapped)
                 {
-                    vertexIndices.push_back(std::stoi(faceStr));
+                    vertexMap.at(vertexIndex) = chunkVertices.size();
+                    chunkVertices.push_back(Vertices.at(vertexIndex));
                 }
-                else if (slashCount == 1)
+                vertexIndex = vertexMap.at(vertexIndex);
+                if (TextureCoordinates.empty())
                 {
-                    auto slashIndex{ faceStr.find_first_of('/') };
-                    vertexIndices.push_back(std::stoi(faceStr.substr(0, slashIndex)));
-                    textureCoordinateIndices.push_back(std::stoi(faceStr.substr(slashIndex + 1)));
+                    continue;
                 }
-                else if (slashCount == 2)
+                auto& textureCoordinateIndex{ face.MeshTextureCoordinateIndices.at(i) };
+                if (textureCoordinateMap.at(textureCoordinateIndex) == c_unmapped)
                 {
-                    auto firstSlashIndex{ faceStr.find_first_of('/') };
-                    auto lastSlashIndex{ faceStr.find_last_of('/') };
-                    vertexIndices.push_back(std::stoi(faceStr.substr(0, firstSlashIndex)));
-                    textureCoordinateIndices.push_back(std::stoi(std::string{
-                        (faceStr.begin() + firstSlashIndex + 1),
-                        (faceStr.begin() + lastSlashIndex) }));
+                    textureCoordinateMap.at(textureCoordinateIndex) =
+                        chunkTextureCoordinates.size();
+                    chunkTextureCoordinates.push_back(
+                        TextureCoordinates.at(textureCoordinateIndex));
                 }
+                textureCoordinateIndex = textureCoordinateMap.at(textureCoordinateIndex);
             }
-            if (vertexIndices.size() != c_verticesPerFace)
-            {
-                SPDLOG_ERROR("OBJ file '{}' face specified {} vertices, expected {}",
-                    objFilePath.string(), vertexIndices.size(), c_verticesPerFace);
-                return nullptr;
-            }
-            if (vertexIndices.size() != textureCoordinateIndices.size())
-            {
-                SPDLOG_ERROR("OBJ file '{}' texture coordinate count does not match vertex count.",
-                    objFilePath.string());
-                return nullptr;
-            }
-            // Convert to 0-based indexing
-            for (size_t i{ 0 }; i < vertexIndices.size(); ++i)
-            {
-                vertexIndices.at(i)--;
-                textureCoordinateIndices.at(i)--;
-            }
-            faces.emplace_back(
-                std::array<size_t, 3>{ vertexIndices.at(0), vertexIndices.at(1),
-                    vertexIndices.at(2) },
-                std::array<size_t, 3>{ textureCoordinateIndices.at(0),
-                    textureCoordinateIndices.at(1), textureCoordinateIndices.at(2) },
-                c_faceColors.at(faces.size() % c_faceColors.size()));
+            chunkFaceList.push_back(face);
         }
+        std::fill(vertexMap.begin(), vertexMap.end(), c_unmapped);
+        std::fill(textureCoordinateMap.begin(), textureCoordinateMap.end(), c_unmapped);
+
+        auto bounds{ MeshBounds::FromVertices(chunkVertices) };
+        chunks.push_back(std::make_shared<Mesh>(std::move(chunkVertices),
+            std::move(chunkTextureCoordinates), std::move(chunkFaceList), Texture, bounds));
     }
-    std::shared_ptr<PngTexture> texture{ nullptr };
-    if (textureFilePath)
+    SPDLOG_INFO("Split mesh with {} faces into {} chunks", Faces.size(), chunks.size());
+    return chunks;
+}
+
+void Mesh::Pack(bool isQuantized)
+{
+    [[maybe_unused]] auto const unpackedBytes{ MemoryUsage() };
+    Packed = game::PackedMesh::FromMesh(*this, isQuantized);
+    TriangleCount = Packed.TriangleCount();
+    Vertices = std::vector<Eigen::Vector3f>{};
+    TextureCoordinates = std::vector<Eigen::Vector2f>{};
+    Faces = std::vector<MeshFace>{};
+    SPDLOG_DEBUG("Packed mesh of {} vertices and {} triangles from {} bytes into {} bytes",
+        Packed.VertexCount(), Packed.TriangleCount(), unpackedBytes, MemoryUsage());
+    for (auto& level : LevelsOfDetail)
     {
-        texture = PngTexture::FromPngFile(textureFilePath.value());
+        level.Simplified->Pack(isQuantized);
     }
+}
 
-    SPDLOG_INFO("Loaded OBJ file '{}' with {} vertices, {} texture coordinates, {} faces",
-        objFilePath.string(), vertices.size(), textureCoordinates.size(), faces.size());
-    return std::make_shared<Mesh>(vertices, textureCoordinates, faces, texture);
+size_t Mesh::MemoryUsage() const
+{
+    return (Vertices.capacity() * sizeof(Eigen::Vector3f)) +
+        (TextureCoordinates.capacity() * sizeof(Eigen::Vector2f)) +
+        (Faces.capacity() * sizeof(MeshFace)) + Packed.MemoryUsage();
 }
 
 std::shared_ptr<Mesh> Mesh::Cube()
@@ -155,14 +214,19 @@ std::shared_ptr<Mesh> Mesh::Cube()
         MeshFace{ { 5, 1, 3 } },
         MeshFace{ { 5, 3, 7 } },
     };
-    return std::make_shared<Mesh>(
+    auto cube{ std::make_shared<Mesh>(
         vertices,
         std::vector<Eigen::Vector2f>{},
-        faces
-    );
+        faces,
+        nullptr,
+        MeshBounds::FromVertices(vertices)
+    ) };
+    // Built in code rather than loaded, so nothing else packs it for drawing
+    cube->Pack(false);
+    return cube;
 }
 
-std::shared_ptr<Mesh> Mesh::AdjoiningTriangles()
+std::shared_ptr<Mesh> Mesh::AdjoiningTriangles(std::shared_ptr<PngTexture> texture)
 {
     std::vector<Eigen::Vector3f> vertices{
         Eigen::Vector3f{ -0.5f, -0.5f,  0.0f },
@@ -180,10 +244,13 @@ std::shared_ptr<Mesh> Mesh::AdjoiningTriangles()
         MeshFace{ { 2, 1, 0 }, { 2, 1, 0 } },
         MeshFace{ { 2, 3, 1 }, { 2, 3, 1 } },
     };
-    return std::make_shared<Mesh>(
+    auto triangles{ std::make_shared<Mesh>(
         vertices,
         textureCoordinates,
         faces,
-        PngTexture::FromPngFile("cube.png")
-    );
+        std::move(texture),
+        MeshBounds::FromVertices(vertices)
+    ) };
+    triangles->Pack(false);
+    return triangles;
 }
@@ -1,5 +1,7 @@
 #pragma once
+#include <functional>
 #include "../Texture/PngTexture.h"
+#include "PackedMesh.h"
 
 struct MeshFace
 {
@@ -8,6 +10,27 @@ struct MeshFace
     uint32_t ShadeColor;
 };
 
+struct MeshBounds
+{
+    // Axis-aligned box and enclosing sphere of the vertices, in the mesh's local space
+    Eigen::Vector3f Min;
+    Eigen::Vector3f Max;
+    game::BoundingSphere Sphere;
+
+    static MeshBounds FromVertices(std::vector<Eigen::Vector3f> const& vertices);
+};
+
+struct Mesh;
+
+// A cheaper stand-in for a mesh, to be drawn when it is far enough away that the
+// difference doesn't show
+struct MeshLevelOfDetail
+{
+    std::shared_ptr<Mesh> Simplified;
+    // Largest distance between the simplified surface and the original, in local units
+    float GeometricError;
+};
+
 struct Mesh
 {
     std::vector<Eigen::Vector3f> Vertices;
@@ -17,9 +40,28 @@ struct Mesh
     // glm::vec3 Scale;
     // glm::vec3 Translation;
     std::shared_ptr<PngTexture> Texture;
+    MeshBounds Bounds;
+    // Ordered from finest to coarsest, not including the mesh itself
+    std::vector<MeshLevelOfDetail> LevelsOfDetail;
+    // What the renderer draws; empty until Pack is called, or while evicted
+    game::PackedMesh Packed;
+    // Maps the packed form back in after it has been dropped to save memory. Empty for
+    // meshes that have nowhere to bring it back from.
+    std::function<std::optional<game::PackedMesh>()> ReloadPacked;
+    // Triangles of the packed form, still known while it is evicted
+    size_t TriangleCount{ 0 };
 
     static std::shared_ptr<Mesh> FromObjFile(std::filesystem::path objFilePath,
         std::optional<std::filesystem::path> textureFilePath);
+    // Splits the faces into a chunksPerSide x chunksPerSide grid over the X/Z extent of the
+    // mesh, by the centroid of each face. Each chunk gets its own copy of the vertices it
+    // uses along with its own bounds, so it can be culled and transformed on its own.
+    std::vector<std::shared_ptr<Mesh>> SplitIntoChunks(uint16_t chunksPerSide) const;
+    // Builds the packed form of this mesh and of each of its levels of detail, then releases
+    // the vertices, texture coordinates and faces it was built from
+    void Pack(bool isQuantized);
+    // Bytes held by the geometry of this mesh alone, not its levels of detail or texture
+    size_t MemoryUsage() const;
     static std::shared_ptr<Mesh> Cube();
-    static std::shared_ptr<Mesh> AdjoiningTriangles();
+    static std::shared_ptr<Mesh> AdjoiningTriangles(std::shared_ptr<PngTexture> texture);
 };
\ No newline at end of file
@@ -0,0 +1,406 @@
+#include <pch.h>
+#include "MeshCache.h"
+#include "../Utility/MappedFile.h"
+
+namespace
+{
+    constexpr std::array<char, 4> c_cacheMagic{ 'M', 'E', 'S', 'H' };
+    // Bump whenever the layout below, or the way meshes are built before being cached,
+    // changes. Caches of any other version are rebuilt.
+    constexpr uint32_t c_cacheVersion{ 3 };
+    // Every stream starts on a boundary of this many bytes
+    constexpr size_t c_streamAlignment{ 16 };
+
+    // The file is a header, followed by a table of entries, followed by the streams. Each
+    // mesh has an entry followed by one for each of its levels of detail. Values are stored
+    // in the byte order of the machine that wrote them; a cache from a machine of the other
+    // byte order fails the version check and is rebuilt.
+    struct CacheHeader
+    {
+        std::array<char, 4> Magic;
+        uint32_t Version;
+        uint32_t MeshCount;
+        uint32_t EntryCount;
+    };
+
+    struct CacheEntry
+    {
+        std::array<float, 3> BoundsMin;
+        std::array<float, 3> BoundsMax;
+        std::array<float, 3> SphereCenter;
+        float SphereRadius;
+        float GeometricError;
+        // Number of entries following this one that are its levels of detail
+        uint32_t LevelCount;
+        game::PackedMesh::VertexComponents Offset;
+        game::PackedMesh::VertexComponents Scale;
+        // Bytes per vertex component and per index
+        uint32_t ComponentSize;
+        uint32_t IndexSize;
+        uint64_t VertexOffset;
+        uint64_t VertexCount;
+        uint64_t IndexOffset;
+        uint64_t IndexCount;
+    };
+    static_assert(std::is_trivially_copyable_v<CacheHeader>);
+    static_assert(std::is_trivially_copyable_v<CacheEntry>);
+
+    size_t AlignStream(size_t offset)
+    {
+        return (offset + c_streamAlignment - 1) & ~(c_streamAlignment - 1);
+    }
+
+    std::array<float, 3> ToArray(Eigen::Vector3f const& vector)
+    {
+        return { vector.x(), vector.y(), vector.z() };
+    }
+
+    Eigen::Vector3f ToVector(std::array<float, 3> const& array)
+    {
+        return { array.at(0), array.at(1), array.at(2) };
+    }
+
+    std::span<std::byte const> VertexBytes(game::PackedMesh const& mesh)
+    {
+        return std::visit([](auto const& vertices) { return std::as_bytes(vertices); },
+            mesh.Vertices);
+    }
+
+    std::span<std::byte const> IndexBytes(game::PackedMesh const& mesh)
+    {
+        return std::visit([](auto const& indices) { return std::as_bytes(indices); },
+            mesh.Indices);
+    }
+
+    template<typename T>
+    std::optional<T> ReadValue(std::span<std::byte const> bytes, size_t offset)
+    {
+        if ((offset + sizeof(T)) > bytes.size())
+        {
+            return std::nullopt;
+        }
+        T value;
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+        return value;
+    }
+
+    // The stream at an offset into the cache, out of bytes mapped from fileOffset onwards
+    template<typename T>
+    std::optional<std::span<T const>> StreamAt(std::span<std::byte const> bytes,
+        uint64_t fileOffset, uint64_t offset, uint64_t count)
+    {
+        if (((offset % c_streamAlignment) != 0) || (offset < fileOffset) ||
+            ((offset - fileOffset) > bytes.size()) ||
+            (count > ((bytes.size() - (offset - fileOffset)) / sizeof(T))))
+        {
+            return std::nullopt;
+        }
+        return std::span<T const>{
+            reinterpret_cast<T const*>(bytes.data() + (offset - fileOffset)),
+            static_cast<size_t>(count) };
+    }
+
+    // Builds the packed mesh an entry describes, with streams pointing into a mapping of the
+    // cache from fileOffset onwards
+    std::optional<game::PackedMesh> PackedMeshFromEntry(CacheEntry const& entry,
+        std::shared_ptr<game::MappedFile> const& file, uint64_t fileOffset)
+    {
+        auto const bytes{ file->Bytes() };
+        // Counts that can't fit in the file are turned away before they can overflow
+        if ((entry.VertexCount > bytes.size()) || (entry.IndexCount > bytes.size()) ||
+            ((entry.IndexCount % 3) != 0))
+        {
+            return std::nullopt;
+        }
+        auto const componentCount{ entry.VertexCount * game::PackedMesh::c_vertexStride };
+        game::PackedMesh packed;
+        packed.Offset = entry.Offset;
+        packed.Scale = entry.Scale;
+        packed.Storage = file;
+        if (entry.ComponentSize == sizeof(float))
+        {
+            auto const vertices{ StreamAt<float>(bytes, fileOffset, entry.VertexOffset,
+                componentCount) };
+            if (!vertices)
+            {
+                return std::nullopt;
+            }
+            packed.Vertices = *vertices;
+        }
+        else if (entry.ComponentSize == sizeof(uint16_t))
+        {
+            auto const vertices{ StreamAt<uint16_t>(bytes, fileOffset, entry.VertexOffset,
+                componentCount) };
+            if (!vertices)
+            {
+                return std::nullopt;
+            }
+            packed.Vertices = *vertices;
+        }
+        else
+        {
+            return std::nullopt;
+        }
+        if (entry.IndexSize == sizeof(uint16_t))
+        {
+            auto const indices{ StreamAt<uint16_t>(bytes, fileOffset, entry.IndexOffset,
+                entry.IndexCount) };
+            if (!indices)
+            {
+                return std::nullopt;
+            }
+            packed.Indices = *indices;
+        }
+        else if (entry.IndexSize == sizeof(uint32_t))
+        {
+            auto const indices{ StreamAt<uint32_t>(bytes, fileOffset, entry.IndexOffset,
+                entry.IndexCount) };
+            if (!indices)
+            {
+                return std::nullopt;
+            }
+            packed.Indices = *indices;
+        }
+        else
+        {
+            return std::nullopt;
+        }
+        // The renderer trusts every index to name a vertex of the stream
+        bool const areIndicesInRange{ std::visit([&entry](auto const& indices)
+            {
+                return std::ranges::all_of(indices, [&entry](auto index)
+                    {
+                        return index < entry.VertexCount;
+                    });
+            }, packed.Indices) };
+        if (!areIndicesInRange)
+        {
+            return std::nullopt;
+        }
+        return packed;
+    }
+
+    // Maps in just the streams of an entry that has already been checked against the cache,
+    // so the mesh can drop them, and map them back later, apart from every other mesh
+    std::optional<game::PackedMesh> MapEntryStreams(std::filesystem::path const& cachePath,
+        CacheEntry const& entry)
+    {
+        uint64_t const vertexBytes{ entry.VertexCount * game::PackedMesh::c_vertexStride *
+            entry.ComponentSize };
+        uint64_t const indexBytes{ entry.IndexCount * entry.IndexSize };
+        auto const start{ std::min(entry.VertexOffset, entry.IndexOffset) };
+        auto const end{ std::max(entry.VertexOffset + vertexBytes,
+            entry.IndexOffset + indexBytes) };
+        auto const file{ game::MappedFile::Open(cachePath, start, end - start) };
+        return file ? PackedMeshFromEntry(entry, file, start) : std::nullopt;
+    }
+
+    std::shared_ptr<Mesh> MeshFromEntry(CacheEntry const& entry, game::PackedMesh&& packed,
+        std::shared_ptr<PngTexture> texture)
+    {
+        MeshBounds const bounds{ ToVector(entry.BoundsMin), ToVector(entry.BoundsMax),
+            game::BoundingSphere{ ToVector(entry.SphereCenter), entry.SphereRadius } };
+        auto const triangleCount{ packed.TriangleCount() };
+        return std::make_shared<Mesh>(std::vector<Eigen::Vector3f>{},
+            std::vector<Eigen::Vector2f>{}, std::vector<MeshFace>{}, texture, bounds,
+            std::vector<MeshLevelOfDetail>{}, std::move(packed), nullptr, triangleCount);
+    }
+}
+
+namespace game
+{
+std::optional<std::vector<std::shared_ptr<Mesh>>> LoadMeshCache(
+    std::filesystem::path const& cachePath, std::filesystem::path const& sourcePath,
+    std::shared_ptr<PngTexture> texture)
+{
+    std::error_code error;
+    if (!std::filesystem::exists(cachePath, error))
+    {
+        SPDLOG_INFO("No mesh cache at '{}'", cachePath.string());
+        return std::nullopt;
+    }
+    if (std::filesystem::exists(sourcePath, error) &&
+        (std::filesystem::last_write_time(sourcePath, error) >
+            std::filesystem::last_write_time(cachePath, error)))
+    {
+        SPDLOG_INFO("Mesh cache '{}' is older than '{}'", cachePath.string(),
+            sourcePath.string());
+        return std::nullopt;
+    }
+    auto const file{ MappedFile::Open(cachePath) };
+    if (!file)
+    {
+        return std::nullopt;
+    }
+
+    auto const bytes{ file->Bytes() };
+    auto const header{ ReadValue<CacheHeader>(bytes, 0) };
+    if (!header || (header->Magic != c_cacheMagic) || (header->Version != c_cacheVersion))
+    {
+        SPDLOG_INFO("Mesh cache '{}' is not version {}", cachePath.string(), c_cacheVersion);
+        return std::nullopt;
+    }
+    // Every mesh has an entry of its own, and the entry table has to fit in the file
+    if ((header->MeshCount > header->EntryCount) || (header->EntryCount >
+        ((bytes.size() - sizeof(CacheHeader)) / sizeof(CacheEntry))))
+    {
+        SPDLOG_WARN("Mesh cache '{}' is damaged", cachePath.string());
+        return std::nullopt;
+    }
+    auto const readEntry{ [&](size_t index) -> std::optional<CacheEntry>
+        {
+            if (index >= header->EntryCount)
+            {
+                return std::nullopt;
+            }
+            return ReadValue<CacheEntry>(bytes, sizeof(CacheHeader) + (index * sizeof(CacheEntry)));
+        } };
+    auto const readMesh{ [&](std::optional<CacheEntry> const& entry) -> std::shared_ptr<Mesh>
+        {
+            if (!entry || !PackedMeshFromEntry(*entry, file, 0))
+            {
+                return nullptr;
+            }
+            auto packed{ MapEntryStreams(cachePath, *entry) };
+            if (!packed)
+            {
+                return nullptr;
+            }
+            auto const mesh{ MeshFromEntry(*entry, std::move(*packed), texture) };
+            mesh->ReloadPacked = [cachePath, entry{ *entry }]()
+                {
+                    return MapEntryStreams(cachePath, entry);
+                };
+            return mesh;
+        } };
+
+    std::vector<std::shared_ptr<Mesh>> meshes;
+    meshes.reserve(header->MeshCount);
+    size_t entryIndex{ 0 };
+    for (uint32_t i{ 0 }; i < header->MeshCount; ++i)
+    {
+        auto const entry{ readEntry(entryIndex++) };
+        auto const mesh{ readMesh(entry) };
+        if (!mesh)
+        {
+            SPDLOG_WARN("Mesh cache '{}' is damaged", cachePath.string());
+            return std::nullopt;
+        }
+        for (uint32_t level{ 0 }; level < entry->LevelCount; ++level)
+        {
+            auto const levelEntry{ readEntry(entryIndex++) };
+            auto const simplified{ readMesh(levelEntry) };
+            if (!simplified)
+            {
+                SPDLOG_WARN("Mesh cache '{}' is damaged", cachePath.string());
+                return std::nullopt;
+            }
+            mesh->LevelsOfDetail.push_back(
+                MeshLevelOfDetail{ simplified, levelEntry->GeometricError });
+        }
+        meshes.push_back(mesh);
+    }
+    SPDLOG_INFO("Mapped {} meshes from cache '{}' ({} KiB)", meshes.size(), cachePath.string(),
+        bytes.size() / 1024);
+    return meshes;
+}
+
+bool WriteMeshCache(std::filesystem::path const& cachePath,
+    std::span<std::shared_ptr<Mesh> const> meshes)
+{
+    // Lay out the entries and work out where each stream goes before writing anything
+    std::vector<Mesh const*> entryMeshes;
+    std::vector<CacheEntry> entries;
+    for (auto const& mesh : meshes)
+    {
+        entryMeshes.push_back(mesh.get());
+        for (auto const& level : mesh->LevelsOfDetail)
+        {
+            entryMeshes.push_back(level.Simplified.get());
+        }
+    }
+    size_t offset{ AlignStream(sizeof(CacheHeader) + (entryMeshes.size() * sizeof(CacheEntry))) };
+    for (auto const& mesh : meshes)
+    {
+        for (size_t level{ 0 }; level <= mesh->LevelsOfDetail.size(); ++level)
+        {
+            auto const& entryMesh{ (level == 0) ? *mesh :
+                *mesh->LevelsOfDetail.at(level - 1).Simplified };
+            auto const& packed{ entryMesh.Packed };
+            CacheEntry entry{
+                .BoundsMin = ToArray(entryMesh.Bounds.Min),
+                .BoundsMax = ToArray(entryMesh.Bounds.Max),
+                .SphereCenter = ToArray(entryMesh.Bounds.Sphere.Center),
+                .SphereRadius = entryMesh.Bounds.Sphere.Radius,
+                .GeometricError = (level == 0) ? 0.0f :
+                    mesh->LevelsOfDetail.at(level - 1).GeometricError,
+                .LevelCount = static_cast<uint32_t>((level == 0) ?
+                    mesh->LevelsOfDetail.size() : 0),
+                .Offset = packed.Offset,
+                .Scale = packed.Scale,
+                .ComponentSize = std::visit([](auto const& vertices)
+                    {
+                        return static_cast<uint32_t>(sizeof(vertices[0]));
+                    }, packed.Vertices),
+                .IndexSize = std::visit([](auto const& indices)
+                    {
+                        return static_cast<uint32_t>(sizeof(indices[0]));
+                    }, packed.Indices),
+                .VertexOffset = offset,
+                .VertexCount = packed.VertexCount(),
+                .IndexOffset = 0,
+                .IndexCount = packed.TriangleCount() * 3,
+            };
+            offset = AlignStream(offset + VertexBytes(packed).size());
+            entry.IndexOffset = offset;
+            offset = AlignStream(offset + IndexBytes(packed).size());
+            entries.push_back(entry);
+        }
+    }
+
+    // Write to a temporary file first, so a run that stops part way can't leave a
+    // damaged cache behind
+    auto temporaryPath{ cachePath };
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file{ temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc };
+        if (!file.is_open())
+        {
+            SPDLOG_WARN("Could not open mesh cache '{}' for writing", temporaryPath.string());
+            return false;
+        }
+        CacheHeader const header{ c_cacheMagic, c_cacheVersion,
+            static_cast<uint32_t>(meshes.size()), static_cast<uint32_t>(entries.size()) };
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(reinterpret_cast<char const*>(entries.data()),
+            static_cast<std::streamsize>(entries.size() * sizeof(CacheEntry)));
+        auto const writeStream{ [&file](std::span<std::byte const> stream, uint64_t streamOffset)
+            {
+                std::array<char, c_streamAlignment> const padding{};
+                auto const position{ static_cast<uint64_t>(file.tellp()) };
+                file.write(padding.data(), static_cast<std::streamsize>(streamOffset - position));
+                file.write(reinterpret_cast<char const*>(stream.data()),
+                    static_cast<std::streamsize>(stream.size()));
+            } };
+        for (size_t i{ 0 }; i < entries.size(); ++i)
+        {
+            writeStream(VertexBytes(entryMeshes.at(i)->Packed), entries.at(i).VertexOffset);
+            writeStream(IndexBytes(entryMeshes.at(i)->Packed), entries.at(i).IndexOffset);
+        }
+        if (!file.good())
+        {
+            SPDLOG_WARN("Could not write mesh cache '{}'", temporaryPath.string());
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, cachePath, error);
+    if (error)
+    {
+        SPDLOG_WARN("Could not replace mesh cache '{}': {}", cachePath.string(), error.message());
+        return false;
+    }
+    SPDLOG_INFO("Wrote {} meshes to cache '{}'", meshes.size(), cachePath.string());
+    return true;
+}
+}
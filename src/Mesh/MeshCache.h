@@ -0,0 +1,18 @@
+#pragma once
+#include "Mesh.h"
+
+namespace game
+{
+// Packed meshes, along with their bounds and levels of detail, saved in a binary file that
+// can be mapped straight back into memory and drawn from as is, rather than being rebuilt
+// from their source on every run.
+
+// Returns the meshes in the cache, in the order they were written, if the cache was
+// written by this version of the format and is no older than its source file.
+std::optional<std::vector<std::shared_ptr<Mesh>>> LoadMeshCache(
+    std::filesystem::path const& cachePath, std::filesystem::path const& sourcePath,
+    std::shared_ptr<PngTexture> texture);
+// Writes packed meshes and their levels of detail to a cache. Returns false if it couldn't.
+bool WriteMeshCache(std::filesystem::path const& cachePath,
+    std::span<std::shared_ptr<Mesh> const> meshes);
+}
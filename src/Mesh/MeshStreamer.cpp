@@ -0,0 +1,159 @@
+#include <pch.h>
+#include "MeshStreamer.h"
+
+namespace game
+{
+MeshStreamer::MeshStreamer(ThreadPool* threadPool, size_t budgetBytes) :
+    m_threadPool{ threadPool }, m_budgetBytes{ budgetBytes }
+{ }
+
+void MeshStreamer::Register(std::shared_ptr<Mesh> const& mesh)
+{
+    std::vector<std::shared_ptr<Mesh>> chain{ mesh };
+    for (auto const& level : mesh->LevelsOfDetail)
+    {
+        chain.push_back(level.Simplified);
+    }
+    std::scoped_lock lock{ m_mutex };
+    for (size_t i{ 0 }; i < chain.size(); ++i)
+    {
+        auto const& level{ chain.at(i) };
+        auto const bytes{ level->Packed.MemoryUsage() };
+        bool const isStreamed{ ((i + 1) < chain.size()) && level->ReloadPacked &&
+            IsResident(level.get()) };
+        if (!isStreamed)
+        {
+            m_pinnedBytes += bytes;
+        }
+        else if (m_levels.try_emplace(level.get(),
+            StreamedLevel{ level, bytes, 0, std::nullopt, false }).second)
+        {
+            m_residentBytes += bytes;
+        }
+    }
+}
+
+Mesh const* MeshStreamer::Request(Mesh const* mesh, Mesh const* wanted)
+{
+    std::vector<Mesh const*> chain{ mesh };
+    for (auto const& level : mesh->LevelsOfDetail)
+    {
+        chain.push_back(level.Simplified.get());
+    }
+    auto const wantedIndex{ static_cast<size_t>(
+        std::distance(chain.begin(), std::ranges::find(chain, wanted))) };
+
+    std::scoped_lock lock{ m_mutex };
+    auto const markRequested{ [this](Mesh const* level)
+        {
+            auto const found{ m_levels.find(level) };
+            if (found != m_levels.end())
+            {
+                found->second.LastRequestedFrame = m_frame;
+            }
+        } };
+    markRequested(wanted);
+    if (auto found{ m_levels.find(wanted) }; (found != m_levels.end()) &&
+        !IsResident(wanted) && !found->second.PendingLoad && !found->second.IsUnavailable)
+    {
+        auto& streamed{ found->second };
+        streamed.PendingLoad = m_threadPool ?
+            m_threadPool->Enqueue(streamed.Level->ReloadPacked) :
+            std::async(std::launch::deferred, streamed.Level->ReloadPacked);
+    }
+
+    // Coarser levels first, as they are cheaper to draw than the one wanted
+    for (size_t i{ wantedIndex }; i < chain.size(); ++i)
+    {
+        if (IsResident(chain.at(i)))
+        {
+            markRequested(chain.at(i));
+            return chain.at(i);
+        }
+    }
+    for (size_t i{ std::min(wantedIndex, chain.size()) }; i-- > 0;)
+    {
+        if (IsResident(chain.at(i)))
+        {
+            markRequested(chain.at(i));
+            return chain.at(i);
+        }
+    }
+    return nullptr;
+}
+
+void MeshStreamer::Update()
+{
+    std::scoped_lock lock{ m_mutex };
+    for (auto& [level, streamed] : m_levels)
+    {
+        if (!streamed.PendingLoad || (m_threadPool && (streamed.PendingLoad->wait_for(
+            std::chrono::seconds{ 0 }) != std::future_status::ready)))
+        {
+            continue;
+        }
+        auto packed{ streamed.PendingLoad->get() };
+        streamed.PendingLoad.reset();
+        if (!packed)
+        {
+            SPDLOG_WARN("Could not map a mesh level of detail back in; drawing a coarser one");
+            streamed.IsUnavailable = true;
+            continue;
+        }
+        streamed.Level->Packed = std::move(*packed);
+        m_residentBytes += streamed.Bytes;
+    }
+
+    if (m_residentBytes > m_budgetBytes)
+    {
+        // Levels drawn in the frame just finished are kept, even over budget, so that a
+        // budget too small for one frame's levels doesn't evict and reload them every frame
+        std::vector<StreamedLevel*> evictable;
+        for (auto& [level, streamed] : m_levels)
+        {
+            if (IsResident(level) && (streamed.LastRequestedFrame < m_frame))
+            {
+                evictable.push_back(&streamed);
+            }
+        }
+        std::ranges::sort(evictable, [](StreamedLevel const* a, StreamedLevel const* b)
+            {
+                return (a->LastRequestedFrame != b->LastRequestedFrame) ?
+                    (a->LastRequestedFrame < b->LastRequestedFrame) : (a->Bytes > b->Bytes);
+            });
+        for (auto* streamed : evictable)
+        {
+            if (m_residentBytes <= m_budgetBytes)
+            {
+                break;
+            }
+            streamed->Level->Packed = PackedMesh{};
+            m_residentBytes -= streamed->Bytes;
+        }
+    }
+    ++m_frame;
+}
+
+void MeshStreamer::SetBudget(size_t budgetBytes)
+{
+    std::scoped_lock lock{ m_mutex };
+    m_budgetBytes = budgetBytes;
+}
+
+MeshStreamer::Residency MeshStreamer::GetResidency() const
+{
+    std::scoped_lock lock{ m_mutex };
+    Residency residency{ m_levels.size(), 0, 0, m_residentBytes, m_pinnedBytes, m_budgetBytes };
+    for (auto const& [level, streamed] : m_levels)
+    {
+        residency.ResidentLevelCount += IsResident(level) ? 1 : 0;
+        residency.LoadingLevelCount += streamed.PendingLoad ? 1 : 0;
+    }
+    return residency;
+}
+
+bool MeshStreamer::IsResident(Mesh const* level) const
+{
+    return level->Packed.VertexCount() > 0;
+}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "Mesh.h"
+#include "../Utility/ThreadPool.h"
+
+namespace game
+{
+// Keeps the finer levels of detail of meshes resident only while they are being drawn, and
+// only as far as a memory budget allows. The coarsest level of each mesh is never evicted,
+// and is drawn in place of any finer level that isn't resident. Evicted levels are mapped
+// back in on the thread pool when they are wanted again, and the least recently drawn are
+// evicted first once the budget is exceeded. Textures stay resident once loaded.
+struct MeshStreamer
+{
+    // What is resident right now, for tuning the budget
+    struct Residency
+    {
+        size_t StreamedLevelCount;
+        size_t ResidentLevelCount;
+        size_t LoadingLevelCount;
+        // Bytes of streamed levels that are resident
+        size_t ResidentBytes;
+        // Bytes of the coarsest levels, which stay resident whatever the budget
+        size_t PinnedBytes;
+        size_t BudgetBytes;
+    };
+
+    MeshStreamer(ThreadPool* threadPool, size_t budgetBytes);
+
+    // Starts managing the residency of a mesh and its levels of detail. Levels that can't
+    // be mapped back in once dropped are left resident.
+    void Register(std::shared_ptr<Mesh> const& mesh);
+    // The level of a mesh's chain to draw in place of the one wanted: the wanted level if it
+    // is resident, otherwise the nearest resident coarser level, or finer if there is none.
+    // Asks for the wanted level to be mapped back in if it isn't resident.
+    Mesh const* Request(Mesh const* mesh, Mesh const* wanted);
+    // Makes levels that have finished loading drawable, then evicts the least recently
+    // drawn levels until the budget is met. Must be called between frames, on the thread
+    // that draws them.
+    void Update();
+    void SetBudget(size_t budgetBytes);
+    Residency GetResidency() const;
+
+private:
+    struct StreamedLevel
+    {
+        std::shared_ptr<Mesh> Level;
+        size_t Bytes;
+        uint64_t LastRequestedFrame{ 0 };
+        std::optional<std::future<std::optional<PackedMesh>>> PendingLoad;
+        // Set once mapping the level back in has failed, so it isn't tried every frame
+        bool IsUnavailable{ false };
+    };
+
+    ThreadPool* const m_threadPool;
+    size_t m_budgetBytes;
+    size_t m_residentBytes{ 0 };
+    size_t m_pinnedBytes{ 0 };
+    uint64_t m_frame{ 1 };
+    std::unordered_map<Mesh const*, StreamedLevel> m_levels;
+    mutable std::mutex m_mutex;
+
+    bool IsResident(Mesh const* level) const;
+};
+}
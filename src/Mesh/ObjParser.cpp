@@ -0,0 +1,338 @@
+#include <pch.h>
+#include <charconv>
+#include "ObjParser.h"
+#include "../Utility/ThreadPool.h"
+
+namespace
+{
+    constexpr std::array<uint32_t, 6> c_faceColors{
+        0xFFFF0000,
+        0xFF00FF00,
+        0xFF0000FF,
+        0xFFFFFF00,
+        0xFFFF00FF,
+        0xFF00FFFF,
+    };
+
+    // How many of each element a range of lines holds, or, once summed over the ranges
+    // before it, where the range's elements start
+    struct ElementCounts
+    {
+        size_t Vertices{ 0 };
+        size_t TextureCoordinates{ 0 };
+        size_t Faces{ 0 };
+    };
+
+    struct ParseError
+    {
+        // Offset into the whole text of the line at fault
+        size_t Offset;
+        std::string Message;
+    };
+
+    // One corner of a face as written, as "v", "v/vt", "v//vn" or "v/vt/vn"
+    struct FaceCorner
+    {
+        int64_t Vertex;
+        std::optional<int64_t> TextureCoordinate;
+    };
+
+    bool IsSpace(char c)
+    {
+        return (c == ' ') || (c == '\t') || (c == '\r');
+    }
+
+    // Removes and returns the next whitespace-separated token of a line, or an empty view
+    // at the end of the line
+    std::string_view NextToken(std::string_view& line)
+    {
+        size_t start{ 0 };
+        while ((start < line.size()) && IsSpace(line[start]))
+        {
+            ++start;
+        }
+        size_t end{ start };
+        while ((end < line.size()) && !IsSpace(line[end]))
+        {
+            ++end;
+        }
+        auto const token{ line.substr(start, end - start) };
+        line.remove_prefix(end);
+        return token;
+    }
+
+    // Calls onLine(line, offset) for each line of a range, without its line break
+    template<typename F>
+    void ForEachLine(std::string_view text, size_t offset, F const& onLine)
+    {
+        while (!text.empty())
+        {
+            auto const end{ std::min(text.find('\n'), text.size()) };
+            onLine(text.substr(0, end), offset);
+            auto const next{ std::min(end + 1, text.size()) };
+            text.remove_prefix(next);
+            offset += next;
+        }
+    }
+
+    template<typename T>
+    std::optional<T> ParseNumber(std::string_view token)
+    {
+        if (!token.empty() && (token.front() == '+'))
+        {
+            token.remove_prefix(1);
+        }
+        T value;
+        auto const [end, error]{ std::from_chars(token.data(), token.data() + token.size(),
+            value) };
+        if ((error != std::errc{}) || (end != (token.data() + token.size())))
+        {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    std::optional<FaceCorner> ParseFaceCorner(std::string_view token)
+    {
+        auto const firstSlash{ token.find('/') };
+        auto const vertex{ ParseNumber<int64_t>(token.substr(0, firstSlash)) };
+        if (!vertex)
+        {
+            return std::nullopt;
+        }
+        if (firstSlash == std::string_view::npos)
+        {
+            return FaceCorner{ *vertex, std::nullopt };
+        }
+        auto const rest{ token.substr(firstSlash + 1) };
+        auto const textureCoordinateToken{ rest.substr(0, rest.find('/')) };
+        if (textureCoordinateToken.empty())
+        {
+            return FaceCorner{ *vertex, std::nullopt };
+        }
+        auto const textureCoordinate{ ParseNumber<int64_t>(textureCoordinateToken) };
+        if (!textureCoordinate)
+        {
+            return std::nullopt;
+        }
+        return FaceCorner{ *vertex, *textureCoordinate };
+    }
+
+    // Turns a 1-based OBJ index, or a negative one counting back from the last element read
+    // so far, into a 0-based index, if that lands within the elements of the whole file
+    std::optional<size_t> ResolveIndex(int64_t index, size_t readSoFar, size_t total)
+    {
+        int64_t const resolved{ (index > 0) ? (index - 1) :
+            (static_cast<int64_t>(readSoFar) + index) };
+        if ((index == 0) || (resolved < 0) || (static_cast<size_t>(resolved) >= total))
+        {
+            return std::nullopt;
+        }
+        return static_cast<size_t>(resolved);
+    }
+
+    // First pass over a range of lines, only looking at their keywords and face sizes, so
+    // every range knows where its elements go before any of them are parsed
+    ElementCounts CountElements(std::string_view text)
+    {
+        ElementCounts counts;
+        ForEachLine(text, 0, [&counts](std::string_view line, size_t)
+            {
+                auto const keyword{ NextToken(line) };
+                if (keyword == "v")
+                {
+                    ++counts.Vertices;
+                }
+                else if (keyword == "vt")
+                {
+                    ++counts.TextureCoordinates;
+                }
+                else if (keyword == "f")
+                {
+                    size_t cornerCount{ 0 };
+                    while (!NextToken(line).empty())
+                    {
+                        ++cornerCount;
+                    }
+                    counts.Faces += (cornerCount > 2) ? (cornerCount - 2) : 0;
+                }
+            });
+        return counts;
+    }
+
+    // Second pass over a range of lines, parsing its elements into their place in the
+    // whole file's geometry
+    std::optional<ParseError> ParseElements(std::string_view text, size_t offset,
+        ElementCounts const& start, ElementCounts const& total, game::ObjGeometry& geometry)
+    {
+        ElementCounts read{ start };
+        std::vector<FaceCorner> corners;
+        std::optional<ParseError> error;
+        auto const parseVector{ [](std::string_view& line, auto& vector)
+            {
+                for (Eigen::Index i{ 0 }; i < vector.size(); ++i)
+                {
+                    auto const value{ ParseNumber<float>(NextToken(line)) };
+                    if (!value)
+                    {
+                        return false;
+                    }
+                    vector(i) = *value;
+                }
+                return true;
+            } };
+        ForEachLine(text, offset, [&](std::string_view line, size_t lineOffset)
+            {
+                if (error)
+                {
+                    return;
+                }
+                auto const keyword{ NextToken(line) };
+                if (keyword == "v")
+                {
+                    if (!parseVector(line, geometry.Vertices.at(read.Vertices++)))
+                    {
+                        error = ParseError{ lineOffset, "malformed vertex" };
+                    }
+                }
+                else if (keyword == "vt")
+                {
+                    if (!parseVector(line,
+                        geometry.TextureCoordinates.at(read.TextureCoordinates++)))
+                    {
+                        error = ParseError{ lineOffset, "malformed texture coordinate" };
+                    }
+                }
+                else if (keyword == "f")
+                {
+                    corners.clear();
+                    for (auto token{ NextToken(line) }; !token.empty(); token = NextToken(line))
+                    {
+                        auto const corner{ ParseFaceCorner(token) };
+                        if (!corner)
+                        {
+                            error = ParseError{ lineOffset,
+                                fmt::format("malformed face vertex '{}'", token) };
+                            return;
+                        }
+                        corners.push_back(*corner);
+                    }
+                    if (corners.size() < 3)
+                    {
+                        error = ParseError{ lineOffset,
+                            fmt::format("face specified {} vertices, expected at least 3",
+                                corners.size()) };
+                        return;
+                    }
+                    std::array<size_t, 3> vertexIndices;
+                    std::array<size_t, 3> textureCoordinateIndices{ 0, 0, 0 };
+                    auto const resolveCorner{ [&](size_t corner, size_t i)
+                        {
+                            auto const& [vertex, textureCoordinate]{ corners.at(corner) };
+                            auto const vertexIndex{ ResolveIndex(vertex, read.Vertices,
+                                total.Vertices) };
+                            if (!vertexIndex ||
+                                (textureCoordinate.has_value() !=
+                                    corners.front().TextureCoordinate.has_value()))
+                            {
+                                return false;
+                            }
+                            vertexIndices.at(i) = *vertexIndex;
+                            if (!textureCoordinate)
+                            {
+                                return true;
+                            }
+                            auto const textureCoordinateIndex{ ResolveIndex(*textureCoordinate,
+                                read.TextureCoordinates, total.TextureCoordinates) };
+                            textureCoordinateIndices.at(i) = textureCoordinateIndex.value_or(0);
+                            return textureCoordinateIndex.has_value();
+                        } };
+                    for (size_t i{ 2 }; i < corners.size(); ++i)
+                    {
+                        if (!resolveCorner(0, 0) || !resolveCorner(i - 1, 1) ||
+                            !resolveCorner(i, 2))
+                        {
+                            error = ParseError{ lineOffset,
+                                "face refers to a missing vertex or texture coordinate" };
+                            return;
+                        }
+                        auto const faceIndex{ read.Faces++ };
+                        geometry.Faces.at(faceIndex) = MeshFace{ vertexIndices,
+                            textureCoordinateIndices,
+                            c_faceColors.at(faceIndex % c_faceColors.size()) };
+                    }
+                }
+            });
+        return error;
+    }
+}
+
+namespace game
+{
+std::optional<ObjGeometry> ParseObj(std::string_view text, std::string_view name,
+    size_t threadCount)
+{
+    // Ranges start just after a line break, so each holds only whole lines
+    std::vector<size_t> rangeStarts{ 0 };
+    for (size_t i{ 1 }; i < std::max<size_t>(threadCount, 1); ++i)
+    {
+        auto const lineBreak{ text.find('\n', std::max((text.size() * i) / threadCount,
+            rangeStarts.back())) };
+        if (lineBreak == std::string_view::npos)
+        {
+            break;
+        }
+        rangeStarts.push_back(lineBreak + 1);
+    }
+    rangeStarts.push_back(text.size());
+    size_t const rangeCount{ rangeStarts.size() - 1 };
+    auto const range{ [&text, &rangeStarts](size_t i)
+        {
+            return text.substr(rangeStarts.at(i), rangeStarts.at(i + 1) - rangeStarts.at(i));
+        } };
+    std::optional<ThreadPool> threadPool;
+    auto const forEachRange{ [&threadPool, rangeCount](auto const& task)
+        {
+            if (rangeCount == 1)
+            {
+                task(0);
+                return;
+            }
+            if (!threadPool)
+            {
+                threadPool.emplace(rangeCount - 1);
+            }
+            threadPool->ParallelFor(rangeCount, task);
+        } };
+
+    std::vector<ElementCounts> rangeCounts(rangeCount);
+    forEachRange([&](size_t i) { rangeCounts.at(i) = CountElements(range(i)); });
+    ElementCounts total;
+    for (auto& counts : rangeCounts)
+    {
+        counts = std::exchange(total, ElementCounts{ total.Vertices + counts.Vertices,
+            total.TextureCoordinates + counts.TextureCoordinates, total.Faces + counts.Faces });
+    }
+
+    ObjGeometry geometry;
+    geometry.Vertices.resize(total.Vertices);
+    geometry.TextureCoordinates.resize(total.TextureCoordinates);
+    geometry.Faces.resize(total.Faces);
+    std::vector<std::optional<ParseError>> errors(rangeCount);
+    forEachRange([&](size_t i)
+        {
+            errors.at(i) = ParseElements(range(i), rangeStarts.at(i), rangeCounts.at(i), total,
+                geometry);
+        });
+    for (auto const& error : errors)
+    {
+        if (error)
+        {
+            auto const line{ std::count(text.begin(), text.begin() + error->Offset, '\n') + 1 };
+            SPDLOG_ERROR("OBJ file '{}' line {}: {}", name, line, error->Message);
+            return std::nullopt;
+        }
+    }
+    return geometry;
+}
+}
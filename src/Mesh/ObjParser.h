@@ -0,0 +1,22 @@
+#pragma once
+#include "Mesh.h"
+
+namespace game
+{
+// Geometry read from the text of a Wavefront OBJ file
+struct ObjGeometry
+{
+    std::vector<Eigen::Vector3f> Vertices;
+    std::vector<Eigen::Vector2f> TextureCoordinates;
+    std::vector<MeshFace> Faces;
+};
+
+// Parses the text of an OBJ file in place, splitting it into up to threadCount ranges of
+// whole lines that are parsed in parallel. Quads and larger polygons are triangulated as
+// fans from their first vertex, which is exact for the convex polygons exporters write.
+// Normals, groups and materials are skipped. Faces without texture coordinates refer to
+// texture coordinate 0, which doesn't exist if the file has none, so users of the faces
+// must check. Returns nullopt, having logged the offending line, if the text is malformed.
+std::optional<ObjGeometry> ParseObj(std::string_view text, std::string_view name,
+    size_t threadCount);
+}
@@ -0,0 +1,120 @@
+#include <pch.h>
+#include "Mesh.h"
+#include "PackedMesh.h"
+
+namespace
+{
+    constexpr float c_maxQuantizedValue{ static_cast<float>(UINT16_MAX) };
+
+    template<typename Vertex, typename Index>
+    void StoreStreams(game::PackedMesh& packed, std::vector<Vertex>&& vertices,
+        std::vector<Index>&& indices)
+    {
+        vertices.shrink_to_fit();
+        auto const storage{ std::make_shared<std::pair<std::vector<Vertex>, std::vector<Index>>>(
+            std::move(vertices), std::move(indices)) };
+        packed.Vertices = std::span<Vertex const>{ storage->first };
+        packed.Indices = std::span<Index const>{ storage->second };
+        packed.Storage = storage;
+    }
+
+    template<typename Vertex>
+    void StoreStreams(game::PackedMesh& packed, std::vector<Vertex>&& vertices,
+        std::vector<uint32_t>&& indices)
+    {
+        // Indices only need 32 bits once there are more vertices than 16 bits can number
+        auto const vertexCount{ vertices.size() / game::PackedMesh::c_vertexStride };
+        if (vertexCount <= (static_cast<size_t>(UINT16_MAX) + 1))
+        {
+            StoreStreams(packed, std::move(vertices),
+                std::vector<uint16_t>(indices.begin(), indices.end()));
+        }
+        else
+        {
+            StoreStreams<Vertex, uint32_t>(packed, std::move(vertices), std::move(indices));
+        }
+    }
+}
+
+namespace game
+{
+size_t PackedMesh::VertexCount() const
+{
+    return std::visit([](auto const& vertices) { return vertices.size() / c_vertexStride; },
+        Vertices);
+}
+
+size_t PackedMesh::TriangleCount() const
+{
+    return std::visit([](auto const& indices) { return indices.size() / 3; }, Indices);
+}
+
+size_t PackedMesh::MemoryUsage() const
+{
+    return std::visit([](auto const& vertices) { return vertices.size_bytes(); }, Vertices) +
+        std::visit([](auto const& indices) { return indices.size_bytes(); }, Indices);
+}
+
+PackedMesh PackedMesh::FromMesh(Mesh const& mesh, bool isQuantized)
+{
+    // Weld each distinct pair of position and texture coordinate indices into one vertex,
+    // numbered in the order the faces first use them
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    indices.reserve(mesh.Faces.size() * 3);
+    std::unordered_map<uint64_t, uint32_t> weldedIndices;
+    for (auto const& face : mesh.Faces)
+    {
+        for (size_t corner{ 0 }; corner < face.MeshVertexIndices.size(); ++corner)
+        {
+            auto const vertexIndex{ face.MeshVertexIndices.at(corner) };
+            auto const textureCoordinateIndex{ mesh.TextureCoordinates.empty() ? 0 :
+                face.MeshTextureCoordinateIndices.at(corner) };
+            auto const key{ (static_cast<uint64_t>(vertexIndex) << 32) | textureCoordinateIndex };
+            auto [welded, isNew]{ weldedIndices.try_emplace(key,
+                static_cast<uint32_t>(vertices.size() / c_vertexStride)) };
+            if (isNew)
+            {
+                auto const& position{ mesh.Vertices.at(vertexIndex) };
+                Eigen::Vector2f const textureCoordinate{ mesh.TextureCoordinates.empty() ?
+                    Eigen::Vector2f::Zero() : mesh.TextureCoordinates.at(textureCoordinateIndex) };
+                vertices.insert(vertices.end(), { position.x(), position.y(), position.z(),
+                    textureCoordinate.x(), textureCoordinate.y() });
+            }
+            indices.push_back(welded->second);
+        }
+    }
+
+    PackedMesh packed;
+    if (!isQuantized || vertices.empty())
+    {
+        packed.Offset.fill(0.0f);
+        packed.Scale.fill(1.0f);
+        StoreStreams(packed, std::move(vertices), std::move(indices));
+        return packed;
+    }
+    for (size_t component{ 0 }; component < c_vertexStride; ++component)
+    {
+        auto min{ vertices.at(component) };
+        auto max{ vertices.at(component) };
+        for (size_t i{ component }; i < vertices.size(); i += c_vertexStride)
+        {
+            min = std::min(min, vertices.at(i));
+            max = std::max(max, vertices.at(i));
+        }
+        packed.Offset.at(component) = min;
+        packed.Scale.at(component) = (max - min) / c_maxQuantizedValue;
+    }
+    std::vector<uint16_t> quantized(vertices.size());
+    for (size_t i{ 0 }; i < vertices.size(); ++i)
+    {
+        auto const component{ i % c_vertexStride };
+        auto const scale{ packed.Scale.at(component) };
+        quantized.at(i) = (scale > 0.0f) ? static_cast<uint16_t>(std::lround(std::clamp(
+            (vertices.at(i) - packed.Offset.at(component)) / scale, 0.0f,
+            c_maxQuantizedValue))) : 0;
+    }
+    StoreStreams(packed, std::move(quantized), std::move(indices));
+    return packed;
+}
+}
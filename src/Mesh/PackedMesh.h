@@ -0,0 +1,34 @@
+#pragma once
+#include <variant>
+
+struct Mesh;
+
+namespace game
+{
+// Compact form of a mesh that the renderer draws from. Every distinct pairing of position
+// and texture coordinate becomes one vertex of a single interleaved stream of X, Y, Z, U, V,
+// and faces are triples of indices into it, 16-bit wherever the vertex count allows. The
+// stream can also be quantized to 16-bit integers, mapped back through a per-mesh offset
+// and scale for each component. The streams may live in memory of the mesh's own or in a
+// file mapped into memory.
+struct PackedMesh
+{
+    static constexpr size_t c_vertexStride{ 5 };
+    using VertexComponents = std::array<float, c_vertexStride>;
+
+    std::variant<std::span<float const>, std::span<uint16_t const>> Vertices;
+    std::variant<std::span<uint16_t const>, std::span<uint32_t const>> Indices;
+    // Keeps whatever the streams point into alive
+    std::shared_ptr<void const> Storage;
+    // Each stored component stands for Offset + (Scale * value)
+    VertexComponents Offset{};
+    VertexComponents Scale{};
+
+    size_t VertexCount() const;
+    size_t TriangleCount() const;
+    // Bytes held by the vertex and index streams
+    size_t MemoryUsage() const;
+
+    static PackedMesh FromMesh(Mesh const& mesh, bool isQuantized);
+};
+}
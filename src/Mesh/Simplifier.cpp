@@ -0,0 +1,441 @@
+#include <pch.h>
+#include <queue>
+#include "Simplifier.h"
+
+namespace
+{
+    // Each level aims for this fraction of the faces of the level before it
+    constexpr float c_levelFaceRatio{ 0.5f };
+    // No level is built with fewer faces than this
+    constexpr size_t c_minimumFaceCount{ 16 };
+    // A level is only kept if it has at most this fraction of the faces of the level
+    // before it; otherwise the simplifier has run out of edges it is allowed to collapse
+    constexpr float c_maximumLevelFaceRatio{ 0.75f };
+    // Collapses that turn any remaining face further than this (as the cosine of the angle
+    // between its old and new normals) are rejected, so the surface can't fold over
+    constexpr float c_minimumNormalAlignment{ 0.2f };
+
+    // Moving one end of an edge onto the other, removing the faces along the edge
+    struct EdgeCollapse
+    {
+        double Cost;
+        size_t From;
+        size_t To;
+        // Versions of both vertices when the cost was worked out; if either has changed
+        // since, the collapse is stale
+        uint32_t FromVersion;
+        uint32_t ToVersion;
+
+        bool operator>(EdgeCollapse const& other) const
+        {
+            return Cost > other.Cost;
+        }
+    };
+
+    // Pairs of texture coordinate indices, from the ones used at a vertex being collapsed
+    // to the ones used at the vertex it collapses onto
+    using TextureCoordinateMapping = std::vector<std::pair<size_t, size_t>>;
+
+    struct MeshSimplifier
+    {
+        explicit MeshSimplifier(Mesh const& mesh) :
+            m_mesh{ mesh }, m_faces{ mesh.Faces }, m_isFaceRemoved(mesh.Faces.size(), false),
+            m_vertexFaces(mesh.Vertices.size()),
+            m_quadrics(mesh.Vertices.size(), Eigen::Matrix4d::Zero()),
+            m_planeCounts(mesh.Vertices.size(), 0.0),
+            m_versions(mesh.Vertices.size(), 0), m_faceCount{ mesh.Faces.size() }
+        {
+            for (size_t i{ 0 }; i < m_faces.size(); ++i)
+            {
+                auto const& indices{ m_faces.at(i).MeshVertexIndices };
+                for (auto index : indices)
+                {
+                    m_vertexFaces.at(index).push_back(i);
+                }
+                // Each vertex starts out with the sum of the squared distance to the plane
+                // of each face around it
+                Eigen::Vector3d const a{ mesh.Vertices.at(indices.at(0)).cast<double>() };
+                Eigen::Vector3d const b{ mesh.Vertices.at(indices.at(1)).cast<double>() };
+                Eigen::Vector3d const c{ mesh.Vertices.at(indices.at(2)).cast<double>() };
+                Eigen::Vector3d normal{ (b - a).cross(c - a) };
+                if (normal.isZero())
+                {
+                    continue;
+                }
+                normal.normalize();
+                Eigen::Vector4d const plane{ normal.x(), normal.y(), normal.z(), -normal.dot(a) };
+                Eigen::Matrix4d const quadric{ plane * plane.transpose() };
+                for (auto index : indices)
+                {
+                    m_quadrics.at(index) += quadric;
+                    m_planeCounts.at(index) += 1.0;
+                }
+            }
+            for (size_t i{ 0 }; i < mesh.Vertices.size(); ++i)
+            {
+                QueueCollapses(i);
+            }
+        }
+
+        // Collapses the cheapest edges until no more than targetFaceCount faces are left or
+        // no edge can be collapsed
+        void Simplify(size_t targetFaceCount)
+        {
+            while ((m_faceCount > targetFaceCount) && !m_collapses.empty())
+            {
+                auto const collapse{ m_collapses.top() };
+                m_collapses.pop();
+                if ((m_versions.at(collapse.From) == collapse.FromVersion) &&
+                    (m_versions.at(collapse.To) == collapse.ToVersion))
+                {
+                    Collapse(collapse);
+                }
+            }
+        }
+
+        size_t FaceCount() const
+        {
+            return m_faceCount;
+        }
+
+        // Largest distance any collapse so far has moved the surface by, taken as the root
+        // mean square distance from the vertex it kept to the planes of the faces it replaced
+        float Error() const
+        {
+            return static_cast<float>(m_maxError);
+        }
+
+        std::shared_ptr<Mesh> ToMesh() const
+        {
+            std::vector<Eigen::Vector3f> vertices;
+            std::vector<Eigen::Vector2f> textureCoordinates;
+            std::vector<MeshFace> faces;
+            std::vector<size_t> vertexIndices(m_mesh.Vertices.size(), SIZE_MAX);
+            std::vector<size_t> textureCoordinateIndices(m_mesh.TextureCoordinates.size(),
+                SIZE_MAX);
+            for (size_t i{ 0 }; i < m_faces.size(); ++i)
+            {
+                if (m_isFaceRemoved.at(i))
+                {
+                    continue;
+                }
+                auto face{ m_faces.at(i) };
+                for (size_t corner{ 0 }; corner < face.MeshVertexIndices.size(); ++corner)
+                {
+                    auto& vertexIndex{ face.MeshVertexIndices.at(corner) };
+                    if (vertexIndices.at(vertexIndex) == SIZE_MAX)
+                    {
+                        vertexIndices.at(vertexIndex) = vertices.size();
+                        vertices.push_back(m_mesh.Vertices.at(vertexIndex));
+                    }
+                    vertexIndex = vertexIndices.at(vertexIndex);
+                    auto& textureCoordinateIndex{ face.MeshTextureCoordinateIndices.at(corner) };
+                    if (textureCoordinateIndices.at(textureCoordinateIndex) == SIZE_MAX)
+                    {
+                        textureCoordinateIndices.at(textureCoordinateIndex) =
+                            textureCoordinates.size();
+                        textureCoordinates.push_back(
+                            m_mesh.TextureCoordinates.at(textureCoordinateIndex));
+                    }
+                    textureCoordinateIndex = textureCoordinateIndices.at(textureCoordinateIndex);
+                }
+                faces.push_back(face);
+            }
+            auto bounds{ MeshBounds::FromVertices(vertices) };
+            return std::make_shared<Mesh>(std::move(vertices), std::move(textureCoordinates),
+                std::move(faces), m_mesh.Texture, bounds);
+        }
+
+    private:
+        Mesh const& m_mesh;
+        std::vector<MeshFace> m_faces;
+        std::vector<bool> m_isFaceRemoved;
+        // Faces around each vertex. May still list faces that have since been removed.
+        std::vector<std::vector<size_t>> m_vertexFaces;
+        std::vector<Eigen::Matrix4d> m_quadrics;
+        // Number of face planes summed into each quadric
+        std::vector<double> m_planeCounts;
+        // Bumped whenever the faces around a vertex change
+        std::vector<uint32_t> m_versions;
+        std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, std::greater<>> m_collapses;
+        size_t m_faceCount;
+        double m_maxError{ 0.0 };
+
+        static bool HasVertex(MeshFace const& face, size_t vertex)
+        {
+            return std::find(face.MeshVertexIndices.begin(), face.MeshVertexIndices.end(),
+                vertex) != face.MeshVertexIndices.end();
+        }
+
+        static size_t TextureCoordinateOf(MeshFace const& face, size_t vertex)
+        {
+            auto const corner{ std::find(face.MeshVertexIndices.begin(),
+                face.MeshVertexIndices.end(), vertex) - face.MeshVertexIndices.begin() };
+            return face.MeshTextureCoordinateIndices.at(corner);
+        }
+
+        std::vector<size_t> FacesAround(size_t vertex) const
+        {
+            std::vector<size_t> faces;
+            for (auto face : m_vertexFaces.at(vertex))
+            {
+                if (!m_isFaceRemoved.at(face))
+                {
+                    faces.push_back(face);
+                }
+            }
+            return faces;
+        }
+
+        std::vector<size_t> Neighbours(size_t vertex) const
+        {
+            std::vector<size_t> neighbours;
+            for (auto face : FacesAround(vertex))
+            {
+                for (auto index : m_faces.at(face).MeshVertexIndices)
+                {
+                    if (index != vertex)
+                    {
+                        neighbours.push_back(index);
+                    }
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+            return neighbours;
+        }
+
+        // Vertices on an open or non-manifold edge must stay put, or collapsing them would
+        // eat into the outline of the mesh
+        bool IsLocked(size_t vertex) const
+        {
+            auto const faces{ FacesAround(vertex) };
+            if (faces.empty())
+            {
+                return true;
+            }
+            for (auto neighbour : Neighbours(vertex))
+            {
+                auto const sharedFaceCount{ std::count_if(faces.begin(), faces.end(),
+                    [this, neighbour](size_t face)
+                    {
+                        return HasVertex(m_faces.at(face), neighbour);
+                    }) };
+                if (sharedFaceCount != 2)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // The texture coordinate each corner at 'from' takes once it has moved to 'to'. A
+        // face on either side of the edge keeps the texture coordinate 'to' has on that side,
+        // so 'from' can only be moved along a UV seam (or away from one), never across it,
+        // and every texture coordinate of 'from' must border the edge.
+        std::optional<TextureCoordinateMapping> MapTextureCoordinates(size_t from, size_t to) const
+        {
+            TextureCoordinateMapping mapping;
+            for (auto face : FacesAround(from))
+            {
+                if (!HasVertex(m_faces.at(face), to))
+                {
+                    continue;
+                }
+                std::pair const corner{ TextureCoordinateOf(m_faces.at(face), from),
+                    TextureCoordinateOf(m_faces.at(face), to) };
+                auto const existing{ std::find_if(mapping.begin(), mapping.end(),
+                    [&corner](auto const& mapped) { return mapped.first == corner.first; }) };
+                if (existing == mapping.end())
+                {
+                    mapping.push_back(corner);
+                }
+                else if (existing->second != corner.second)
+                {
+                    return std::nullopt;
+                }
+            }
+            for (auto face : FacesAround(from))
+            {
+                auto const textureCoordinate{ TextureCoordinateOf(m_faces.at(face), from) };
+                if (std::none_of(mapping.begin(), mapping.end(),
+                    [textureCoordinate](auto const& mapped)
+                    {
+                        return mapped.first == textureCoordinate;
+                    }))
+                {
+                    return std::nullopt;
+                }
+            }
+            return mapping;
+        }
+
+        std::optional<double> CollapseCost(size_t from, size_t to) const
+        {
+            if (IsLocked(from) || !MapTextureCoordinates(from, to))
+            {
+                return std::nullopt;
+            }
+
+            // Only the two vertices opposite the edge may neighbour both ends, or the
+            // collapse would pinch the surface into a non-manifold shape
+            auto const fromNeighbours{ Neighbours(from) };
+            auto const toNeighbours{ Neighbours(to) };
+            std::vector<size_t> commonNeighbours;
+            std::set_intersection(fromNeighbours.begin(), fromNeighbours.end(),
+                toNeighbours.begin(), toNeighbours.end(), std::back_inserter(commonNeighbours));
+            if (commonNeighbours.size() != 2)
+            {
+                return std::nullopt;
+            }
+
+            auto const& target{ m_mesh.Vertices.at(to) };
+            for (auto face : FacesAround(from))
+            {
+                auto const& indices{ m_faces.at(face).MeshVertexIndices };
+                if (HasVertex(m_faces.at(face), to))
+                {
+                    continue;
+                }
+                std::array<Eigen::Vector3f, 3> corners;
+                std::array<Eigen::Vector3f, 3> movedCorners;
+                for (size_t i{ 0 }; i < indices.size(); ++i)
+                {
+                    corners.at(i) = m_mesh.Vertices.at(indices.at(i));
+                    movedCorners.at(i) = (indices.at(i) == from) ? target : corners.at(i);
+                }
+                Eigen::Vector3f const normal{ (corners.at(1) - corners.at(0)).cross(
+                    corners.at(2) - corners.at(0)) };
+                Eigen::Vector3f const movedNormal{ (movedCorners.at(1) -
+                    movedCorners.at(0)).cross(movedCorners.at(2) - movedCorners.at(0)) };
+                if (movedNormal.isZero() || normal.isZero() ||
+                    (normal.normalized().dot(movedNormal.normalized()) < c_minimumNormalAlignment))
+                {
+                    return std::nullopt;
+                }
+            }
+
+            Eigen::Vector4d const position{ target.cast<double>().homogeneous() };
+            return std::max(0.0,
+                position.dot((m_quadrics.at(from) + m_quadrics.at(to)) * position));
+        }
+
+        void QueueCollapses(size_t vertex)
+        {
+            for (auto neighbour : Neighbours(vertex))
+            {
+                if (auto const cost{ CollapseCost(vertex, neighbour) })
+                {
+                    m_collapses.push(EdgeCollapse{ *cost, vertex, neighbour,
+                        m_versions.at(vertex), m_versions.at(neighbour) });
+                }
+            }
+        }
+
+        void Collapse(EdgeCollapse const& collapse)
+        {
+            auto const from{ collapse.From };
+            auto const to{ collapse.To };
+            auto const mapping{ *MapTextureCoordinates(from, to) };
+            auto const faces{ FacesAround(from) };
+            for (auto face : faces)
+            {
+                if (HasVertex(m_faces.at(face), to))
+                {
+                    m_isFaceRemoved.at(face) = true;
+                    --m_faceCount;
+                }
+            }
+            for (auto face : faces)
+            {
+                if (m_isFaceRemoved.at(face))
+                {
+                    continue;
+                }
+                auto& meshFace{ m_faces.at(face) };
+                for (size_t corner{ 0 }; corner < meshFace.MeshVertexIndices.size(); ++corner)
+                {
+                    if (meshFace.MeshVertexIndices.at(corner) == from)
+                    {
+                        auto& textureCoordinate{ meshFace.MeshTextureCoordinateIndices.at(corner) };
+                        meshFace.MeshVertexIndices.at(corner) = to;
+                        textureCoordinate = std::find_if(mapping.begin(), mapping.end(),
+                            [textureCoordinate](auto const& mapped)
+                            {
+                                return mapped.first == textureCoordinate;
+                            })->second;
+                    }
+                }
+                m_vertexFaces.at(to).push_back(face);
+            }
+            m_vertexFaces.at(from).clear();
+            m_vertexFaces.at(to) = FacesAround(to);
+            m_quadrics.at(to) += m_quadrics.at(from);
+            m_planeCounts.at(to) += m_planeCounts.at(from);
+            if (m_planeCounts.at(to) > 0.0)
+            {
+                m_maxError = std::max(m_maxError, std::sqrt(collapse.Cost / m_planeCounts.at(to)));
+            }
+
+            // Every vertex whose surrounding faces just changed needs its collapses redone
+            auto affected{ Neighbours(to) };
+            affected.push_back(to);
+            ++m_versions.at(from);
+            for (auto vertex : affected)
+            {
+                ++m_versions.at(vertex);
+            }
+            for (auto vertex : affected)
+            {
+                QueueCollapses(vertex);
+            }
+        }
+    };
+}
+
+namespace game
+{
+std::vector<MeshLevelOfDetail> SimplifyMesh(Mesh const& mesh)
+{
+    std::vector<MeshLevelOfDetail> levels;
+    if (mesh.Faces.empty())
+    {
+        return levels;
+    }
+    // Seams are found from the texture coordinates, so every corner needs one. Faces read
+    // without any are given index 0, which names nothing when the file had none at all.
+    bool const hasTextureCoordinates{ std::ranges::all_of(mesh.Faces,
+        [&mesh](MeshFace const& face)
+        {
+            return std::ranges::all_of(face.MeshTextureCoordinateIndices,
+                [&mesh](size_t index) { return index < mesh.TextureCoordinates.size(); });
+        }) };
+    if (!hasTextureCoordinates)
+    {
+        SPDLOG_WARN("Mesh lacks texture coordinates, not generating levels of detail");
+        return levels;
+    }
+    MeshSimplifier simplifier{ mesh };
+    auto previousFaceCount{ mesh.Faces.size() };
+    while (true)
+    {
+        auto const targetFaceCount{ static_cast<size_t>(
+            static_cast<float>(previousFaceCount) * c_levelFaceRatio) };
+        if (targetFaceCount < c_minimumFaceCount)
+        {
+            break;
+        }
+        simplifier.Simplify(targetFaceCount);
+        if (static_cast<float>(simplifier.FaceCount()) >
+            (static_cast<float>(previousFaceCount) * c_maximumLevelFaceRatio))
+        {
+            break;
+        }
+        levels.push_back(MeshLevelOfDetail{ simplifier.ToMesh(), simplifier.Error() });
+        previousFaceCount = simplifier.FaceCount();
+    }
+    SPDLOG_INFO("Simplified mesh of {} faces into {} levels of detail, the coarsest with {} faces",
+        mesh.Faces.size(), levels.size(), previousFaceCount);
+    return levels;
+}
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include "Mesh.h"
+
+namespace game
+{
+// Builds a chain of simplified versions of a mesh, each with roughly half the faces of the
+// one before, by greedily collapsing the edges whose removal moves the surface the least
+// as measured by quadric error. Vertices on UV seams and open borders stay where they
+// are, so the texture mapping and silhouette edges of the mesh hold up as it is reduced.
+std::vector<MeshLevelOfDetail> SimplifyMesh(Mesh const& mesh);
+}
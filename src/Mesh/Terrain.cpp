@@ -0,0 +1,401 @@
+#include <pch.h>
+#include "Terrain.h"
+
+namespace
+{
+    // How far a vertex may sit from its ideal grid position, as a fraction of a grid cell
+    constexpr float c_maxGridJitter{ 0.45f };
+
+    // Extra depth given to skirts beyond the error they cover, as a fraction of a grid cell,
+    // so they still overlap their neighbours after rounding
+    constexpr float c_skirtMargin{ 0.1f };
+
+    struct HeightfieldGrid
+    {
+        // Vertices along each side
+        size_t Size;
+        // Row-major by Z, then X
+        std::vector<Eigen::Vector3f> Positions;
+        std::vector<Eigen::Vector2f> TextureCoordinates;
+        // Side of the surface that faces the viewer. Faces are front-facing where the cross
+        // product of their edges points towards the camera, so this follows the winding of
+        // the source mesh rather than assuming which way Y points.
+        Eigen::Vector3f Up;
+
+        size_t Index(size_t x, size_t z) const
+        {
+            return (z * Size) + x;
+        }
+    };
+
+    std::optional<HeightfieldGrid> GridFromMesh(Mesh const& mesh)
+    {
+        auto const size{ static_cast<size_t>(std::lround(std::sqrt(mesh.Vertices.size()))) };
+        if ((size < 2) || ((size * size) != mesh.Vertices.size()) ||
+            mesh.TextureCoordinates.empty())
+        {
+            return std::nullopt;
+        }
+        Eigen::Vector3f const cellSize{ (mesh.Bounds.Max - mesh.Bounds.Min) /
+            static_cast<float>(size - 1) };
+        if ((cellSize.x() <= 0.0f) || (cellSize.z() <= 0.0f))
+        {
+            return std::nullopt;
+        }
+
+        HeightfieldGrid grid{ size, std::vector<Eigen::Vector3f>(size * size),
+            std::vector<Eigen::Vector2f>(size * size), Eigen::Vector3f::UnitY() };
+        std::vector<size_t> gridIndices(mesh.Vertices.size());
+        std::vector<bool> isPositionSet(size * size, false);
+        for (size_t i{ 0 }; i < mesh.Vertices.size(); ++i)
+        {
+            auto const& vertex{ mesh.Vertices.at(i) };
+            float const gridX{ (vertex.x() - mesh.Bounds.Min.x()) / cellSize.x() };
+            float const gridZ{ (vertex.z() - mesh.Bounds.Min.z()) / cellSize.z() };
+            auto const x{ static_cast<size_t>(std::lround(gridX)) };
+            auto const z{ static_cast<size_t>(std::lround(gridZ)) };
+            if ((std::abs(gridX - static_cast<float>(x)) > c_maxGridJitter) ||
+                (std::abs(gridZ - static_cast<float>(z)) > c_maxGridJitter) ||
+                isPositionSet.at(grid.Index(x, z)))
+            {
+                return std::nullopt;
+            }
+            gridIndices.at(i) = grid.Index(x, z);
+            grid.Positions.at(grid.Index(x, z)) = vertex;
+            isPositionSet.at(grid.Index(x, z)) = true;
+        }
+
+        // Every vertex needs exactly one texture coordinate; a UV seam can't be a grid
+        std::vector<bool> isTextureCoordinateSet(size * size, false);
+        float upwardFacing{ 0.0f };
+        for (auto const& face : mesh.Faces)
+        {
+            for (size_t i{ 0 }; i < face.MeshVertexIndices.size(); ++i)
+            {
+                auto const gridIndex{ gridIndices.at(face.MeshVertexIndices.at(i)) };
+                auto const& textureCoordinate{ mesh.TextureCoordinates.at(
+                    face.MeshTextureCoordinateIndices.at(i)) };
+                if (isTextureCoordinateSet.at(gridIndex) &&
+                    (grid.TextureCoordinates.at(gridIndex) != textureCoordinate))
+                {
+                    return std::nullopt;
+                }
+                grid.TextureCoordinates.at(gridIndex) = textureCoordinate;
+                isTextureCoordinateSet.at(gridIndex) = true;
+            }
+            auto const& a{ mesh.Vertices.at(face.MeshVertexIndices.at(0)) };
+            auto const& b{ mesh.Vertices.at(face.MeshVertexIndices.at(1)) };
+            auto const& c{ mesh.Vertices.at(face.MeshVertexIndices.at(2)) };
+            upwardFacing += (b - a).cross(c - a).y();
+        }
+        if (std::find(isTextureCoordinateSet.begin(), isTextureCoordinateSet.end(), false) !=
+            isTextureCoordinateSet.end())
+        {
+            return std::nullopt;
+        }
+        if (upwardFacing < 0.0f)
+        {
+            grid.Up = -grid.Up;
+        }
+        return grid;
+    }
+
+    // Inclusive range of grid vertices covered by a chunk
+    struct ChunkRange
+    {
+        size_t X0;
+        size_t Z0;
+        size_t X1;
+        size_t Z1;
+    };
+
+    struct ChunkLevel
+    {
+        std::vector<Eigen::Vector3f> Vertices;
+        std::vector<Eigen::Vector2f> TextureCoordinates;
+        std::vector<MeshFace> Faces;
+    };
+
+    // Adds a triangle wound so that it faces the given direction
+    void AddTriangle(ChunkLevel& level, std::array<size_t, 3> indices,
+        Eigen::Vector3f const& front)
+    {
+        auto const& a{ level.Vertices.at(indices.at(0)) };
+        auto const& b{ level.Vertices.at(indices.at(1)) };
+        auto const& c{ level.Vertices.at(indices.at(2)) };
+        if ((b - a).cross(c - a).dot(front) < 0.0f)
+        {
+            std::swap(indices.at(1), indices.at(2));
+        }
+        level.Faces.push_back(MeshFace{ indices, indices, 0xFFFFFFFF });
+    }
+
+    // Height of the surface drawn with the given stride at a grid vertex. Cells are split
+    // along the diagonal from their (+X, 0) corner to their (0, +Z) corner.
+    float CoarseHeight(HeightfieldGrid const& grid, ChunkRange const& range, size_t stride,
+        size_t x, size_t z)
+    {
+        auto const cellX{ std::min((x - range.X0) / stride, ((range.X1 - range.X0) / stride) - 1) };
+        auto const cellZ{ std::min((z - range.Z0) / stride, ((range.Z1 - range.Z0) / stride) - 1) };
+        auto const x0{ range.X0 + (cellX * stride) };
+        auto const z0{ range.Z0 + (cellZ * stride) };
+        float const u{ static_cast<float>(x - x0) / static_cast<float>(stride) };
+        float const v{ static_cast<float>(z - z0) / static_cast<float>(stride) };
+        float const h00{ grid.Positions.at(grid.Index(x0, z0)).y() };
+        float const h10{ grid.Positions.at(grid.Index(x0 + stride, z0)).y() };
+        float const h01{ grid.Positions.at(grid.Index(x0, z0 + stride)).y() };
+        float const h11{ grid.Positions.at(grid.Index(x0 + stride, z0 + stride)).y() };
+        if ((u + v) <= 1.0f)
+        {
+            return h00 + (u * (h10 - h00)) + (v * (h01 - h00));
+        }
+        return h11 + ((1.0f - u) * (h01 - h11)) + ((1.0f - v) * (h10 - h11));
+    }
+
+    // Largest vertical distance between the full-detail surface and the one drawn with
+    // the given stride
+    float LevelError(HeightfieldGrid const& grid, ChunkRange const& range, size_t stride)
+    {
+        float error{ 0.0f };
+        for (auto z{ range.Z0 }; z <= range.Z1; ++z)
+        {
+            for (auto x{ range.X0 }; x <= range.X1; ++x)
+            {
+                error = std::max(error, std::abs(grid.Positions.at(grid.Index(x, z)).y() -
+                    CoarseHeight(grid, range, stride, x, z)));
+            }
+        }
+        return error;
+    }
+
+    // Sides of a chunk, in the order skirts are hung from them
+    enum class ChunkSide : size_t
+    {
+        NegativeZ,
+        PositiveZ,
+        NegativeX,
+        PositiveX,
+    };
+    constexpr size_t c_chunkSideCount{ 4 };
+
+    // Largest vertical distance between the full-detail grid line along one side of a chunk
+    // and the same line drawn with the given stride. Both chunks sharing a side draw it the
+    // same way at the same stride, so this is what a side can be off by at that stride.
+    float SideError(HeightfieldGrid const& grid, ChunkRange const& range, ChunkSide side,
+        size_t stride)
+    {
+        bool const isAlongX{ (side == ChunkSide::NegativeZ) || (side == ChunkSide::PositiveZ) };
+        auto const length{ isAlongX ? (range.X1 - range.X0) : (range.Z1 - range.Z0) };
+        auto const height{ [&](size_t k)
+            {
+                switch (side)
+                {
+                case ChunkSide::NegativeZ:
+                    return grid.Positions.at(grid.Index(range.X0 + k, range.Z0)).y();
+                case ChunkSide::PositiveZ:
+                    return grid.Positions.at(grid.Index(range.X0 + k, range.Z1)).y();
+                case ChunkSide::NegativeX:
+                    return grid.Positions.at(grid.Index(range.X0, range.Z0 + k)).y();
+                default:
+                    return grid.Positions.at(grid.Index(range.X1, range.Z0 + k)).y();
+                }
+            } };
+        float error{ 0.0f };
+        for (size_t k{ 0 }; k <= length; ++k)
+        {
+            auto const start{ std::min(k / stride, (length / stride) - 1) * stride };
+            float const t{ static_cast<float>(k - start) / static_cast<float>(stride) };
+            float const coarse{ height(start) + (t * (height(start + stride) - height(start))) };
+            error = std::max(error, std::abs(height(k) - coarse));
+        }
+        return error;
+    }
+
+    // How far to hang a skirt from each side; sides with no skirt are 0
+    using SkirtDepths = std::array<float, c_chunkSideCount>;
+
+    ChunkLevel BuildLevel(HeightfieldGrid const& grid, ChunkRange const& range, size_t stride,
+        SkirtDepths const& skirtDepths)
+    {
+        ChunkLevel level;
+        auto const countX{ ((range.X1 - range.X0) / stride) + 1 };
+        auto const countZ{ ((range.Z1 - range.Z0) / stride) + 1 };
+        for (size_t j{ 0 }; j < countZ; ++j)
+        {
+            for (size_t i{ 0 }; i < countX; ++i)
+            {
+                auto const gridIndex{ grid.Index(range.X0 + (i * stride),
+                    range.Z0 + (j * stride)) };
+                level.Vertices.push_back(grid.Positions.at(gridIndex));
+                level.TextureCoordinates.push_back(grid.TextureCoordinates.at(gridIndex));
+            }
+        }
+        auto const lattice{ [countX](size_t i, size_t j) { return (j * countX) + i; } };
+
+        for (size_t j{ 0 }; (j + 1) < countZ; ++j)
+        {
+            for (size_t i{ 0 }; (i + 1) < countX; ++i)
+            {
+                AddTriangle(level, { lattice(i, j), lattice(i + 1, j), lattice(i, j + 1) },
+                    grid.Up);
+                AddTriangle(level,
+                    { lattice(i + 1, j), lattice(i + 1, j + 1), lattice(i, j + 1) }, grid.Up);
+            }
+        }
+
+        auto const addSkirt{ [&](ChunkSide side, size_t count, auto const& latticeIndex,
+            Eigen::Vector3f const& outward)
+            {
+                float const skirtDepth{ skirtDepths.at(static_cast<size_t>(side)) };
+                if (skirtDepth <= 0.0f)
+                {
+                    return;
+                }
+                for (size_t k{ 0 }; (k + 1) < count; ++k)
+                {
+                    auto const topA{ latticeIndex(k) };
+                    auto const topB{ latticeIndex(k + 1) };
+                    auto const bottomA{ level.Vertices.size() };
+                    for (auto top : { topA, topB })
+                    {
+                        level.Vertices.push_back(level.Vertices.at(top) - (grid.Up * skirtDepth));
+                        level.TextureCoordinates.push_back(level.TextureCoordinates.at(top));
+                    }
+                    auto const bottomB{ bottomA + 1 };
+                    AddTriangle(level, { topA, topB, bottomB }, outward);
+                    AddTriangle(level, { topA, bottomB, bottomA }, outward);
+                }
+            } };
+        addSkirt(ChunkSide::NegativeZ, countX, [&](size_t k) { return lattice(k, 0); },
+            Eigen::Vector3f{ 0.0f, 0.0f, -1.0f });
+        addSkirt(ChunkSide::PositiveZ, countX, [&](size_t k) { return lattice(k, countZ - 1); },
+            Eigen::Vector3f{ 0.0f, 0.0f, 1.0f });
+        addSkirt(ChunkSide::NegativeX, countZ, [&](size_t k) { return lattice(0, k); },
+            Eigen::Vector3f{ -1.0f, 0.0f, 0.0f });
+        addSkirt(ChunkSide::PositiveX, countZ, [&](size_t k) { return lattice(countX - 1, k); },
+            Eigen::Vector3f{ 1.0f, 0.0f, 0.0f });
+        return level;
+    }
+
+    std::shared_ptr<Mesh> MeshFromLevel(ChunkLevel&& level, std::shared_ptr<PngTexture> texture)
+    {
+        auto bounds{ MeshBounds::FromVertices(level.Vertices) };
+        return std::make_shared<Mesh>(std::move(level.Vertices),
+            std::move(level.TextureCoordinates), std::move(level.Faces), texture, bounds);
+    }
+}
+
+namespace game
+{
+std::vector<std::shared_ptr<Mesh>> BuildTerrainChunks(Mesh const& heightfield,
+    uint16_t chunksPerSide)
+{
+    auto const grid{ GridFromMesh(heightfield) };
+    if (!grid)
+    {
+        SPDLOG_WARN("Mesh is not a regular heightfield grid, chunking it without levels of detail");
+        return heightfield.SplitIntoChunks(chunksPerSide);
+    }
+
+    auto const cellCount{ grid->Size - 1 };
+    auto const chunkCells{ std::max<size_t>(1, (cellCount + chunksPerSide - 1) / chunksPerSide) };
+    std::vector<ChunkRange> ranges;
+    for (size_t z0{ 0 }; z0 < cellCount; z0 += chunkCells)
+    {
+        for (size_t x0{ 0 }; x0 < cellCount; x0 += chunkCells)
+        {
+            ranges.push_back(ChunkRange{ x0, z0, std::min(x0 + chunkCells, cellCount),
+                std::min(z0 + chunkCells, cellCount) });
+        }
+    }
+
+    auto const chunksX{ (cellCount + chunkCells - 1) / chunkCells };
+
+    // Work out every level's stride and error first, since a skirt has to cover whichever
+    // level the neighbour on its side is drawn at
+    std::vector<std::vector<std::pair<size_t, float>>> chunkLevels;
+    for (auto const& range : ranges)
+    {
+        std::vector<std::pair<size_t, float>> levels{ { 1, 0.0f } };
+        for (size_t stride{ 2 }; (((range.X1 - range.X0) % stride) == 0) &&
+            (((range.Z1 - range.Z0) % stride) == 0); stride *= 2)
+        {
+            // A coarser level never claims to be more accurate than a finer one
+            float const error{ std::max(levels.back().second,
+                LevelError(*grid, range, stride)) };
+            levels.emplace_back(stride, error);
+        }
+        chunkLevels.push_back(std::move(levels));
+    }
+
+    float const cellSize{ (heightfield.Bounds.Max.x() - heightfield.Bounds.Min.x()) /
+        static_cast<float>(cellCount) };
+    std::vector<std::shared_ptr<Mesh>> chunks;
+    for (size_t i{ 0 }; i < ranges.size(); ++i)
+    {
+        auto const& range{ ranges.at(i) };
+        auto const& levels{ chunkLevels.at(i) };
+        // Chunks on the other side of each side; the terrain's own border has none and
+        // needs no skirt
+        std::array<std::optional<size_t>, c_chunkSideCount> neighbours;
+        if (range.Z0 > 0)
+        {
+            neighbours.at(static_cast<size_t>(ChunkSide::NegativeZ)) = i - chunksX;
+        }
+        if (range.Z1 < cellCount)
+        {
+            neighbours.at(static_cast<size_t>(ChunkSide::PositiveZ)) = i + chunksX;
+        }
+        if (range.X0 > 0)
+        {
+            neighbours.at(static_cast<size_t>(ChunkSide::NegativeX)) = i - 1;
+        }
+        if (range.X1 < cellCount)
+        {
+            neighbours.at(static_cast<size_t>(ChunkSide::PositiveX)) = i + 1;
+        }
+        // The most each shared side can be off by at whatever level its neighbour is drawn
+        SkirtDepths neighbourErrors{ };
+        for (size_t side{ 0 }; side < c_chunkSideCount; ++side)
+        {
+            if (!neighbours.at(side))
+            {
+                continue;
+            }
+            for (auto const& [stride, error] : chunkLevels.at(*neighbours.at(side)))
+            {
+                neighbourErrors.at(side) = std::max(neighbourErrors.at(side),
+                    SideError(*grid, range, static_cast<ChunkSide>(side), stride));
+            }
+        }
+
+        auto const buildLevel{ [&](size_t stride)
+            {
+                // The crack between this level and its neighbour is at most what either
+                // side is off by, so the skirt has to reach down that far
+                SkirtDepths skirtDepths{ };
+                for (size_t side{ 0 }; side < c_chunkSideCount; ++side)
+                {
+                    float const crack{ neighbourErrors.at(side) +
+                        SideError(*grid, range, static_cast<ChunkSide>(side), stride) };
+                    if (neighbours.at(side) && (crack > 0.0f))
+                    {
+                        skirtDepths.at(side) = crack + (cellSize * c_skirtMargin);
+                    }
+                }
+                return MeshFromLevel(BuildLevel(*grid, range, stride, skirtDepths),
+                    heightfield.Texture);
+            } };
+        auto chunk{ buildLevel(levels.front().first) };
+        for (size_t level{ 1 }; level < levels.size(); ++level)
+        {
+            chunk->LevelsOfDetail.push_back(MeshLevelOfDetail{
+                buildLevel(levels.at(level).first), levels.at(level).second });
+        }
+        chunks.push_back(chunk);
+    }
+    SPDLOG_INFO("Built {} terrain chunks of {}x{} cells with up to {} levels of detail",
+        chunks.size(), chunkCells, chunkCells, chunkLevels.front().size());
+    return chunks;
+}
+}
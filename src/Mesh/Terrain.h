@@ -0,0 +1,14 @@
+#pragma once
+#include "Mesh.h"
+
+namespace game
+{
+// Splits a heightfield mesh laid out on a regular X/Z grid into chunksPerSide x chunksPerSide
+// chunks, each with a chain of coarser levels of detail that skip every other grid line
+// of the one before. Every level hangs a skirt from each border it shares with another
+// chunk, as deep as the crack that can open there between this level and whichever level
+// the neighbour is drawn at. Borders that are drawn the same at every level get none.
+// Meshes that aren't such a grid are split into plain chunks without levels of detail.
+std::vector<std::shared_ptr<Mesh>> BuildTerrainChunks(Mesh const& heightfield,
+    uint16_t chunksPerSide);
+}
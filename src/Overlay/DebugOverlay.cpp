@@ -1,5 +1,6 @@
 #include <pch.h>
 #include "DebugOverlay.h"
+#include "../Renderer/RenderTarget.h"
 #include "../ResourceManager.h"
 
 namespace game
@@ -15,6 +16,26 @@ void DebugOverlay::Paint(RenderTarget* target, SimulationState const& /*simulati
         now - m_lastPaint) };
     auto fps{ 1'000'000 / paintDeltaTime.count() };
     m_textPainter->PaintText(target, 0, 0, fmt::format("FPS: {}", fps));
+    auto const statistics{ target->Statistics() };
+    m_textPainter->PaintText(target, 0, m_textPainter->LineHeight(),
+        fmt::format("BLOCKS REJECT {} ACCEPT {} PARTIAL {}", statistics.BlocksRejected,
+            statistics.BlocksAccepted, statistics.BlocksPartial));
+    m_textPainter->PaintText(target, 0, (m_textPainter->LineHeight() * 2),
+        fmt::format("OCCLUDED BLOCKS {} TRIANGLES {}", statistics.BlocksOccluded,
+            statistics.TrianglesOccluded));
+    float const overdraw{ static_cast<float>(statistics.PixelsWritten) /
+        static_cast<float>(target->Width * target->Height) };
+    m_textPainter->PaintText(target, 0, (m_textPainter->LineHeight() * 3),
+        fmt::format("OVERDRAW {:.2f}", overdraw));
+    m_textPainter->PaintText(target, 0, (m_textPainter->LineHeight() * 4),
+        fmt::format("CULLED MESHES {} FACES {}", statistics.MeshesCulled,
+            statistics.FacesCulled));
+    auto const residency{ ResourceManager::GetMeshStreamer().GetResidency() };
+    m_textPainter->PaintText(target, 0, (m_textPainter->LineHeight() * 5),
+        fmt::format("MESH LODS {}/{} LOADING {} KIB {}/{} PINNED {}",
+            residency.ResidentLevelCount, residency.StreamedLevelCount,
+            residency.LoadingLevelCount, residency.ResidentBytes / 1024,
+            residency.BudgetBytes / 1024, residency.PinnedBytes / 1024));
     m_lastPaint = now;
 }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <pch.h>
 #include "TextPainter.h"
 #include "../Renderer/RenderTarget.h"
+#include "../Texture/TextureCache.h"
 
 namespace
 {
@@ -74,7 +75,8 @@ namespace
         }
         char buf[c_maxFontFileStringLength]{ 0 };
         file.read(reinterpret_cast<char*>(&buf), blockSize);
-        fontData.TextureFileName = std::string{ buf, blockSize };
+        // Page names are null-terminated, and the terminator mustn't end up in the path
+        fontData.TextureFileName = std::string{ buf, strnlen(buf, blockSize) };
     }
 
     void LoadBitmapFontFileCharsBlock(std::ifstream& file, game::BitmapFontData& fontData,
@@ -167,7 +169,7 @@ namespace
 
     std::shared_ptr<PngTexture> LoadFontTexture(game::BitmapFontData const& fontData)
     {
-        return PngTexture::FromPngFile(fontData.TextureFileName);
+        return game::LoadCookedTexture(fontData.TextureFileName);
     }
 }
 
@@ -213,6 +215,11 @@ void TextPainter::PaintText(RenderTarget* target, uint16_t x, uint16_t y,
     }
 }
 
+uint16_t TextPainter::LineHeight() const
+{
+    return m_fontData.LineHeight;
+}
+
 TextPainter::TextPainter(std::filesystem::path fontFile) :
     m_fontData{ LoadBitmapFontData(fontFile) }, m_fontTexture{ LoadFontTexture(m_fontData) }
 { }
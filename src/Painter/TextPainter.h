@@ -35,6 +35,7 @@ struct TextPainter
 {
     static std::shared_ptr<TextPainter> FromBitmapFont(std::filesystem::path fontFile);
     void PaintText(RenderTarget* target, uint16_t x, uint16_t y, std::string_view text) const;
+    uint16_t LineHeight() const;
 
 private:
     TextPainter(std::filesystem::path fontFile);
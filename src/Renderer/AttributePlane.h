@@ -0,0 +1,75 @@
+#pragma once
+
+namespace game
+{
+// Triangles are traversed in screen-aligned square blocks of this many pixels. Attributes
+// are evaluated directly at the start of each block row and stepped within it, so a
+// pixel's value never depends on where traversal of the triangle started.
+constexpr int32_t c_rasterBlockSize{ 8 };
+
+// Screen-space plane equation of an attribute interpolated linearly across a triangle.
+struct AttributePlane
+{
+    AttributePlane(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+        Eigen::Vector4f const& vertC, float valueA, float valueB, float valueC) :
+        Origin{ vertA.head<2>() }, ValueAtOrigin{ valueA }
+    {
+        Eigen::Vector2f const ab{ vertB.head<2>() - vertA.head<2>() };
+        Eigen::Vector2f const ac{ vertC.head<2>() - vertA.head<2>() };
+        float const area{ CrossProduct2D(ab, ac) };
+        float const deltaB{ valueB - valueA };
+        float const deltaC{ valueC - valueA };
+        Dx = ((deltaB * ac.y()) - (deltaC * ab.y())) / area;
+        Dy = ((deltaC * ab.x()) - (deltaB * ac.x())) / area;
+        for (int32_t i{ 0 }; i < c_rasterBlockSize; ++i)
+        {
+            BlockOffsets.at(i) = Dx * static_cast<float>(i);
+        }
+    }
+
+    // Value at the first pixel of the block containing x, on row y
+    float BlockValue(int32_t blockX, int32_t y) const
+    {
+        return ValueAtOrigin + (Dx * (static_cast<float>(blockX) - Origin.x())) +
+            (Dy * (static_cast<float>(y) - Origin.y()));
+    }
+
+    // Largest value the plane takes over an inclusive rectangle of pixels
+    float MaxValue(int32_t x0, int32_t y0, int32_t x1, int32_t y1) const
+    {
+        return BlockValue(x0, y0) + std::max(0.0f, Dx * static_cast<float>(x1 - x0)) +
+            std::max(0.0f, Dy * static_cast<float>(y1 - y0));
+    }
+
+    Eigen::Vector2f Origin;
+    float ValueAtOrigin;
+    float Dx;
+    float Dy;
+    std::array<float, c_rasterBlockSize> BlockOffsets;
+};
+
+// Everything needed to texture any pixel of a triangle once it is known to be visible
+struct TriangleShading
+{
+    TriangleShading(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+        Eigen::Vector4f const& vertC, Eigen::Vector2f const& texA, Eigen::Vector2f const& texB,
+        Eigen::Vector2f const& texC, PngTexture* texture, uint32_t color) :
+        ReciprocalW{ vertA, vertB, vertC,
+            (1.0f / vertA.w()), (1.0f / vertB.w()), (1.0f / vertC.w()) },
+        UOverW{ vertA, vertB, vertC,
+            (texA.x() / vertA.w()), (texB.x() / vertB.w()), (texC.x() / vertC.w()) },
+        VOverW{ vertA, vertB, vertC,
+            ((1 - texA.y()) / vertA.w()), ((1 - texB.y()) / vertB.w()),
+            ((1 - texC.y()) / vertC.w()) },
+        Texture{ texture },
+        Color{ color }
+    { }
+
+    AttributePlane ReciprocalW;
+    AttributePlane UOverW;
+    AttributePlane VOverW;
+    // Untextured triangles are filled with Color instead
+    PngTexture* Texture;
+    uint32_t Color;
+};
+}
@@ -0,0 +1,53 @@
+#include <pch.h>
+#include "DrawList.h"
+
+namespace
+{
+    constexpr uint16_t c_depthBucketCount{ 1024 };
+}
+
+namespace game
+{
+DrawList::DrawList(float nearPlane) : m_nearPlane{ nearPlane },
+    m_bucketStarts(c_depthBucketCount + 1)
+{ }
+
+void DrawList::Add(RasterTriangle const& triangle)
+{
+    float const nearestW{ std::min({ triangle.Vertices.at(0).w(), triangle.Vertices.at(1).w(),
+        triangle.Vertices.at(2).w() }) };
+    float const farness{ std::clamp(1.0f - (m_nearPlane / nearestW), 0.0f, 1.0f) };
+    m_depthBuckets.push_back(static_cast<uint16_t>(std::min(
+        static_cast<uint32_t>(farness * c_depthBucketCount),
+        static_cast<uint32_t>(c_depthBucketCount - 1))));
+    m_triangles.push_back(triangle);
+}
+
+std::vector<RasterTriangle> const& DrawList::Sort()
+{
+    // Counting sort: size each bucket, turn the sizes into start offsets, then scatter
+    std::fill(m_bucketStarts.begin(), m_bucketStarts.end(), 0);
+    for (auto bucket : m_depthBuckets)
+    {
+        ++m_bucketStarts.at(bucket + 1);
+    }
+    for (size_t i{ 1 }; i < m_bucketStarts.size(); ++i)
+    {
+        m_bucketStarts.at(i) += m_bucketStarts.at(i - 1);
+    }
+    m_sortedTriangles.resize(m_triangles.size());
+    for (size_t i{ 0 }; i < m_triangles.size(); ++i)
+    {
+        m_sortedTriangles.at(m_bucketStarts.at(m_depthBuckets.at(i))++) = m_triangles.at(i);
+    }
+    return m_sortedTriangles;
+}
+
+void DrawList::Clear()
+{
+    // Keep the allocations around for the next frame
+    m_triangles.clear();
+    m_depthBuckets.clear();
+    m_sortedTriangles.clear();
+}
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "TileRasterizer.h"
+
+namespace game
+{
+// Triangles collected over a frame so they can be rasterized roughly front to back, letting
+// the depth buffer reject as much of the farther geometry as possible. Triangles are
+// bucketed by the nearest view-space depth of their vertices; the buckets are spaced evenly
+// in 1/depth like the depth buffer itself, so nearby geometry is ordered most finely.
+// Triangles in the same bucket keep the order they were added in.
+struct DrawList
+{
+    DrawList(float nearPlane);
+    void Add(RasterTriangle const& triangle);
+    // Puts the triangles in front-to-back order and returns them
+    std::vector<RasterTriangle> const& Sort();
+    void Clear();
+
+private:
+    float const m_nearPlane;
+    std::vector<RasterTriangle> m_triangles;
+    std::vector<uint16_t> m_depthBuckets;
+    std::vector<uint32_t> m_bucketStarts;
+    std::vector<RasterTriangle> m_sortedTriangles;
+};
+}
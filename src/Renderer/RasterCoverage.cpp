@@ -0,0 +1,117 @@
+#include <pch.h>
+#include "RasterCoverage.h"
+
+#ifdef GAME_HAS_X86_COVERAGE
+#include <immintrin.h>
+// MSVC allows intrinsics for any instruction set, GCC and Clang need each function that
+// uses them to opt in to the target.
+#ifdef _MSC_VER
+#define TARGET_SSE41
+#define TARGET_AVX2
+#else
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+    uint32_t SpanMask(int32_t count)
+    {
+        return (count >= game::c_maxCoverageSpan) ? 0xFFFFFFFFu : ((1u << count) - 1u);
+    }
+}
+
+namespace game
+{
+uint32_t CoverageScalar(EdgeValues const& start, EdgeValues const& step, int32_t count)
+{
+    uint32_t coverage{ 0 };
+    EdgeValues w{ start };
+    for (int32_t k{ 0 }; k < count; ++k)
+    {
+        // All three values are non-negative exactly when their bitwise OR has no sign bit
+        if ((w.at(0) | w.at(1) | w.at(2)) >= 0)
+        {
+            coverage |= (1u << k);
+        }
+        w.at(0) += step.at(0);
+        w.at(1) += step.at(1);
+        w.at(2) += step.at(2);
+    }
+    return coverage;
+}
+
+#ifdef GAME_HAS_X86_COVERAGE
+TARGET_SSE41 uint32_t CoverageSse41(EdgeValues const& start, EdgeValues const& step,
+    int32_t count)
+{
+    __m128i const laneIndex{ _mm_setr_epi32(0, 1, 2, 3) };
+    __m128i w0{ _mm_add_epi32(_mm_set1_epi32(start[0]),
+        _mm_mullo_epi32(laneIndex, _mm_set1_epi32(step[0]))) };
+    __m128i w1{ _mm_add_epi32(_mm_set1_epi32(start[1]),
+        _mm_mullo_epi32(laneIndex, _mm_set1_epi32(step[1]))) };
+    __m128i w2{ _mm_add_epi32(_mm_set1_epi32(start[2]),
+        _mm_mullo_epi32(laneIndex, _mm_set1_epi32(step[2]))) };
+    __m128i const step0{ _mm_set1_epi32(step[0] * 4) };
+    __m128i const step1{ _mm_set1_epi32(step[1] * 4) };
+    __m128i const step2{ _mm_set1_epi32(step[2] * 4) };
+
+    uint32_t outside{ 0 };
+    for (int32_t k{ 0 }; k < count; k += 4)
+    {
+        __m128i const combined{ _mm_or_si128(_mm_or_si128(w0, w1), w2) };
+        outside |= static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(combined))) << k;
+        w0 = _mm_add_epi32(w0, step0);
+        w1 = _mm_add_epi32(w1, step1);
+        w2 = _mm_add_epi32(w2, step2);
+    }
+    return ~outside & SpanMask(count);
+}
+
+TARGET_AVX2 uint32_t CoverageAvx2(EdgeValues const& start, EdgeValues const& step,
+    int32_t count)
+{
+    __m256i const laneIndex{ _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) };
+    __m256i w0{ _mm256_add_epi32(_mm256_set1_epi32(start[0]),
+        _mm256_mullo_epi32(laneIndex, _mm256_set1_epi32(step[0]))) };
+    __m256i w1{ _mm256_add_epi32(_mm256_set1_epi32(start[1]),
+        _mm256_mullo_epi32(laneIndex, _mm256_set1_epi32(step[1]))) };
+    __m256i w2{ _mm256_add_epi32(_mm256_set1_epi32(start[2]),
+        _mm256_mullo_epi32(laneIndex, _mm256_set1_epi32(step[2]))) };
+    __m256i const step0{ _mm256_set1_epi32(step[0] * 8) };
+    __m256i const step1{ _mm256_set1_epi32(step[1] * 8) };
+    __m256i const step2{ _mm256_set1_epi32(step[2] * 8) };
+
+    uint32_t outside{ 0 };
+    for (int32_t k{ 0 }; k < count; k += 8)
+    {
+        __m256i const combined{ _mm256_or_si256(_mm256_or_si256(w0, w1), w2) };
+        outside |= static_cast<uint32_t>(
+            _mm256_movemask_ps(_mm256_castsi256_ps(combined))) << k;
+        w0 = _mm256_add_epi32(w0, step0);
+        w1 = _mm256_add_epi32(w1, step1);
+        w2 = _mm256_add_epi32(w2, step2);
+    }
+    return ~outside & SpanMask(count);
+}
+#endif
+
+CoverageFunction SelectCoverageFunction()
+{
+#ifdef GAME_HAS_X86_COVERAGE
+    if (SDL_HasAVX2())
+    {
+        SPDLOG_INFO("Using AVX2 coverage kernel");
+        return &CoverageAvx2;
+    }
+    if (SDL_HasSSE41())
+    {
+        SPDLOG_INFO("Using SSE4.1 coverage kernel");
+        return &CoverageSse41;
+    }
+#endif
+    SPDLOG_INFO("Using scalar coverage kernel");
+    return &CoverageScalar;
+}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+namespace game
+{
+// The three edge function values of a triangle at one pixel, as raw 24.8 fixed-point values.
+// A pixel is covered when all three are non-negative. Top-left fill rule biasing is expected
+// to already be applied to these values.
+using EdgeValues = std::array<int32_t, 3>;
+
+// Edge values step by the raw span of a triangle edge along X or Y, so they can be stepped in
+// 32 bits as long as no edge spans this many pixels or more. Clipping keeps triangles within
+// that.
+constexpr int32_t c_maxEdgeSpan{ 1 << 18 };
+
+// Computes coverage for `count` (at most 32) consecutive pixels along a row, where pixel k has
+// edge values `start + (k * step)`. Returns a mask with bit k set when pixel k is covered.
+using CoverageFunction = uint32_t (*)(EdgeValues const& start, EdgeValues const& step,
+    int32_t count);
+
+constexpr int32_t c_maxCoverageSpan{ 32 };
+
+uint32_t CoverageScalar(EdgeValues const& start, EdgeValues const& step, int32_t count);
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GAME_HAS_X86_COVERAGE 1
+uint32_t CoverageSse41(EdgeValues const& start, EdgeValues const& step, int32_t count);
+uint32_t CoverageAvx2(EdgeValues const& start, EdgeValues const& step, int32_t count);
+#endif
+
+// Picks the widest coverage kernel the running CPU supports.
+CoverageFunction SelectCoverageFunction();
+}
@@ -5,14 +5,37 @@ namespace
 {
     constexpr uint32_t c_defaultBackgroundColor{ 0xFF88FFFF };
 
-    fpm::fixed_24_8 TriangleDeterminant(Eigen::Vector2<fpm::fixed_24_8> const& pointA,
+    // Edge function values at one point, as raw 24.8 fixed-point values. They are products of
+    // coordinate spans, which can outgrow the 32 bits of EdgeValues for triangles reaching
+    // into the guard band, so they are set up in 64 bits.
+    using WideEdgeValues = std::array<int64_t, 3>;
+
+    // Edges a partial block is entirely inside are clamped to this before their values are
+    // stepped across the block in 32 bits. It leaves room for a whole block's steps on both
+    // sides, so they stay positive and don't overflow.
+    constexpr int64_t c_clampedEdgeValue{ int64_t{ 1 } << 30 };
+    static_assert((int64_t{ 2 } * game::c_maxEdgeSpan * 256 * (game::c_rasterBlockSize - 1)) <
+        c_clampedEdgeValue);
+
+    // Multiplies two raw 24.8 fixed-point values in 64 bits, rounding as fpm::fixed_24_8
+    // does, so coverage comes out the same as it did with fixed_24_8 arithmetic
+    int64_t MultiplyFixed(int64_t a, int64_t b)
+    {
+        int64_t const value{ (a * b) / 128 };
+        return (value / 2) + (value % 2);
+    }
+
+    int64_t RawSpan(fpm::fixed_24_8 from, fpm::fixed_24_8 to)
+    {
+        return int64_t{ to.raw_value() } - from.raw_value();
+    }
+
+    int64_t TriangleDeterminant(Eigen::Vector2<fpm::fixed_24_8> const& pointA,
         Eigen::Vector2<fpm::fixed_24_8> const& pointB,
         Eigen::Vector2<fpm::fixed_24_8> const& pointC)
     {
-        Eigen::Vector2<fpm::fixed_24_8> const ab{ pointB - pointA };
-        Eigen::Vector2<fpm::fixed_24_8> const ac{ pointC - pointA };
-        fpm::fixed_24_8 det{((ab.y() * ac.x()) - (ab.x() * ac.y()))};
-        return det;
+        return MultiplyFixed(RawSpan(pointA.y(), pointB.y()), RawSpan(pointA.x(), pointC.x())) -
+            MultiplyFixed(RawSpan(pointA.x(), pointB.x()), RawSpan(pointA.y(), pointC.y()));
     }
 
     bool IsTriangleEdgeLeftOrTop(Eigen::Vector2<fpm::fixed_24_8> const& pointA,
@@ -25,44 +48,176 @@ namespace
         return (isLeftEdge || isTopEdge);
     }
 
-    Eigen::Vector3f BarycentricWeights(Eigen::Vector2f const& vertA, Eigen::Vector2f const& vertB,
-        Eigen::Vector2f const& vertC, Eigen::Vector2f const& point)
+    constexpr int32_t c_blockSize{ game::c_rasterBlockSize };
+
+    // The coarse level of the hierarchical depth buffer covers this many blocks on each side,
+    // which lines up with the tiles of the TileRasterizer.
+    constexpr int32_t c_hiZTileBlocks{ 8 };
+    constexpr int32_t c_hiZTileSize{ c_blockSize * c_hiZTileBlocks };
+
+    // Relative slack applied to a triangle's nearest 1/w before comparing it against the
+    // hierarchical depth buffer, covering rounding in the per-pixel interpolation.
+    constexpr float c_hiZTolerance{ 1.0e-5f };
+
+    uint16_t CellCount(uint16_t pixels, int32_t cellSize)
+    {
+        return static_cast<uint16_t>((pixels + cellSize - 1) / cellSize);
+    }
+
+    float NearestDepth(float largestReciprocalW)
     {
-        Eigen::Vector2f ac{ vertC - vertA };
-        Eigen::Vector2f ab{ vertB - vertA };
-        Eigen::Vector2f ap{ point - vertA };
-        Eigen::Vector2f pc{ vertC - point };
-        Eigen::Vector2f pb{ vertB - point };
+        return 1.0f - (largestReciprocalW + (std::abs(largestReciprocalW) * c_hiZTolerance));
+    }
+
+    // Marks pixels of the visibility buffer not covered by any triangle
+    constexpr uint32_t c_noVisibleTriangle{ std::numeric_limits<uint32_t>::max() };
 
-        float parallelogramAreaAbc{ game::CrossProduct2D(ac, ab) };
-        float alpha{ game::CrossProduct2D(pc, pb) / parallelogramAreaAbc };
-        float beta{ game::CrossProduct2D(ac, ap) / parallelogramAreaAbc };
-        float gamma{ 1.0f - alpha - beta };
+    constexpr uint32_t c_wireframeColor{ 0xFF00FF00 };
+
+    // How a permutation of the pipeline turns a texture coordinate into a texel column or row
+    enum class TexelAddressing : uint8_t
+    {
+        Repeat,
+        // Repeat, for textures whose sides are powers of two, which wrap with a mask
+        RepeatPowerOfTwo,
+        Clamp,
+    };
+    constexpr size_t c_texelAddressingCount{ 3 };
+
+    // Steps k for which start + (k * increment) lies in [low, high), widened by a step on each
+    // side to allow for the rounding of computing each step. The range is empty when its first
+    // step is after its last.
+    std::pair<float, float> StepRange(float start, float increment, float low, float high)
+    {
+        if (increment == 0.0f)
+        {
+            float const infinity{ std::numeric_limits<float>::infinity() };
+            return ((start >= low) && (start < high)) ? std::pair{ -infinity, infinity } :
+                std::pair{ infinity, -infinity };
+        }
+        float const lowStep{ (low - start) / increment };
+        float const highStep{ (high - start) / increment };
+        return { (std::min(lowStep, highStep) - 1.0f), (std::max(lowStep, highStep) + 1.0f) };
+    }
 
-        return Eigen::Vector3f{ alpha, beta, gamma };
+    // Rounds towards negative infinity, which a plain conversion only does for positive values
+    int32_t FloorToInt(float value)
+    {
+        auto const truncated{ static_cast<int32_t>(value) };
+        return truncated - static_cast<int32_t>(static_cast<float>(truncated) > value);
     }
 
-    inline float WrapUvValue(float const& uvCoord)
+    template<TexelAddressing Addressing>
+    uint16_t TexelCoordinate(float coordinate, uint16_t size)
     {
-        if (uvCoord > 1.0f)
+        if constexpr (Addressing == TexelAddressing::RepeatPowerOfTwo)
         {
-            return (uvCoord - std::trunc(uvCoord));
+            return static_cast<uint16_t>(FloorToInt(coordinate * size) & (size - 1));
         }
-        else if (uvCoord <= 0.0f)
+        else if constexpr (Addressing == TexelAddressing::Repeat)
         {
-            return 1.0f + (uvCoord - std::trunc(uvCoord));
+            // Some OBJ files use texture coordinates outside [0, 1] to tile their textures.
+            // The fraction is only scaled afterwards, and can round up to a whole texture.
+            float const fraction{ coordinate - static_cast<float>(FloorToInt(coordinate)) };
+            return std::min(static_cast<uint16_t>(fraction * size),
+                static_cast<uint16_t>(size - 1));
         }
         else
         {
-            return uvCoord;
+            return static_cast<uint16_t>(std::clamp(FloorToInt(coordinate * size), 0,
+                size - 1));
         }
     }
+
+    template<TexelAddressing Addressing>
+    uint32_t SampleTexel(PngTexture* texture, float reciprocalW, float uOverW, float vOverW,
+        size_t mipLevel)
+    {
+        float const w{ 1.0f / reciprocalW };
+        auto const& level{ texture->GetMipLevel(mipLevel) };
+        return texture->ColorAt(TexelCoordinate<Addressing>(uOverW * w, level.Width),
+            TexelCoordinate<Addressing>(vOverW * w, level.Height), mipLevel);
+    }
+
+    TexelAddressing SelectTexelAddressing(PngTexture* texture, game::PipelineState const& state)
+    {
+        if (state.Wrap == game::PipelineState::WrapMode::Clamp)
+        {
+            return TexelAddressing::Clamp;
+        }
+        // Every mip level of a texture with power of two sides has them too
+        bool const isPowerOfTwo{ (texture != nullptr) &&
+            std::has_single_bit(texture->Width()) && std::has_single_bit(texture->Height()) };
+        return isPowerOfTwo ? TexelAddressing::RepeatPowerOfTwo : TexelAddressing::Repeat;
+    }
+
+    // One combination of pipeline state, numbered by its place in the table of them all
+    template<size_t Index>
+    struct Permutation
+    {
+        static constexpr bool IsTextured{ (Index & 1) != 0 };
+        static constexpr bool IsDepthTested{ (Index & 2) != 0 };
+        static constexpr bool IsDepthWritten{ (Index & 4) != 0 };
+        static constexpr TexelAddressing Addressing{ static_cast<TexelAddressing>(Index >> 3) };
+    };
+    constexpr size_t c_permutationCount{ 8 * c_texelAddressingCount };
+
+    size_t PermutationIndex(bool isTextured, game::PipelineState const& state,
+        TexelAddressing addressing)
+    {
+        return (isTextured ? 1 : 0) | (state.IsDepthTested ? 2 : 0) |
+            (state.IsDepthWritten ? 4 : 0) | (static_cast<size_t>(addressing) << 3);
+    }
+
+    // The mip level whose texels come closest to the size of a pixel, at a point of a
+    // triangle with the given perspective-divided attributes. How far the texture
+    // coordinates move from one pixel to the next follows from the attribute planes'
+    // screen-space slopes, by the quotient rule.
+    size_t SelectMipLevel(game::TriangleShading const& shading, float reciprocalW,
+        float uOverW, float vOverW)
+    {
+        auto const levelCount{ shading.Texture->MipLevelCount() };
+        if ((levelCount == 1) || !(reciprocalW > 0.0f))
+        {
+            return 0;
+        }
+        float const w{ 1.0f / reciprocalW };
+        auto const slope{ [w](float valueOverW, float valueOverWSlope, float reciprocalWSlope)
+            {
+                return (valueOverWSlope - (valueOverW * w * reciprocalWSlope)) * w;
+            } };
+        auto const& baseLevel{ shading.Texture->GetMipLevel(0) };
+        auto const width{ static_cast<float>(baseLevel.Width) };
+        auto const height{ static_cast<float>(baseLevel.Height) };
+        auto const& reciprocalWPlane{ shading.ReciprocalW };
+        float const dudx{ slope(uOverW, shading.UOverW.Dx, reciprocalWPlane.Dx) * width };
+        float const dvdx{ slope(vOverW, shading.VOverW.Dx, reciprocalWPlane.Dx) * height };
+        float const dudy{ slope(uOverW, shading.UOverW.Dy, reciprocalWPlane.Dy) * width };
+        float const dvdy{ slope(vOverW, shading.VOverW.Dy, reciprocalWPlane.Dy) * height };
+        // Squared texels per pixel along whichever screen axis the texture is squeezed
+        // most, which also rejects NaN
+        float const footprint{ std::max((dudx * dudx) + (dvdx * dvdx),
+            (dudy * dudy) + (dvdy * dvdy)) };
+        if (!(footprint > 1.0f))
+        {
+            return 0;
+        }
+        // Rounds log2 of the texels per pixel to the nearest level: log2(sqrt(2 * f)) is
+        // log2(sqrt(f)) + 0.5, and ilogb floors log2
+        auto const level{ static_cast<size_t>(std::ilogb(2.0f * footprint) / 2) };
+        return std::min(level, levelCount - 1);
+    }
 }
 
 namespace game
 {
 RenderTarget::RenderTarget(uint16_t width, uint16_t height): Width{ width }, Height{ height },
-    Buffer((Width * Height), c_defaultBackgroundColor), ZBuffer((Width * Height), 1.0f)
+    Buffer((Width * Height), c_defaultBackgroundColor), ZBuffer((Width * Height), 1.0f),
+    m_coverageFunction{ SelectCoverageFunction() },
+    m_hiZBlockCountX{ CellCount(Width, c_blockSize) },
+    m_hiZBlocks((m_hiZBlockCountX * CellCount(Height, c_blockSize)), 1.0f),
+    m_hiZTileCountX{ CellCount(Width, c_hiZTileSize) },
+    m_hiZTiles((m_hiZTileCountX * CellCount(Height, c_hiZTileSize)), 1.0f)
 { }
 
 uint32_t const &RenderTarget::PixelAt(uint16_t x, uint16_t y)
@@ -88,53 +243,26 @@ void RenderTarget::DrawPixel(uint16_t x, uint16_t y, uint32_t color)
     Buffer.at((Width * y) + x) = color;
 }
 
-void RenderTarget::DrawTexel(uint16_t x, uint16_t y, PngTexture* texture,
-        Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB, Eigen::Vector4f const& vertC,
-        Eigen::Vector2f const& texA, Eigen::Vector2f const& texB, Eigen::Vector2f const& texC)
+bool RenderTarget::DrawVisibility(uint16_t x, uint16_t y, float reciprocalW, uint32_t triangleId)
 {
-    Eigen::Vector3f barycentricWeights{ BarycentricWeights(vertA.head<2>(), vertB.head<2>(),
-        vertC.head<2>(), Eigen::Vector2f{ x, y }) };
-    float const& alpha{ barycentricWeights.x() };
-    float const& beta{ barycentricWeights.y() };
-    float const& gamma{ barycentricWeights.z() };
-
-    float interpolatedReciprocalW{
-        (1.0f / vertA.w()) * alpha +
-        (1.0f / vertB.w()) * beta +
-        (1.0f / vertC.w()) * gamma };
+    // Same depth test as ForwardShader, so the same triangle ends up owning each pixel.
     // Adjust 1/w so closer pixels have smaller values.
-    float depthValue{ 1.0f - interpolatedReciprocalW };
-    // Only draw pixel if it's "closer to screen" than previous pixel
+    float depthValue{ 1.0f - reciprocalW };
     if (depthValue >= ZBuffer.at((Width * y) + x))
     {
-        return;
+        return false;
     }
 
-    float interpolatedU{ (texA.x() / vertA.w()) * alpha +
-        (texB.x() / vertB.w()) * beta + (texC.x() / vertC.w()) * gamma };
-    float interpolatedV{ ((1 - texA.y()) / vertA.w()) * alpha +
-        ((1 - texB.y()) / vertB.w()) * beta + ((1 - texC.y()) / vertC.w()) * gamma };
-    interpolatedU /= interpolatedReciprocalW;
-    interpolatedV /= interpolatedReciprocalW;
-
-    // Intelligently clamp with wraparound to [0, 1]
-    // (apparently some OBJ files use UV values <> 1 to 'wrap around')
-    interpolatedU = WrapUvValue(interpolatedU);
-    interpolatedV = WrapUvValue(interpolatedV);
-
-    uint16_t textureX{ std::clamp(static_cast<uint16_t>(interpolatedU * texture->Width()),
-        uint16_t{ 0 }, static_cast<uint16_t>(texture->Width() - 1)) };
-    uint16_t textureY{ std::clamp(static_cast<uint16_t>(interpolatedV * texture->Height()),
-        uint16_t{ 0 }, static_cast<uint16_t>(texture->Height() - 1)) };
-    uint32_t const& color{ texture->ColorAt(textureX, textureY) };
-
     ZBuffer.at((Width * y) + x) = depthValue;
-    DrawPixel(x, y, color);
+    m_visibilityBuffer.at((Width * y) + x) = triangleId;
+    return true;
 }
 
 void RenderTarget::ClearZBuffer()
 {
     std::fill(ZBuffer.begin(), ZBuffer.end(), 1.0f);
+    std::fill(m_hiZBlocks.begin(), m_hiZBlocks.end(), 1.0f);
+    std::fill(m_hiZTiles.begin(), m_hiZTiles.end(), 1.0f);
 }
 
 void RenderTarget::DrawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint32_t color)
@@ -153,6 +281,12 @@ void RenderTarget::DrawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t
 }
 
 void RenderTarget::DrawLine(Eigen::Vector2f const& inA, Eigen::Vector2f const& inB, uint32_t color)
+{
+    DrawLine(inA, inB, color, Bounds());
+}
+
+void RenderTarget::DrawLine(Eigen::Vector2f const& inA, Eigen::Vector2f const& inB, uint32_t color,
+    ScreenRect const& clipRect)
 {
     Eigen::Vector2f a{ inA };
     Eigen::Vector2f b{ inB };
@@ -166,23 +300,246 @@ void RenderTarget::DrawLine(Eigen::Vector2f const& inA, Eigen::Vector2f const& i
     float sideLength{ abs(deltaX) >= abs(deltaY) ?
         abs(deltaX) : abs(deltaY) };
 
-    float xIncrement{ deltaX / sideLength };
-    float yIncrement{ deltaY / sideLength };
+    float xIncrement{ (sideLength > 0.0f) ? (deltaX / sideLength) : 0.0f };
+    float yIncrement{ (sideLength > 0.0f) ? (deltaY / sideLength) : 0.0f };
 
-    float currentX{ a.x() };
-    float currentY{ a.y() };
-    for (size_t i{ 0 }; i <= static_cast<size_t>(sideLength); ++i)
+    // Lines may reach far into the guard band around the screen, so only the steps near the
+    // clip rectangle are walked. Steps up to a pixel past its far edges can still be clamped
+    // into it below.
+    auto const [firstStepX, lastStepX]{ StepRange(a.x(), xIncrement,
+        static_cast<float>(clipRect.MinX), (static_cast<float>(clipRect.MaxX) + 2.0f)) };
+    auto const [firstStepY, lastStepY]{ StepRange(a.y(), yIncrement,
+        static_cast<float>(clipRect.MinY), (static_cast<float>(clipRect.MaxY) + 2.0f)) };
+    float const firstStep{ std::max({ 0.0f, firstStepX, firstStepY }) };
+    float const lastStep{ std::min({ sideLength, lastStepX, lastStepY }) };
+    if (firstStep > lastStep)
     {
-        DrawPixel(static_cast<uint16_t>(currentX), static_cast<uint16_t>(currentY), color);
-        currentX += xIncrement;
-        currentY += yIncrement;
+        return;
     }
+
+    // Every step is placed from the start of the line rather than from the step before, so a
+    // line lands on the same pixels whichever clip rectangle its walk begins in
+    for (auto i{ static_cast<size_t>(firstStep) }; i <= static_cast<size_t>(lastStep); ++i)
+    {
+        float const currentX{ a.x() + (static_cast<float>(i) * xIncrement) };
+        float const currentY{ a.y() + (static_cast<float>(i) * yIncrement) };
+        // Skip steps that are off the target. Steps just past the far edges are clamped the
+        // same way DrawPixel does, then only the pixels inside the clip rectangle are kept.
+        bool const isOnTarget{ (currentX >= 0.0f) && (currentY >= 0.0f) &&
+            (currentX < static_cast<float>(Width + 1)) &&
+            (currentY < static_cast<float>(Height + 1)) };
+        auto x{ std::min(static_cast<uint16_t>(isOnTarget ? currentX : 0.0f),
+            static_cast<uint16_t>(Width - 1)) };
+        auto y{ std::min(static_cast<uint16_t>(isOnTarget ? currentY : 0.0f),
+            static_cast<uint16_t>(Height - 1)) };
+        if (isOnTarget && (x >= clipRect.MinX) && (x <= clipRect.MaxX) &&
+            (y >= clipRect.MinY) && (y <= clipRect.MaxY))
+        {
+            DrawPixel(x, y, color);
+            if (m_isRecordingVisibility)
+            {
+                // The line now covers whatever triangle was here, so the resolve must
+                // leave this pixel alone unless a later triangle is drawn over it.
+                m_visibilityBuffer.at((Width * y) + x) = c_noVisibleTriangle;
+            }
+        }
+    }
+}
+
+void RenderTarget::DrawTriangleEdges(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+    Eigen::Vector4f const& vertC, uint32_t color, ScreenRect const& clipRect)
+{
+    DrawLine(vertA.head<2>(), vertB.head<2>(), color, clipRect);
+    DrawLine(vertB.head<2>(), vertC.head<2>(), color, clipRect);
+    DrawLine(vertC.head<2>(), vertA.head<2>(), color, clipRect);
+}
+
+ScreenRect RenderTarget::Bounds() const
+{
+    return ScreenRect{ 0, 0, static_cast<uint16_t>(Width - 1), static_cast<uint16_t>(Height - 1) };
+}
+
+// Shades every pixel of a triangle as soon as it passes the depth test, with the state of
+// one permutation of the pipeline
+template<typename Permutation>
+struct RenderTarget::ForwardShader
+{
+    static constexpr bool IsDepthTested{ Permutation::IsDepthTested };
+    static constexpr bool IsDepthWritten{ Permutation::IsDepthWritten };
+
+    RenderTarget* const Target;
+    TriangleShading const Shading;
+    float RowReciprocalW{ 0.0f };
+    float RowUOverW{ 0.0f };
+    float RowVOverW{ 0.0f };
+    // Chosen once for each row of a block, which is as far as a pixel's neighbours can
+    // be from where it was chosen
+    size_t RowMipLevel{ 0 };
+
+    AttributePlane const& ReciprocalW() const
+    {
+        return Shading.ReciprocalW;
+    }
+
+    void BeginRow(int32_t blockX, int32_t y)
+    {
+        RowReciprocalW = Shading.ReciprocalW.BlockValue(blockX, y);
+        if constexpr (Permutation::IsTextured)
+        {
+            RowUOverW = Shading.UOverW.BlockValue(blockX, y);
+            RowVOverW = Shading.VOverW.BlockValue(blockX, y);
+            RowMipLevel = SelectMipLevel(Shading, RowReciprocalW, RowUOverW, RowVOverW);
+        }
+    }
+
+    bool ShadePixel(uint16_t x, uint16_t y, int32_t blockOffset)
+    {
+        auto const pixelIndex{ (Target->Width * y) + x };
+        float const reciprocalW{ RowReciprocalW + Shading.ReciprocalW.BlockOffsets[blockOffset] };
+        // Adjust 1/w so closer pixels have smaller values, and only draw pixels closer than
+        // what is already there
+        float const depthValue{ 1.0f - reciprocalW };
+        if constexpr (IsDepthTested)
+        {
+            if (depthValue >= Target->ZBuffer[pixelIndex])
+            {
+                return false;
+            }
+        }
+        if constexpr (IsDepthWritten)
+        {
+            Target->ZBuffer[pixelIndex] = depthValue;
+        }
+        if constexpr (Permutation::IsTextured)
+        {
+            Target->Buffer[pixelIndex] = SampleTexel<Permutation::Addressing>(Shading.Texture,
+                reciprocalW, RowUOverW + Shading.UOverW.BlockOffsets[blockOffset],
+                RowVOverW + Shading.VOverW.BlockOffsets[blockOffset], RowMipLevel);
+        }
+        else
+        {
+            Target->Buffer[pixelIndex] = Shading.Color;
+        }
+        return true;
+    }
+};
+
+// Only records which triangle is nearest at each pixel, leaving texturing to the resolve
+struct RenderTarget::VisibilityShader
+{
+    static constexpr bool IsDepthTested{ true };
+    static constexpr bool IsDepthWritten{ true };
+
+    RenderTarget* const Target;
+    AttributePlane const& ReciprocalWPlane;
+    uint32_t const TriangleId;
+    float RowReciprocalW{ 0.0f };
+
+    AttributePlane const& ReciprocalW() const
+    {
+        return ReciprocalWPlane;
+    }
+
+    void BeginRow(int32_t blockX, int32_t y)
+    {
+        RowReciprocalW = ReciprocalWPlane.BlockValue(blockX, y);
+    }
+
+    bool ShadePixel(uint16_t x, uint16_t y, int32_t blockOffset)
+    {
+        return Target->DrawVisibility(x, y,
+            RowReciprocalW + ReciprocalWPlane.BlockOffsets[blockOffset], TriangleId);
+    }
+};
+
+void RenderTarget::DrawShadedTriangle(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+    Eigen::Vector4f const& vertC, uint32_t color)
+{
+    DrawShadedTriangle(vertA, vertB, vertC, color, Bounds(), PipelineState{});
+}
+
+void RenderTarget::DrawShadedTriangle(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+    Eigen::Vector4f const& vertC, uint32_t color, ScreenRect const& clipRect,
+    PipelineState const& state)
+{
+    Eigen::Vector2f const noTexture{ Eigen::Vector2f::Zero() };
+    DrawTriangle(TriangleDraw{ { vertA, vertB, vertC }, { noTexture, noTexture, noTexture },
+        nullptr, color }, clipRect, state);
 }
 
 void RenderTarget::DrawTexturedTriangle(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
     Eigen::Vector4f const& vertC, Eigen::Vector2f const& texA, Eigen::Vector2f const& texB,
     Eigen::Vector2f const& texC, PngTexture* texture)
 {
+    DrawTexturedTriangle(vertA, vertB, vertC, texA, texB, texC, texture, Bounds());
+}
+
+void RenderTarget::DrawTexturedTriangle(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+    Eigen::Vector4f const& vertC, Eigen::Vector2f const& texA, Eigen::Vector2f const& texB,
+    Eigen::Vector2f const& texC, PngTexture* texture, ScreenRect const& clipRect,
+    PipelineState const& state)
+{
+    DrawTriangle(TriangleDraw{ { vertA, vertB, vertC }, { texA, texB, texC }, texture, 0 },
+        clipRect, state);
+}
+
+void RenderTarget::DrawTriangle(TriangleDraw const& triangle, ScreenRect const& clipRect,
+    PipelineState const& state)
+{
+    static constexpr auto c_drawFunctions{ []<size_t... Indices>(
+        std::index_sequence<Indices...>)
+        {
+            return std::array<DrawFunction, sizeof...(Indices)>{
+                &RenderTarget::DrawPermutation<Permutation<Indices>>... };
+        }(std::make_index_sequence<c_permutationCount>{}) };
+    bool const isTextured{ triangle.Texture != nullptr };
+    // Flat triangles never sample, so their wrap mode is irrelevant
+    auto const addressing{ isTextured ? SelectTexelAddressing(triangle.Texture, state) :
+        TexelAddressing::Repeat };
+    (this->*c_drawFunctions[PermutationIndex(isTextured, state, addressing)])(triangle,
+        clipRect);
+    // The outline is drawn after the fill, so it changes nothing inside the pixel loop
+    if (state.IsWireframe)
+    {
+        auto const& [vertA, vertB, vertC]{ triangle.Vertices };
+        DrawTriangleEdges(vertA, vertB, vertC, c_wireframeColor, clipRect);
+    }
+}
+
+template<typename Permutation>
+void RenderTarget::DrawPermutation(TriangleDraw const& triangle, ScreenRect const& clipRect)
+{
+    auto const& [vertA, vertB, vertC]{ triangle.Vertices };
+    auto const& [texA, texB, texC]{ triangle.TextureCoordinates };
+    RasterizeTriangle(vertA, vertB, vertC, clipRect, [&]()
+        {
+            return ForwardShader<Permutation>{ this,
+                TriangleShading{ vertA, vertB, vertC, texA, texB, texC, triangle.Texture,
+                    triangle.Color } };
+        });
+}
+
+void RenderTarget::DrawTriangleVisibility(Eigen::Vector4f const& vertA,
+    Eigen::Vector4f const& vertB, Eigen::Vector4f const& vertC, uint32_t triangleId,
+    ScreenRect const& clipRect, PipelineState const& state)
+{
+    RasterizeTriangle(vertA, vertB, vertC, clipRect, [&]()
+        {
+            return VisibilityShader{ this, m_deferredTriangles.at(triangleId).ReciprocalW,
+                triangleId };
+        });
+    if (state.IsWireframe)
+    {
+        DrawTriangleEdges(vertA, vertB, vertC, c_wireframeColor, clipRect);
+    }
+}
+
+template<typename ShaderFactory>
+void RenderTarget::RasterizeTriangle(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+    Eigen::Vector4f const& vertC, ScreenRect const& clipRect, ShaderFactory const& createShader)
+{
+    using Shader = std::invoke_result_t<ShaderFactory const&>;
+
     // First, convert vertices from floating point to fixed-point numbers to ensure we don't run
     // into precision issues when calculating ownership of triangle edges.
     Eigen::Vector2<fpm::fixed_24_8> const vertA2D{ fpm::fixed_24_8{ vertA.x() },
@@ -193,64 +550,366 @@ void RenderTarget::DrawTexturedTriangle(Eigen::Vector4f const& vertA, Eigen::Vec
         fpm::fixed_24_8{ vertC.y() } };
 
     // Confirm vertices are provided in counter-clockwise order
-    if (TriangleDeterminant(vertA2D, vertB2D, vertC2D) <= fpm::fixed_24_8{ 0 })
+    if (TriangleDeterminant(vertA2D, vertB2D, vertC2D) <= 0)
     {
         return;
     }
 
     // Simple rasterization - test every pixel of the rectangular boundary
     // surrounding the triangle and fill the points "inside" the triangle edges
-    const auto xMin{ static_cast<uint16_t>(floor(std::min(vertA2D.x(),
+    const auto xMin{ static_cast<int32_t>(floor(std::min(vertA2D.x(),
         std::min(vertB2D.x(), vertC2D.x())))) };
-    const auto yMin{ static_cast<uint16_t>(floor(std::min(vertA2D.y(),
+    const auto yMin{ static_cast<int32_t>(floor(std::min(vertA2D.y(),
         std::min(vertB2D.y(), vertC2D.y())))) };
-    const auto xMax{ static_cast<uint16_t>(ceil(std::max(vertA2D.x(),
+    const auto xMax{ static_cast<int32_t>(ceil(std::max(vertA2D.x(),
         std::max(vertB2D.x(), vertC2D.x())))) };
-    const auto yMax{ static_cast<uint16_t>(ceil(std::max(vertA2D.y(),
+    const auto yMax{ static_cast<int32_t>(ceil(std::max(vertA2D.y(),
         std::max(vertB2D.y(), vertC2D.y())))) };
 
     // Begin with pre-calculating the edge distances at the top-left point.
     // The rest of the pixel values can be incrementally calculated from here.
     Eigen::Vector2<fpm::fixed_24_8> topLeft{ fpm::fixed_24_8{ static_cast<float>(xMin) + 0.5f },
         fpm::fixed_24_8{ static_cast<float>(yMin) + 0.5f } };
-    Eigen::Vector3<fpm::fixed_24_8> wLeft{
+    WideEdgeValues wLeft{
         TriangleDeterminant(vertB2D, vertC2D, topLeft),
         TriangleDeterminant(vertC2D, vertA2D, topLeft),
         TriangleDeterminant(vertA2D, vertB2D, topLeft) };
     if (IsTriangleEdgeLeftOrTop(vertB2D, vertC2D))
     {
-        wLeft.x() -= std::numeric_limits<fpm::fixed_24_8>::epsilon();
+        --wLeft.at(0);
     }
     if (IsTriangleEdgeLeftOrTop(vertC2D, vertA2D))
     {
-        wLeft.y() -= std::numeric_limits<fpm::fixed_24_8>::epsilon();
+        --wLeft.at(1);
     }
     if (IsTriangleEdgeLeftOrTop(vertA2D, vertB2D))
     {
-        wLeft.z() -= std::numeric_limits<fpm::fixed_24_8>::epsilon();
+        --wLeft.at(2);
     }
 
-    // Calculate determinant difference when moving across X axis and Y axis
-    Eigen::Vector3<fpm::fixed_24_8> dwdx{ (vertB2D.y() - vertC2D.y()),
-        (vertC2D.y() - vertA2D.y()), (vertA2D.y() - vertB2D.y()) };
-    Eigen::Vector3<fpm::fixed_24_8> dwdy{ (vertB2D.x() - vertC2D.x()),
-        (vertC2D.x() - vertA2D.x()), (vertA2D.x() - vertB2D.x()) };
-    
-    for (auto y{ yMin }; y <= yMax; ++y)
+    // Calculate determinant difference when moving across X axis and Y axis. These are
+    // single coordinate spans, which clipping keeps within c_maxEdgeSpan pixels.
+    EdgeValues const stepX{ static_cast<int32_t>(RawSpan(vertB2D.y(), vertC2D.y())),
+        static_cast<int32_t>(RawSpan(vertC2D.y(), vertA2D.y())),
+        static_cast<int32_t>(RawSpan(vertA2D.y(), vertB2D.y())) };
+    EdgeValues const stepY{ static_cast<int32_t>(RawSpan(vertC2D.x(), vertB2D.x())),
+        static_cast<int32_t>(RawSpan(vertA2D.x(), vertC2D.x())),
+        static_cast<int32_t>(RawSpan(vertB2D.x(), vertA2D.x())) };
+
+    // Only visit the part of the bounding box inside the clip rectangle. The edge
+    // distances are advanced to the clipped corner in exact integer steps, so a pixel
+    // gets the same coverage no matter which rectangle it was drawn through.
+    const auto xStart{ std::max(xMin, static_cast<int32_t>(clipRect.MinX)) };
+    const auto yStart{ std::max(yMin, static_cast<int32_t>(clipRect.MinY)) };
+    const auto xEnd{ std::min(xMax, static_cast<int32_t>(clipRect.MaxX)) };
+    const auto yEnd{ std::min(yMax, static_cast<int32_t>(clipRect.MaxY)) };
+    if ((xStart > xEnd) || (yStart > yEnd))
     {
-        Eigen::Vector3<fpm::fixed_24_8> horizontalW{ wLeft };
-        for (auto x{ xMin }; x <= xMax; ++x)
+        return;
+    }
+
+    // Drop the whole triangle if even its nearest point is behind everything already drawn
+    // in the hierarchical depth buffer tiles it covers. Without depth testing nothing is
+    // occluded.
+    float const triangleNearestDepth{ NearestDepth(
+        std::max({ (1.0f / vertA.w()), (1.0f / vertB.w()), (1.0f / vertC.w()) })) };
+    if (Shader::IsDepthTested && IsOccluded(triangleNearestDepth, xStart, yStart, xEnd, yEnd))
+    {
+        m_statistics.TrianglesOccluded.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Set up the shader's attributes once for the whole triangle, so each covered pixel
+    // only has to add its offset within the current block.
+    auto shader{ createShader() };
+    AttributePlane const& reciprocalWPlane{ shader.ReciprocalW() };
+
+    // From here on the edge values only ever get stepped, which is exact in raw integer form.
+    WideEdgeValues startW;
+    for (size_t i{ 0 }; i < startW.size(); ++i)
+    {
+        startW.at(i) = wLeft.at(i) + (int64_t{ stepX.at(i) } * (xStart - xMin)) +
+            (int64_t{ stepY.at(i) } * (yStart - yMin));
+    }
+
+    // Classify each block against the three edges first. Blocks entirely outside any edge
+    // are skipped, blocks entirely inside all edges are filled without testing coverage,
+    // and only blocks straddling an edge test their pixels.
+    uint64_t blocksRejected{ 0 };
+    uint64_t blocksAccepted{ 0 };
+    uint64_t blocksPartial{ 0 };
+    uint64_t blocksOccluded{ 0 };
+    uint64_t pixelsWritten{ 0 };
+    bool isDepthWritten{ false };
+    for (auto blockY{ yStart & ~(c_blockSize - 1) }; blockY <= yEnd; blockY += c_blockSize)
+    {
+        auto const y0{ std::max(blockY, yStart) };
+        auto const y1{ std::min(blockY + c_blockSize - 1, yEnd) };
+        for (auto blockX{ xStart & ~(c_blockSize - 1) }; blockX <= xEnd; blockX += c_blockSize)
         {
-            if ((horizontalW.x() >= fpm::fixed_24_8{ 0 }) &&
-                (horizontalW.y() >= fpm::fixed_24_8{ 0 }) &&
-                (horizontalW.z() >= fpm::fixed_24_8{ 0 }))
+            auto const x0{ std::max(blockX, xStart) };
+            auto const x1{ std::min(blockX + c_blockSize - 1, xEnd) };
+
+            // Edge values are linear, so their extremes over the block are at its corners
+            WideEdgeValues cornerW;
+            bool isOutside{ false };
+            bool isInside{ true };
+            for (size_t i{ 0 }; i < cornerW.size(); ++i)
             {
-                DrawTexel(x, y, texture, vertA, vertB, vertC, texA, texB, texC);
+                cornerW.at(i) = startW.at(i) + (int64_t{ stepX.at(i) } * (x0 - xStart)) +
+                    (int64_t{ stepY.at(i) } * (y0 - yStart));
+                int64_t const spanX{ static_cast<int64_t>(stepX.at(i)) * (x1 - x0) };
+                int64_t const spanY{ static_cast<int64_t>(stepY.at(i)) * (y1 - y0) };
+                int64_t const lowest{ cornerW.at(i) + std::min<int64_t>(spanX, 0) +
+                    std::min<int64_t>(spanY, 0) };
+                int64_t const highest{ cornerW.at(i) + std::max<int64_t>(spanX, 0) +
+                    std::max<int64_t>(spanY, 0) };
+                isOutside = isOutside || (highest < 0);
+                isInside = isInside && (lowest >= 0);
+            }
+            if (isOutside)
+            {
+                ++blocksRejected;
+                continue;
+            }
+
+            // Skip blocks where the triangle can't be in front of anything drawn so far
+            auto const blockIndex{ ((blockY / c_blockSize) * m_hiZBlockCountX) +
+                (blockX / c_blockSize) };
+            float const blockNearestDepth{ std::max(triangleNearestDepth,
+                NearestDepth(reciprocalWPlane.MaxValue(x0, y0, x1, y1))) };
+            if (Shader::IsDepthTested && (blockNearestDepth >= m_hiZBlocks.at(blockIndex)))
+            {
+                ++blocksOccluded;
+                continue;
             }
 
-            horizontalW = (horizontalW - dwdx);
+            uint64_t blockPixelsWritten{ 0 };
+            if (isInside)
+            {
+                ++blocksAccepted;
+                for (auto y{ y0 }; y <= y1; ++y)
+                {
+                    shader.BeginRow(blockX, y);
+                    for (auto x{ x0 }; x <= x1; ++x)
+                    {
+                        blockPixelsWritten += shader.ShadePixel(static_cast<uint16_t>(x),
+                            static_cast<uint16_t>(y), (x - blockX));
+                    }
+                }
+            }
+            else
+            {
+                ++blocksPartial;
+                // Edges crossing the block are within a block's steps of zero over it, which
+                // fits 32 bits. Edges the block is entirely inside may be far from it.
+                EdgeValues rowW;
+                for (size_t i{ 0 }; i < rowW.size(); ++i)
+                {
+                    rowW.at(i) = static_cast<int32_t>(std::min(cornerW.at(i),
+                        c_clampedEdgeValue));
+                }
+                for (auto y{ y0 }; y <= y1; ++y)
+                {
+                    uint32_t coverage{ m_coverageFunction(rowW, stepX, (x1 - x0 + 1)) };
+                    if (coverage != 0)
+                    {
+                        shader.BeginRow(blockX, y);
+                        while (coverage != 0)
+                        {
+                            auto const x{ x0 + std::countr_zero(coverage) };
+                            blockPixelsWritten += shader.ShadePixel(static_cast<uint16_t>(x),
+                                static_cast<uint16_t>(y), (x - blockX));
+                            coverage &= (coverage - 1);
+                        }
+                    }
+                    for (size_t i{ 0 }; i < rowW.size(); ++i)
+                    {
+                        rowW.at(i) += stepY.at(i);
+                    }
+                }
+            }
+
+            pixelsWritten += blockPixelsWritten;
+            if (Shader::IsDepthWritten && (blockPixelsWritten != 0))
+            {
+                UpdateHiZBlock(blockX, blockY);
+                isDepthWritten = true;
+            }
+        }
+    }
+    if (isDepthWritten)
+    {
+        UpdateHiZTiles(xStart, yStart, xEnd, yEnd);
+    }
+    m_statistics.BlocksRejected.fetch_add(blocksRejected, std::memory_order_relaxed);
+    m_statistics.BlocksAccepted.fetch_add(blocksAccepted, std::memory_order_relaxed);
+    m_statistics.BlocksPartial.fetch_add(blocksPartial, std::memory_order_relaxed);
+    m_statistics.BlocksOccluded.fetch_add(blocksOccluded, std::memory_order_relaxed);
+    m_statistics.PixelsWritten.fetch_add(pixelsWritten, std::memory_order_relaxed);
+}
+
+void RenderTarget::BeginVisibilityPass()
+{
+    m_visibilityBuffer.resize(Buffer.size());
+    std::fill(m_visibilityBuffer.begin(), m_visibilityBuffer.end(), c_noVisibleTriangle);
+    m_deferredTriangles.clear();
+    m_deferredSamplers.clear();
+    m_isRecordingVisibility = true;
+}
+
+uint32_t RenderTarget::DeferTexturedTriangle(Eigen::Vector4f const& vertA,
+    Eigen::Vector4f const& vertB, Eigen::Vector4f const& vertC, Eigen::Vector2f const& texA,
+    Eigen::Vector2f const& texB, Eigen::Vector2f const& texC, PngTexture* texture,
+    PipelineState const& state)
+{
+    static constexpr std::array<TexelSampler, c_texelAddressingCount> c_samplers{
+        &SampleTexel<TexelAddressing::Repeat>,
+        &SampleTexel<TexelAddressing::RepeatPowerOfTwo>,
+        &SampleTexel<TexelAddressing::Clamp>,
+    };
+    auto triangleId{ static_cast<uint32_t>(m_deferredTriangles.size()) };
+    // Untextured triangles are filled the way DrawTexturedTriangle fills them
+    m_deferredTriangles.emplace_back(vertA, vertB, vertC, texA, texB, texC, texture, 0);
+    m_deferredSamplers.push_back(
+        c_samplers.at(static_cast<size_t>(SelectTexelAddressing(texture, state))));
+    return triangleId;
+}
+
+void RenderTarget::ResolveVisibility(uint16_t firstRow, uint16_t lastRow)
+{
+    for (int32_t y{ firstRow }; y <= lastRow; ++y)
+    {
+        // Attributes are evaluated exactly the way ForwardShader does, so each pixel gets
+        // the same texel it would have had in forward rendering. Neighbouring pixels usually
+        // belong to the same triangle and block, so the block's row values are reused.
+        uint32_t rowTriangleId{ c_noVisibleTriangle };
+        int32_t rowBlockX{ -1 };
+        float rowReciprocalW{ 0.0f };
+        float rowUOverW{ 0.0f };
+        float rowVOverW{ 0.0f };
+        size_t rowMipLevel{ 0 };
+        TexelSampler rowSampler{ nullptr };
+        for (int32_t x{ 0 }; x < Width; ++x)
+        {
+            auto const pixelIndex{ (Width * y) + x };
+            auto const triangleId{ m_visibilityBuffer[pixelIndex] };
+            if (triangleId == c_noVisibleTriangle)
+            {
+                continue;
+            }
+            auto const& shading{ m_deferredTriangles.at(triangleId) };
+            if (shading.Texture == nullptr)
+            {
+                Buffer[pixelIndex] = shading.Color;
+                continue;
+            }
+            auto const blockX{ x & ~(c_blockSize - 1) };
+            if ((triangleId != rowTriangleId) || (blockX != rowBlockX))
+            {
+                rowTriangleId = triangleId;
+                rowBlockX = blockX;
+                rowReciprocalW = shading.ReciprocalW.BlockValue(blockX, y);
+                rowUOverW = shading.UOverW.BlockValue(blockX, y);
+                rowVOverW = shading.VOverW.BlockValue(blockX, y);
+                rowMipLevel = SelectMipLevel(shading, rowReciprocalW, rowUOverW, rowVOverW);
+                rowSampler = m_deferredSamplers[triangleId];
+            }
+            auto const blockOffset{ x - blockX };
+            Buffer[pixelIndex] = rowSampler(shading.Texture,
+                rowReciprocalW + shading.ReciprocalW.BlockOffsets[blockOffset],
+                rowUOverW + shading.UOverW.BlockOffsets[blockOffset],
+                rowVOverW + shading.VOverW.BlockOffsets[blockOffset], rowMipLevel);
+        }
+    }
+}
+
+void RenderTarget::EndVisibilityPass()
+{
+    m_isRecordingVisibility = false;
+}
+
+RasterStatistics RenderTarget::Statistics() const
+{
+    return RasterStatistics{
+        .BlocksRejected = m_statistics.BlocksRejected.load(std::memory_order_relaxed),
+        .BlocksAccepted = m_statistics.BlocksAccepted.load(std::memory_order_relaxed),
+        .BlocksPartial = m_statistics.BlocksPartial.load(std::memory_order_relaxed),
+        .BlocksOccluded = m_statistics.BlocksOccluded.load(std::memory_order_relaxed),
+        .TrianglesOccluded = m_statistics.TrianglesOccluded.load(std::memory_order_relaxed),
+        .PixelsWritten = m_statistics.PixelsWritten.load(std::memory_order_relaxed),
+        .MeshesCulled = m_statistics.MeshesCulled.load(std::memory_order_relaxed),
+        .FacesCulled = m_statistics.FacesCulled.load(std::memory_order_relaxed),
+    };
+}
+
+void RenderTarget::ResetStatistics()
+{
+    m_statistics.BlocksRejected.store(0, std::memory_order_relaxed);
+    m_statistics.BlocksAccepted.store(0, std::memory_order_relaxed);
+    m_statistics.BlocksPartial.store(0, std::memory_order_relaxed);
+    m_statistics.BlocksOccluded.store(0, std::memory_order_relaxed);
+    m_statistics.TrianglesOccluded.store(0, std::memory_order_relaxed);
+    m_statistics.PixelsWritten.store(0, std::memory_order_relaxed);
+    m_statistics.MeshesCulled.store(0, std::memory_order_relaxed);
+    m_statistics.FacesCulled.store(0, std::memory_order_relaxed);
+}
+
+void RenderTarget::CountCulledMeshes(uint64_t meshCount, uint64_t faceCount)
+{
+    m_statistics.MeshesCulled.fetch_add(meshCount, std::memory_order_relaxed);
+    m_statistics.FacesCulled.fetch_add(faceCount, std::memory_order_relaxed);
+}
+
+bool RenderTarget::IsOccluded(float nearestDepth, int32_t x0, int32_t y0, int32_t x1,
+    int32_t y1) const
+{
+    for (auto tileY{ y0 / c_hiZTileSize }; tileY <= (y1 / c_hiZTileSize); ++tileY)
+    {
+        for (auto tileX{ x0 / c_hiZTileSize }; tileX <= (x1 / c_hiZTileSize); ++tileX)
+        {
+            if (nearestDepth < m_hiZTiles.at((tileY * m_hiZTileCountX) + tileX))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void RenderTarget::UpdateHiZBlock(int32_t blockX, int32_t blockY)
+{
+    auto const xEnd{ std::min(blockX + c_blockSize, static_cast<int32_t>(Width)) };
+    auto const yEnd{ std::min(blockY + c_blockSize, static_cast<int32_t>(Height)) };
+    float farthest{ 0.0f };
+    for (auto y{ blockY }; y < yEnd; ++y)
+    {
+        auto const row{ ZBuffer.begin() + (Width * y) };
+        farthest = std::max(farthest, *std::max_element(row + blockX, row + xEnd));
+    }
+    m_hiZBlocks.at(((blockY / c_blockSize) * m_hiZBlockCountX) + (blockX / c_blockSize)) =
+        farthest;
+}
+
+void RenderTarget::UpdateHiZTiles(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+    auto const blockCountY{ static_cast<int32_t>(m_hiZBlocks.size() / m_hiZBlockCountX) };
+    for (auto tileY{ y0 / c_hiZTileSize }; tileY <= (y1 / c_hiZTileSize); ++tileY)
+    {
+        for (auto tileX{ x0 / c_hiZTileSize }; tileX <= (x1 / c_hiZTileSize); ++tileX)
+        {
+            auto const blockXEnd{ std::min(((tileX + 1) * c_hiZTileBlocks),
+                static_cast<int32_t>(m_hiZBlockCountX)) };
+            auto const blockYEnd{ std::min(((tileY + 1) * c_hiZTileBlocks), blockCountY) };
+            float farthest{ 0.0f };
+            for (auto blockY{ tileY * c_hiZTileBlocks }; blockY < blockYEnd; ++blockY)
+            {
+                auto const row{ m_hiZBlocks.begin() + (blockY * m_hiZBlockCountX) };
+                farthest = std::max(farthest, *std::max_element(
+                    row + (tileX * c_hiZTileBlocks), row + blockXEnd));
+            }
+            m_hiZTiles.at((tileY * m_hiZTileCountX) + tileX) = farthest;
         }
-        wLeft = (wLeft + dwdy);
     }
 }
 }
\ No newline at end of file
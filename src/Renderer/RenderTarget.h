@@ -1,8 +1,64 @@
 #pragma once
+#include <atomic>
 #include "../Texture/PngTexture.h"
+#include "AttributePlane.h"
+#include "RasterCoverage.h"
 
 namespace game
 {
+// Inclusive rectangle of pixels that drawing operations are allowed to touch.
+struct ScreenRect
+{
+    uint16_t MinX;
+    uint16_t MinY;
+    uint16_t MaxX;
+    uint16_t MaxY;
+};
+
+// Per-frame counters describing how culling and triangle rasterization went
+struct RasterStatistics
+{
+    // 8x8 pixel blocks skipped entirely because they are outside the triangle
+    uint64_t BlocksRejected;
+    // Blocks filled without testing coverage because they are entirely inside the triangle
+    uint64_t BlocksAccepted;
+    // Blocks straddling a triangle edge, where each pixel is tested
+    uint64_t BlocksPartial;
+    // Blocks skipped because the hierarchical depth buffer shows the triangle is behind them
+    uint64_t BlocksOccluded;
+    // Triangles skipped entirely for the same reason
+    uint64_t TrianglesOccluded;
+    // Pixels that passed the depth test, counting every time a pixel is overdrawn
+    uint64_t PixelsWritten;
+    // Meshes skipped before any vertex work because their bounds are outside the frustum,
+    // along with the faces they contain
+    uint64_t MeshesCulled;
+    uint64_t FacesCulled;
+};
+
+// Fixed-function state a triangle is drawn with. Every combination of the state the pixel loop
+// reads is compiled into its own loop, picked once per triangle, so none of it is decided per
+// pixel.
+struct PipelineState
+{
+    // How texture coordinates outside [0, 1] find a texel
+    enum class WrapMode : uint8_t
+    {
+        // The texture tiles. Textures whose sides are powers of two wrap by masking.
+        Repeat,
+        // The texels along the edges stretch outwards
+        Clamp,
+    };
+
+    // Skip pixels behind what the depth buffer holds
+    bool IsDepthTested{ true };
+    // Record the depth of drawn pixels
+    bool IsDepthWritten{ true };
+    WrapMode Wrap{ WrapMode::Repeat };
+    // Outline triangles over their fill
+    bool IsWireframe{ false };
+};
+
 struct RenderTarget
 {
     RenderTarget(uint16_t width, uint16_t height);
@@ -11,21 +67,111 @@ struct RenderTarget
     void ClearPixelBuffer(uint32_t color);
     void ClearZBuffer();
     void DrawPixel(uint16_t x, uint16_t y, uint32_t color);
-    void DrawTexel(uint16_t x, uint16_t y, PngTexture* texture,
-        Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB, Eigen::Vector4f const& vertC,
-        Eigen::Vector2f const& texA, Eigen::Vector2f const& texB, Eigen::Vector2f const& texC);
     void DrawRectangle(uint16_t x1, uint16_t y1, uint16_t x2,
         uint16_t y2, uint32_t color);
     void DrawLine(Eigen::Vector2f const& inA, Eigen::Vector2f const& inB, uint32_t color);
+    void DrawLine(Eigen::Vector2f const& inA, Eigen::Vector2f const& inB, uint32_t color,
+        ScreenRect const& clipRect);
+    void DrawTriangleEdges(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+        Eigen::Vector4f const& vertC, uint32_t color, ScreenRect const& clipRect);
     void DrawShadedTriangle(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
         Eigen::Vector4f const& vertC, uint32_t color);
+    void DrawShadedTriangle(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+        Eigen::Vector4f const& vertC, uint32_t color, ScreenRect const& clipRect,
+        PipelineState const& state);
     void DrawTexturedTriangle(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
         Eigen::Vector4f const& vertC, Eigen::Vector2f const& texA, Eigen::Vector2f const& texB,
         Eigen::Vector2f const& texC, PngTexture* texture);
+    void DrawTexturedTriangle(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+        Eigen::Vector4f const& vertC, Eigen::Vector2f const& texA, Eigen::Vector2f const& texB,
+        Eigen::Vector2f const& texC, PngTexture* texture, ScreenRect const& clipRect,
+        PipelineState const& state = {});
+
+    // Visibility buffer rendering. Between BeginVisibilityPass and EndVisibilityPass,
+    // triangles only write depth and their ID, and texturing is deferred to
+    // ResolveVisibility so every pixel is shaded once no matter how often it was overdrawn.
+    // Visibility needs the depth buffer, so the pass always tests and writes depth.
+    void BeginVisibilityPass();
+    // Sets up a triangle for the resolve and returns the ID to rasterize it with
+    uint32_t DeferTexturedTriangle(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+        Eigen::Vector4f const& vertC, Eigen::Vector2f const& texA, Eigen::Vector2f const& texB,
+        Eigen::Vector2f const& texC, PngTexture* texture, PipelineState const& state = {});
+    void DrawTriangleVisibility(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+        Eigen::Vector4f const& vertC, uint32_t triangleId, ScreenRect const& clipRect,
+        PipelineState const& state = {});
+    // Textures the visible pixels of an inclusive range of rows. Rows are independent, so
+    // separate ranges can be resolved concurrently.
+    void ResolveVisibility(uint16_t firstRow, uint16_t lastRow);
+    void EndVisibilityPass();
+
+    ScreenRect Bounds() const;
+    RasterStatistics Statistics() const;
+    void ResetStatistics();
+    void CountCulledMeshes(uint64_t meshCount, uint64_t faceCount);
 
     uint16_t const Width;
     uint16_t const Height;
     std::vector<uint32_t> Buffer;
     std::vector<float> ZBuffer;
+
+private:
+    struct AtomicRasterStatistics
+    {
+        std::atomic<uint64_t> BlocksRejected;
+        std::atomic<uint64_t> BlocksAccepted;
+        std::atomic<uint64_t> BlocksPartial;
+        std::atomic<uint64_t> BlocksOccluded;
+        std::atomic<uint64_t> TrianglesOccluded;
+        std::atomic<uint64_t> PixelsWritten;
+        std::atomic<uint64_t> MeshesCulled;
+        std::atomic<uint64_t> FacesCulled;
+    };
+    // A triangle as handed to whichever permutation of the pipeline draws it
+    struct TriangleDraw
+    {
+        std::array<Eigen::Vector4f, 3> Vertices;
+        std::array<Eigen::Vector2f, 3> TextureCoordinates;
+        // Untextured triangles are filled with Color instead
+        PngTexture* Texture;
+        uint32_t Color;
+    };
+    using DrawFunction = void (RenderTarget::*)(TriangleDraw const&, ScreenRect const&);
+    using TexelSampler = uint32_t (*)(PngTexture*, float, float, float, size_t);
+    template<typename Permutation>
+    struct ForwardShader;
+    struct VisibilityShader;
+
+    CoverageFunction const m_coverageFunction;
+    // Tile workers rasterize concurrently, so the counters are shared atomically
+    AtomicRasterStatistics m_statistics{};
+    // Hierarchical depth buffer: the farthest depth in every 8x8 block of ZBuffer, and the
+    // farthest depth of every 8x8 group of those blocks. Kept up to date as triangles write
+    // depth so occluded triangles and blocks can be rejected before any per-pixel work.
+    uint16_t const m_hiZBlockCountX;
+    std::vector<float> m_hiZBlocks;
+    uint16_t const m_hiZTileCountX;
+    std::vector<float> m_hiZTiles;
+    // Index into m_deferredTriangles of the nearest triangle at every pixel, while a
+    // visibility pass is recording
+    bool m_isRecordingVisibility{ false };
+    std::vector<uint32_t> m_visibilityBuffer;
+    std::vector<TriangleShading> m_deferredTriangles;
+    // How each deferred triangle samples its texture, following its wrap mode
+    std::vector<TexelSampler> m_deferredSamplers;
+
+    bool DrawVisibility(uint16_t x, uint16_t y, float reciprocalW, uint32_t triangleId);
+    // Draws with the permutation for the state, from a table of every permutation
+    void DrawTriangle(TriangleDraw const& triangle, ScreenRect const& clipRect,
+        PipelineState const& state);
+    template<typename Permutation>
+    void DrawPermutation(TriangleDraw const& triangle, ScreenRect const& clipRect);
+    template<typename ShaderFactory>
+    void RasterizeTriangle(Eigen::Vector4f const& vertA, Eigen::Vector4f const& vertB,
+        Eigen::Vector4f const& vertC, ScreenRect const& clipRect,
+        ShaderFactory const& createShader);
+
+    bool IsOccluded(float nearestDepth, int32_t x0, int32_t y0, int32_t x1, int32_t y1) const;
+    void UpdateHiZBlock(int32_t blockX, int32_t blockY);
+    void UpdateHiZTiles(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
 };
 }
\ No newline at end of file
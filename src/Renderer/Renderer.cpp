@@ -1,4 +1,5 @@
 #include <pch.h>
+#include <queue>
 #include "Configuration.h"
 #include "../Mesh/Mesh.h"
 #include "Renderer.h"
@@ -18,6 +19,12 @@ namespace
         return SDLRendererPtr{ renderer };
     }
 
+    // A level of a mesh's chain: 0 for the mesh itself, then each of its levels of detail
+    Mesh const* LevelOfDetail(Mesh const* mesh, size_t level)
+    {
+        return (level == 0) ? mesh : mesh->LevelsOfDetail.at(level - 1).Simplified.get();
+    }
+
     SDLTexturePtr CreateFrameBufferTexture(SDL_Renderer* renderer, VideoConfiguration resolution)
     {
         SPDLOG_INFO("Creating framebuffer texture");
@@ -27,6 +34,30 @@ namespace
         return SDLTexturePtr{ texture };
     }
 
+    // Rows of the frame buffer handed to each task of the visibility resolve
+    constexpr uint16_t c_resolveRowsPerTask{ 16 };
+
+    size_t RenderThreadCount(VideoConfiguration const& resolution)
+    {
+        size_t threadCount{ resolution.RenderThreadCount };
+        if (threadCount == 0)
+        {
+            threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        return threadCount;
+    }
+
+    std::unique_ptr<game::TileRasterizer> CreateTileRasterizer(game::RenderTarget* target,
+        game::ThreadPool* threadPool)
+    {
+        if (threadPool->ThreadCount() == 0)
+        {
+            SPDLOG_INFO("Rasterizing on the render thread");
+            return nullptr;
+        }
+        return std::make_unique<game::TileRasterizer>(target, threadPool);
+    }
+
     Eigen::Matrix4f CreatePerspectiveMatrix(float fovYRads, float width, float height,
         float nearPlane, float farPlane)
     {
@@ -34,45 +65,93 @@ namespace
             farPlane);
     }
 
-    std::unordered_map<FrustumPlaneKind, game::Plane> CreateFrustumPlanes(float fovX, float fovY,
-        float zNear, float zFar)
-    {
-        std::unordered_map<FrustumPlaneKind, game::Plane> result;
-
-        float xCosHalfFov{ cosf(fovX / 2.0f) };
-        float xSinHalfFov{ sinf(fovX / 2.0f) };
-        float yCosHalfFov{ cosf(fovY / 2.0f) };
-        float ySinHalfFov{ sinf(fovY / 2.0f) };
-        Eigen::Vector3f origin{ 0.0f, 0.0f, 0.0f };
-
-        result[FrustumPlaneKind::LeftFrustumPlane] = game::Plane{
-            .Point = origin,
-            .Normal = Eigen::Vector3f{ xCosHalfFov, 0.0f, xSinHalfFov },
-        };
-        result[FrustumPlaneKind::RightFrustumPlane] = game::Plane{
-            .Point = origin,
-            .Normal = Eigen::Vector3f{ -xCosHalfFov, 0.0f, xSinHalfFov },
-        };
-        result[FrustumPlaneKind::TopFrustumPlane] = game::Plane{
-            .Point = origin,
-            .Normal = Eigen::Vector3f{ 0.0f, -yCosHalfFov, ySinHalfFov },
-        };
-        result[FrustumPlaneKind::BottomFrustumPlane] = game::Plane{
-            .Point = origin,
-            .Normal = Eigen::Vector3f{ 0.0f, yCosHalfFov, ySinHalfFov },
-        };
-        result[FrustumPlaneKind::NearFrustumPlane] = game::Plane{
-            .Point = Eigen::Vector3f{ 0.0f, 0.0f, zNear },
-            .Normal = Eigen::Vector3f{ 0.0f, 0.0f, 1.0f },
-        };
-        result[FrustumPlaneKind::FarFrustumPlane] = game::Plane{
-            .Point = Eigen::Vector3f{ 0.0f, 0.0f, zFar },
-            .Normal = Eigen::Vector3f{ 0.0f, 0.0f, -1.0f },
-        };
+    // Screen coordinates are converted to 24.8 fixed point for rasterization, where edge
+    // values step by the span of a triangle edge, which has to stay under c_maxEdgeSpan
+    // pixels. Clipping within this many pixels of the screen's centre keeps every edge at
+    // half that, leaving room for the clipper's rounding, at any resolution.
+    constexpr float c_guardBandExtent{ static_cast<float>(game::c_maxEdgeSpan / 4) };
+
+    // How far the guard band extends past the screen, as a multiple of the screen size
+    float GuardBandScale(uint16_t width, uint16_t height)
+    {
+        return std::max(1.0f, c_guardBandExtent / (std::max(width, height) / 2.0f));
+    }
+
+    Eigen::Vector4f& ClipPlane(game::ClipPlanes& planes, FrustumPlaneKind kind)
+    {
+        return planes.at(static_cast<size_t>(kind));
+    }
 
+    // Clip-space planes of the view frustum, with the side planes pushed out by the given
+    // scale. The projection maps the near plane to z = 0 and the far plane to z = w.
+    game::ClipPlanes CreateClipPlanes(float sideScale)
+    {
+        game::ClipPlanes result;
+        ClipPlane(result, FrustumPlaneKind::LeftFrustumPlane) =
+            Eigen::Vector4f{ 1.0f, 0.0f, 0.0f, sideScale };
+        ClipPlane(result, FrustumPlaneKind::RightFrustumPlane) =
+            Eigen::Vector4f{ -1.0f, 0.0f, 0.0f, sideScale };
+        ClipPlane(result, FrustumPlaneKind::TopFrustumPlane) =
+            Eigen::Vector4f{ 0.0f, -1.0f, 0.0f, sideScale };
+        ClipPlane(result, FrustumPlaneKind::BottomFrustumPlane) =
+            Eigen::Vector4f{ 0.0f, 1.0f, 0.0f, sideScale };
+        ClipPlane(result, FrustumPlaneKind::NearFrustumPlane) =
+            Eigen::Vector4f{ 0.0f, 0.0f, 1.0f, 0.0f };
+        ClipPlane(result, FrustumPlaneKind::FarFrustumPlane) =
+            Eigen::Vector4f{ 0.0f, 0.0f, -1.0f, 1.0f };
         return result;
     }
 
+    // Pulls clip-space planes back through the projection into camera space
+    game::ClipPlanes CreateViewFrustumPlanes(game::ClipPlanes const& clipPlanes,
+        Eigen::Matrix4f const& projectionMatrix)
+    {
+        game::ClipPlanes result;
+        for (size_t i{ 0 }; i < clipPlanes.size(); ++i)
+        {
+            Eigen::Vector4f const plane{ projectionMatrix.transpose() * clipPlanes.at(i) };
+            result.at(i) = plane / plane.head<3>().norm();
+        }
+        return result;
+    }
+
+    // Transforms every vertex of a packed mesh from local space -> camera space -> clip
+    // space, and unpacks its texture coordinate. Any quantization of the positions is undone
+    // by folding the mesh's offset and scale into the model-view matrix.
+    template<typename Component>
+    void TransformPackedVertices(std::span<Component const> vertices,
+        game::PackedMesh const& mesh, Eigen::Matrix4f const& modelViewMatrix,
+        Eigen::Matrix4f const& projectionMatrix, std::vector<Eigen::Vector4f>& viewSpaceVertices,
+        std::vector<Eigen::Vector4f>& clipSpaceVertices,
+        std::vector<Eigen::Vector2f>& textureCoordinates)
+    {
+        constexpr auto c_stride{ static_cast<Eigen::Index>(game::PackedMesh::c_vertexStride) };
+        auto const vertexCount{ static_cast<Eigen::Index>(mesh.VertexCount()) };
+        viewSpaceVertices.resize(mesh.VertexCount());
+        clipSpaceVertices.resize(mesh.VertexCount());
+        textureCoordinates.resize(mesh.VertexCount());
+        Eigen::Map<Eigen::Matrix<Component, c_stride, Eigen::Dynamic> const> const stream{
+            vertices.data(), c_stride, vertexCount };
+        Eigen::Map<Eigen::Matrix<float, c_stride, 1> const> const offset{ mesh.Offset.data() };
+        Eigen::Map<Eigen::Matrix<float, c_stride, 1> const> const scale{ mesh.Scale.data() };
+        Eigen::Map<Eigen::Matrix4Xf> viewSpace{ viewSpaceVertices.data()->data(), 4, vertexCount };
+        Eigen::Map<Eigen::Matrix4Xf> clipSpace{ clipSpaceVertices.data()->data(), 4, vertexCount };
+        Eigen::Map<Eigen::Matrix2Xf> textureSpace{ textureCoordinates.data()->data(), 2,
+            vertexCount };
+
+        Eigen::Matrix4f dequantizingModelViewMatrix;
+        dequantizingModelViewMatrix.leftCols<3>() = modelViewMatrix.leftCols<3>() *
+            scale.head<3>().asDiagonal();
+        dequantizingModelViewMatrix.col(3) = modelViewMatrix * offset.head<3>().homogeneous();
+        viewSpace.noalias() = dequantizingModelViewMatrix.leftCols<3>() *
+            stream.template topRows<3>().template cast<float>();
+        viewSpace.colwise() += dequantizingModelViewMatrix.col(3);
+        clipSpace.noalias() = projectionMatrix * viewSpace;
+        textureSpace.noalias() = scale.tail<2>().asDiagonal() *
+            stream.template bottomRows<2>().template cast<float>();
+        textureSpace.colwise() += offset.tail<2>();
+    }
+
     Eigen::Vector3f GetTriangleNormal(std::array<Eigen::Vector4f, 3> const& vertices)
     {
         auto a{ vertices.at(0).head<3>() };
@@ -85,40 +164,40 @@ namespace
         return ab.cross(ac).normalized();
     }
 
-    float GetFovX(uint16_t width, uint16_t height, float fovY)
+    // Bit i is set when the vertex is outside (or exactly on) plane i
+    uint8_t ClipCode(Eigen::Vector4f const& vertex, game::ClipPlanes const& planes)
     {
-        float aspectX = (width / static_cast<float>(height));
-        return (atanf(tanf(fovY / 2.0f) * aspectX) * 2.0f);
+        uint8_t code{ 0 };
+        for (size_t i{ 0 }; i < planes.size(); ++i)
+        {
+            if (planes.at(i).dot(vertex) <= 0.0f)
+            {
+                code |= static_cast<uint8_t>(1u << i);
+            }
+        }
+        return code;
     }
 
-    game::Polygon ClipPolygonAgainstPlane(game::Polygon const& polygon, game::Plane const& plane)
+    game::Polygon ClipPolygonAgainstPlane(game::Polygon const& polygon,
+        Eigen::Vector4f const& plane)
     {
-        if (polygon.Vertices.size() == 0)
+        game::Polygon result;
+        result.VertexCount = 0;
+        if (polygon.VertexCount == 0)
         {
-            return polygon;
+            return result;
         }
 
-        Eigen::Vector3f const& planePoint{ plane.Point };
-        Eigen::Vector3f const& planeNormal{ plane.Normal };
-
-        game::Polygon result;
-        size_t currentVertexIndex = 0;
-        size_t currentTextureCoordIndex = 0;
-        size_t previousVertexIndex = polygon.Vertices.size() - 1;
-        size_t previousTextureCoordIndex = polygon.TextureCoordinates.size() - 1;
-
-        float previousDot{
-            (polygon.Vertices.at(previousVertexIndex) - planePoint).dot(planeNormal) };
+        size_t previousIndex{ polygon.VertexCount - 1 };
+        float previousDot{ plane.dot(polygon.Vertices.at(previousIndex)) };
 
-        while (currentVertexIndex != polygon.Vertices.size())
+        for (size_t currentIndex{ 0 }; currentIndex < polygon.VertexCount; ++currentIndex)
         {
-            const auto& currentVertex{ polygon.Vertices.at(currentVertexIndex) };
-            const auto& currentTextureCoord{
-                polygon.TextureCoordinates.at(currentTextureCoordIndex) };
-            const auto& previousVertex{ polygon.Vertices.at(previousVertexIndex) };
-            const auto& previousTextureCoord{
-                polygon.TextureCoordinates.at(previousTextureCoordIndex) };
-            float currentDot{ (currentVertex - planePoint).dot(planeNormal) };
+            const auto& currentVertex{ polygon.Vertices.at(currentIndex) };
+            const auto& currentTextureCoord{ polygon.TextureCoordinates.at(currentIndex) };
+            const auto& previousVertex{ polygon.Vertices.at(previousIndex) };
+            const auto& previousTextureCoord{ polygon.TextureCoordinates.at(previousIndex) };
+            float currentDot{ plane.dot(currentVertex) };
 
             // Signs have changed between last dot and current dot, indicating
             // the line between the previous and current vertices has crossed
@@ -128,60 +207,33 @@ namespace
                 // Split the polygon at the intersection point of the line and
                 // the plane
                 float t{ previousDot / (previousDot - currentDot) };
-                Eigen::Vector3f intersectionPoint{
+                result.Vertices.at(result.VertexCount) = Eigen::Vector4f{
                     game::Lerp(previousVertex.x(), currentVertex.x(), t),
                     game::Lerp(previousVertex.y(), currentVertex.y(), t),
                     game::Lerp(previousVertex.z(), currentVertex.z(), t),
+                    game::Lerp(previousVertex.w(), currentVertex.w(), t),
                 };
-                Eigen::Vector2f interpolatedTextureCoord{
+                result.TextureCoordinates.at(result.VertexCount) = Eigen::Vector2f{
                     game::Lerp(previousTextureCoord.x(), currentTextureCoord.x(), t),
                     game::Lerp(previousTextureCoord.y(), currentTextureCoord.y(), t),
                 };
-                result.Vertices.push_back(intersectionPoint);
-                result.TextureCoordinates.push_back(interpolatedTextureCoord);
+                ++result.VertexCount;
             }
 
             if (currentDot > 0.0f)
             {
                 // Current vertex is inside the plane
-                result.Vertices.push_back(currentVertex);
-                result.TextureCoordinates.push_back(currentTextureCoord);
+                result.Vertices.at(result.VertexCount) = currentVertex;
+                result.TextureCoordinates.at(result.VertexCount) = currentTextureCoord;
+                ++result.VertexCount;
             }
 
             previousDot = currentDot;
-            previousVertexIndex = currentVertexIndex;
-            ++currentVertexIndex;
-            previousTextureCoordIndex = currentTextureCoordIndex;
-            ++currentTextureCoordIndex;
+            previousIndex = currentIndex;
         }
 
         return result;
     }
-
-    std::vector<game::Triangle> TrianglesFromPolygon(game::Polygon const& polygon)
-    {
-        std::vector<game::Triangle> result;
-        for (size_t i{ 0 }; i < (polygon.Vertices.size() - 2); ++i)
-        {
-            const size_t firstIndex{ 0 };
-            const size_t secondIndex{ i + 1 };
-            const size_t thirdIndex{ i + 2 };
-            game::Triangle t{
-                .Vertices = {
-                    polygon.Vertices.at(firstIndex),
-                    polygon.Vertices.at(secondIndex),
-                    polygon.Vertices.at(thirdIndex),
-                },
-                .TextureCoordinates = {
-                    polygon.TextureCoordinates.at(firstIndex),
-                    polygon.TextureCoordinates.at(secondIndex),
-                    polygon.TextureCoordinates.at(thirdIndex),
-                }
-            };
-            result.push_back(t);
-        }
-        return result;
-    }
 }
 
 namespace game
@@ -189,16 +241,33 @@ namespace game
 Renderer::Renderer(std::shared_ptr<SDL_Window> window, const VideoConfiguration& resolution) :
     m_window{ window }, m_resolution{ resolution }, m_renderer{ CreateRenderer(m_window.get()) },
     m_frameBuffer{ m_resolution.Width, m_resolution.Height },
+    // The render thread does its share of the work, so the pool only needs the rest
+    m_threadPool{ RenderThreadCount(m_resolution) - 1 },
+    m_tileRasterizer{ CreateTileRasterizer(&m_frameBuffer, &m_threadPool) },
+    m_drawList{ c_nearPlane },
     m_frameBufferTexture{ CreateFrameBufferTexture(m_renderer.get(), m_resolution) },
     m_projectionMatrix{ CreatePerspectiveMatrix(c_defaultFovYRads, m_resolution.Width,
         m_resolution.Height, c_nearPlane, c_farPlane) },
-    m_frustumPlanes{ CreateFrustumPlanes(GetFovX(m_resolution.Width, m_resolution.Height,
-        c_defaultFovYRads), c_defaultFovYRads, c_nearPlane, c_farPlane) }
+    m_frustumPlanes{ CreateClipPlanes(1.0f) },
+    m_clippingPlanes{ CreateClipPlanes(GuardBandScale(m_resolution.Width, m_resolution.Height)) },
+    m_viewFrustumPlanes{ CreateViewFrustumPlanes(m_frustumPlanes, m_projectionMatrix) },
+    m_pixelsPerUnitAtUnitDistance{ 0.5f * static_cast<float>(m_resolution.Height) *
+        m_projectionMatrix(1, 1) },
+    m_renderMode{ m_resolution.Mode }
 {}
 
 void Renderer::Render(SimulationState const& simulationState)
 {
+    if (m_meshStreamer)
+    {
+        m_meshStreamer->Update();
+    }
     m_frameBuffer.ClearBuffers();
+    m_frameBuffer.ResetStatistics();
+    if (m_renderMode == RenderMode::VisibilityBuffer)
+    {
+        m_frameBuffer.BeginVisibilityPass();
+    }
     DrawScene(&simulationState.Camera, &simulationState.RootWorldEntity);
     for (auto const& overlay : m_overlays)
     {
@@ -215,6 +284,21 @@ void Renderer::AddOverlay(std::shared_ptr<Overlay> overlay)
     m_overlays.push_back(overlay);
 }
 
+void Renderer::SetRenderMode(RenderMode mode)
+{
+    m_renderMode = mode;
+}
+
+void Renderer::SetPipelineState(PipelineState const& state)
+{
+    m_pipelineState = state;
+}
+
+void Renderer::SetMeshStreamer(MeshStreamer* meshStreamer)
+{
+    m_meshStreamer = meshStreamer;
+}
+
 void Renderer::DrawScene(CameraEntity const *cameraEntity, Entity const *sceneEntity)
 {
     // Calculate view/camera matrix
@@ -224,115 +308,373 @@ void Renderer::DrawScene(CameraEntity const *cameraEntity, Entity const *sceneEn
     Eigen::Vector3f cameraTarget{ cameraEntity->GetPosition() + camdir3 };
     Eigen::Matrix4f viewMatrix{ game::LookAt(cameraEntity->GetPosition(), cameraTarget,
         Eigen::Vector3f{ 0.0f, 1.0f, 0.0f }) };
-    DrawEntityTreeMeshes(viewMatrix, sceneEntity);
+    m_entityBounds.clear();
+    m_meshDraws.clear();
+    QueueEntityTreeMeshes(viewMatrix, sceneEntity, GatherEntityBounds(sceneEntity));
+    FitTriangleBudget();
+    for (auto const& draw : m_meshDraws)
+    {
+        DrawMesh(draw);
+    }
+    for (auto const& triangle : m_drawList.Sort())
+    {
+        SubmitTriangle(triangle);
+    }
+    m_drawList.Clear();
+    if (m_tileRasterizer)
+    {
+        m_tileRasterizer->Flush([this](RasterTriangle const& triangle, ScreenRect const& clipRect)
+            {
+                RasterizeTriangle(triangle, clipRect);
+            });
+    }
+    if (m_renderMode == RenderMode::VisibilityBuffer)
+    {
+        ResolveVisibilityBuffer();
+    }
 }
 
-void Renderer::DrawEntityTreeMeshes(Eigen::Matrix4f const& viewMatrix, Entity const* rootEntity)
+size_t Renderer::GatherEntityBounds(Entity const* rootEntity)
 {
-    for (const auto& child : rootEntity->GetChildren())
+    // Reserve this entity's slot first so the whole subtree follows it
+    auto const boundsIndex{ m_entityBounds.size() };
+    m_entityBounds.push_back(EntityBounds{ std::nullopt, 1, 0, 0 });
+    EntityBounds bounds{ std::nullopt, 1, 0, 0 };
+    auto const addSphere{ [&bounds](BoundingSphere const& sphere)
+        {
+            bounds.Sphere = bounds.Sphere ? MergeBoundingSpheres(*bounds.Sphere, sphere) : sphere;
+        } };
+
+    Eigen::Matrix4f const modelMatrix{ Translation(rootEntity->GetPosition()) *
+        Rotation(rootEntity->GetRotation()) };
+    for (const auto& mesh : rootEntity->GetMeshes())
     {
-        DrawEntityTreeMeshes(viewMatrix, child.get());
+        auto const& localSphere{ mesh->Bounds.Sphere };
+        addSphere(BoundingSphere{
+            .Center = (modelMatrix * localSphere.Center.homogeneous()).head<3>(),
+            .Radius = localSphere.Radius,
+        });
+        ++bounds.MeshCount;
+        bounds.FaceCount += mesh->TriangleCount;
     }
-    for (const auto& mesh : rootEntity->GetMeshes())
+    for (const auto& child : rootEntity->GetChildren())
     {
-        DrawEntityMesh(viewMatrix, rootEntity, mesh.get());
+        EntityBounds const childBounds{ m_entityBounds.at(GatherEntityBounds(child.get())) };
+        if (childBounds.Sphere)
+        {
+            addSphere(*childBounds.Sphere);
+        }
+        bounds.EntityCount += childBounds.EntityCount;
+        bounds.MeshCount += childBounds.MeshCount;
+        bounds.FaceCount += childBounds.FaceCount;
     }
+    m_entityBounds.at(boundsIndex) = bounds;
+    return boundsIndex;
 }
 
-void Renderer::DrawEntityMesh(Eigen::Matrix4f const& viewMatrix, Entity const* entity, Mesh const *mesh)
+bool Renderer::IsInViewFrustum(Eigen::Vector3f const& viewSpaceCenter, float radius) const
 {
-    // First apply entity transformations
-    auto entityTranslate{ Translation(entity->GetPosition()) };
-    auto entityRotate { Rotation(entity->GetRotation()) };
-
-    // Textured
-    for (const auto& face : mesh->Faces)
-    {
-        // Prepare vertices to be transformed via matrix multiplication
-        const auto& pointA{ mesh->Vertices.at(face.MeshVertexIndices.at(0)) };
-        const auto& pointB{ mesh->Vertices.at(face.MeshVertexIndices.at(1)) };
-        const auto& pointC{ mesh->Vertices.at(face.MeshVertexIndices.at(2)) };
-        std::array<Eigen::Vector2f, 3> textureCoordinates{
-            mesh->TextureCoordinates.at(face.MeshTextureCoordinateIndices.at(0)),
-            mesh->TextureCoordinates.at(face.MeshTextureCoordinateIndices.at(1)),
-            mesh->TextureCoordinates.at(face.MeshTextureCoordinateIndices.at(2)),
-        };
-        std::array<Eigen::Vector4f, 3> transformedVertices{
-            Eigen::Vector4f{ pointA.x(), pointA.y(), pointA.z(), 1.0f },
-            Eigen::Vector4f{ pointB.x(), pointB.y(), pointB.z(), 1.0f },
-            Eigen::Vector4f{ pointC.x(), pointC.y(), pointC.z(), 1.0f },
-        };
-
-        // Transform from local space -> world space -> camera space
-        for (auto& vertex : transformedVertices)
+    for (auto const& plane : m_viewFrustumPlanes)
+    {
+        if ((plane.head<3>().dot(viewSpaceCenter) + plane.w()) < -radius)
         {
-            vertex = viewMatrix * entityTranslate * entityRotate * vertex;
+            return false;
         }
+    }
+    return true;
+}
 
-        // Determine if this face is not visible and should be culled
-        auto faceNormal{ GetTriangleNormal(transformedVertices) };
-        Eigen::Vector3f cameraRay{ Eigen::Vector3f{ 0.0f, 0.0f, 0.0f } -
-            Eigen::Vector3f{ transformedVertices.at(0).x(), transformedVertices.at(0).y(),
-                transformedVertices.at(0).z() } };
-        if (faceNormal.dot(cameraRay) <= 0.0f)
+size_t Renderer::SelectLevelOfDetail(Mesh const* mesh, float distance) const
+{
+    // The coarsest level whose error, seen at the nearest point of the mesh's bounds, stays
+    // within the allowed number of pixels
+    float const maxError{ m_resolution.LevelOfDetailPixelError * distance /
+        m_pixelsPerUnitAtUnitDistance };
+    size_t selected{ 0 };
+    for (auto const& level : mesh->LevelsOfDetail)
+    {
+        if (level.GeometricError > maxError)
         {
-            continue;
+            break;
         }
+        ++selected;
+    }
+    return selected;
+}
 
-        // Clip the triangle to the camera frustum boundary
-        Polygon polygon{
-            .Vertices = {
-                transformedVertices.at(0).head<3>(),
-                transformedVertices.at(1).head<3>(),
-                transformedVertices.at(2).head<3>(),
-            },
-            .TextureCoordinates = std::vector<Eigen::Vector2f>(textureCoordinates.begin(),
-                textureCoordinates.end()),
-        };
-        for (const auto& planePair: m_frustumPlanes)
+void Renderer::QueueEntityTreeMeshes(Eigen::Matrix4f const& viewMatrix, Entity const* rootEntity,
+    size_t boundsIndex)
+{
+    // Skip the entity and everything under it when none of it can be on screen
+    auto const& bounds{ m_entityBounds.at(boundsIndex) };
+    if (!bounds.Sphere)
+    {
+        return;
+    }
+    if (!IsInViewFrustum((viewMatrix * bounds.Sphere->Center.homogeneous()).head<3>(),
+        bounds.Sphere->Radius))
+    {
+        m_frameBuffer.CountCulledMeshes(bounds.MeshCount, bounds.FaceCount);
+        return;
+    }
+
+    auto childBoundsIndex{ boundsIndex + 1 };
+    for (const auto& child : rootEntity->GetChildren())
+    {
+        QueueEntityTreeMeshes(viewMatrix, child.get(), childBoundsIndex);
+        childBoundsIndex += m_entityBounds.at(childBoundsIndex).EntityCount;
+    }
+    for (const auto& mesh : rootEntity->GetMeshes())
+    {
+        QueueEntityMesh(viewMatrix, rootEntity, mesh.get());
+    }
+}
+
+void Renderer::QueueEntityMesh(Eigen::Matrix4f const& viewMatrix, Entity const* entity,
+    Mesh const* mesh)
+{
+    Eigen::Matrix4f const modelViewMatrix{ viewMatrix * Translation(entity->GetPosition()) *
+        Rotation(entity->GetRotation()) };
+    auto const& localSphere{ mesh->Bounds.Sphere };
+    Eigen::Vector3f const viewSpaceCenter{
+        (modelViewMatrix * localSphere.Center.homogeneous()).head<3>() };
+    if (!IsInViewFrustum(viewSpaceCenter, localSphere.Radius))
+    {
+        m_frameBuffer.CountCulledMeshes(1, mesh->TriangleCount);
+        return;
+    }
+    float const distance{ std::max(c_nearPlane, viewSpaceCenter.norm() - localSphere.Radius) };
+    m_meshDraws.push_back(MeshDraw{ modelViewMatrix, mesh, SelectLevelOfDetail(mesh, distance),
+        distance });
+}
+
+void Renderer::FitTriangleBudget()
+{
+    if (m_resolution.TriangleBudget == 0)
+    {
+        return;
+    }
+    size_t triangleCount{ 0 };
+    for (auto const& draw : m_meshDraws)
+    {
+        triangleCount += LevelOfDetail(draw.Source, draw.Level)->TriangleCount;
+    }
+
+    // Swap in the coarser level that puts the least error on screen, one at a time, until
+    // the frame fits
+    auto const nextLevelError{ [this](size_t drawIndex)
+        {
+            auto const& draw{ m_meshDraws.at(drawIndex) };
+            return draw.Source->LevelsOfDetail.at(draw.Level).GeometricError *
+                m_pixelsPerUnitAtUnitDistance / draw.Distance;
+        } };
+    auto const isWorse{ [&nextLevelError](size_t a, size_t b)
         {
-            polygon = ClipPolygonAgainstPlane(polygon, planePair.second);
+            return nextLevelError(a) > nextLevelError(b);
+        } };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(isWorse)> coarsenable{ isWorse };
+    for (size_t i{ 0 }; i < m_meshDraws.size(); ++i)
+    {
+        if (m_meshDraws.at(i).Level < m_meshDraws.at(i).Source->LevelsOfDetail.size())
+        {
+            coarsenable.push(i);
         }
-
-        if (polygon.Vertices.size() < 3)
+    }
+    while ((triangleCount > m_resolution.TriangleBudget) && !coarsenable.empty())
+    {
+        auto const drawIndex{ coarsenable.top() };
+        coarsenable.pop();
+        auto& draw{ m_meshDraws.at(drawIndex) };
+        triangleCount -= LevelOfDetail(draw.Source, draw.Level)->TriangleCount;
+        ++draw.Level;
+        triangleCount += LevelOfDetail(draw.Source, draw.Level)->TriangleCount;
+        if (draw.Level < draw.Source->LevelsOfDetail.size())
         {
-            continue;
+            coarsenable.push(drawIndex);
         }
+    }
+}
 
-        auto triangles{ TrianglesFromPolygon(polygon) };
+void Renderer::DrawMesh(MeshDraw const& draw)
+{
+    auto const* const wanted{ LevelOfDetail(draw.Source, draw.Level) };
+    auto const* const mesh{ m_meshStreamer ? m_meshStreamer->Request(draw.Source, wanted) :
+        wanted };
+    if (!mesh || (mesh->Packed.VertexCount() == 0))
+    {
+        // Only the packed form is drawn, so a mesh that still has its faces would vanish
+        if (mesh && !mesh->Faces.empty())
+        {
+            LOG_AND_THROW("Mesh with {} faces was never packed for drawing", mesh->Faces.size());
+        }
+        return;
+    }
 
-        for (auto& triangle : triangles)
+    // Transform every vertex of the mesh once up front, rather than once for every face
+    // that shares it
+    std::visit([&](auto const& vertices)
+        {
+            TransformPackedVertices(vertices, mesh->Packed, draw.ModelView, m_projectionMatrix,
+                m_viewSpaceVertices, m_clipSpaceVertices, m_textureCoordinates);
+        }, mesh->Packed.Vertices);
+    std::visit([&](auto const& indices)
         {
-            // Apply perspective projection
-            std::array<Eigen::Vector4f, 3> projectedVertices;
-            for (size_t i{ 0 }; i < triangle.Vertices.size(); ++i)
+            for (size_t i{ 0 }; (i + 2) < indices.size(); i += 3)
             {
-                const auto& vertex{ triangle.Vertices.at(i) };
-                Eigen::Vector4f v{ vertex.x(), vertex.y(), vertex.z(), 1.0f };
-                projectedVertices.at(i) = m_projectionMatrix * v;
+                DrawMeshFace({ indices[i], indices[i + 1], indices[i + 2] }, mesh->Texture.get());
             }
+        }, mesh->Packed.Indices);
+}
 
-            // Translate to screen space
-            float halfWidth{ m_resolution.Width / 2.0f };
-            float halfHeight{ m_resolution.Height / 2.0f };
-            for (auto& vertex : projectedVertices)
-            {
-                vertex.x() = (vertex.x() / vertex.w()) * halfWidth + halfWidth;
-                vertex.y() = (vertex.y() / vertex.w()) * halfHeight + halfHeight;
-            }
-#if TRUE
-            m_frameBuffer.DrawTexturedTriangle(projectedVertices.at(0), projectedVertices.at(1),
-            projectedVertices.at(2), triangle.TextureCoordinates.at(0),
-            triangle.TextureCoordinates.at(1), triangle.TextureCoordinates.at(2),
-            mesh->Texture.get());
-#endif
-#if TRUE
-            // Draw wireframe
-            m_frameBuffer.DrawLine(projectedVertices.at(0).head<2>(), projectedVertices.at(1).head<2>(), 0xFF00FF00);
-            m_frameBuffer.DrawLine(projectedVertices.at(1).head<2>(), projectedVertices.at(2).head<2>(), 0xFF00FF00);
-            m_frameBuffer.DrawLine(projectedVertices.at(2).head<2>(), projectedVertices.at(0).head<2>(), 0xFF00FF00);
-#endif
+void Renderer::DrawMeshFace(std::array<size_t, 3> const& face, PngTexture* texture)
+{
+    std::array<Eigen::Vector2f, 3> textureCoordinates{
+        m_textureCoordinates.at(face.at(0)),
+        m_textureCoordinates.at(face.at(1)),
+        m_textureCoordinates.at(face.at(2)),
+    };
+    std::array<Eigen::Vector4f, 3> const viewVertices{
+        m_viewSpaceVertices.at(face.at(0)),
+        m_viewSpaceVertices.at(face.at(1)),
+        m_viewSpaceVertices.at(face.at(2)),
+    };
+
+    // Determine if this face is not visible and should be culled
+    auto faceNormal{ GetTriangleNormal(viewVertices) };
+    Eigen::Vector3f cameraRay{ Eigen::Vector3f{ 0.0f, 0.0f, 0.0f } -
+        Eigen::Vector3f{ viewVertices.at(0).x(), viewVertices.at(0).y(),
+            viewVertices.at(0).z() } };
+    if (faceNormal.dot(cameraRay) <= 0.0f)
+    {
+        return;
+    }
+
+    std::array<Eigen::Vector4f, 3> const clipVertices{
+        m_clipSpaceVertices.at(face.at(0)),
+        m_clipSpaceVertices.at(face.at(1)),
+        m_clipSpaceVertices.at(face.at(2)),
+    };
+
+    // Triangles entirely outside one frustum plane are dropped. Of the rest, only those
+    // reaching behind the near plane, past the far plane or out of the guard band need
+    // clipping; everything else goes to the rasterizer as is.
+    std::array<uint8_t, 3> const frustumCodes{
+        ClipCode(clipVertices.at(0), m_frustumPlanes),
+        ClipCode(clipVertices.at(1), m_frustumPlanes),
+        ClipCode(clipVertices.at(2), m_frustumPlanes) };
+    if ((frustumCodes.at(0) & frustumCodes.at(1) & frustumCodes.at(2)) != 0)
+    {
+        return;
+    }
+    Polygon polygon{
+        .Vertices = {
+            clipVertices.at(0),
+            clipVertices.at(1),
+            clipVertices.at(2),
+        },
+        .TextureCoordinates = {
+            textureCoordinates.at(0),
+            textureCoordinates.at(1),
+            textureCoordinates.at(2),
+        },
+        .VertexCount = 3,
+    };
+    uint8_t const crossedPlanes{ static_cast<uint8_t>(
+        ClipCode(clipVertices.at(0), m_clippingPlanes) |
+        ClipCode(clipVertices.at(1), m_clippingPlanes) |
+        ClipCode(clipVertices.at(2), m_clippingPlanes)) };
+    for (size_t i{ 0 }; i < m_clippingPlanes.size(); ++i)
+    {
+        if ((crossedPlanes & (1u << i)) != 0)
+        {
+            polygon = ClipPolygonAgainstPlane(polygon, m_clippingPlanes.at(i));
+        }
+    }
+
+    if (polygon.VertexCount < 3)
+    {
+        return;
+    }
+
+    // Fan the clipped polygon back out into triangles
+    for (size_t triangleIndex{ 0 }; triangleIndex < (polygon.VertexCount - 2); ++triangleIndex)
+    {
+        std::array<size_t, 3> const polygonIndices{ 0, (triangleIndex + 1),
+            (triangleIndex + 2) };
+        std::array<Eigen::Vector4f, 3> projectedVertices;
+        std::array<Eigen::Vector2f, 3> projectedTextureCoordinates;
+        for (size_t i{ 0 }; i < polygonIndices.size(); ++i)
+        {
+            projectedVertices.at(i) = polygon.Vertices.at(polygonIndices.at(i));
+            projectedTextureCoordinates.at(i) =
+                polygon.TextureCoordinates.at(polygonIndices.at(i));
+        }
+
+        // Translate to screen space
+        float halfWidth{ m_resolution.Width / 2.0f };
+        float halfHeight{ m_resolution.Height / 2.0f };
+        for (auto& vertex : projectedVertices)
+        {
+            vertex.x() = (vertex.x() / vertex.w()) * halfWidth + halfWidth;
+            vertex.y() = (vertex.y() / vertex.w()) * halfHeight + halfHeight;
         }
+        m_drawList.Add(RasterTriangle{
+            .Vertices = projectedVertices,
+            .TextureCoordinates = projectedTextureCoordinates,
+            .Texture = texture,
+            .VisibilityId = 0,
+        });
     }
 }
+
+void Renderer::SubmitTriangle(RasterTriangle triangle)
+{
+    if (m_renderMode == RenderMode::VisibilityBuffer)
+    {
+        auto const& vertices{ triangle.Vertices };
+        auto const& textureCoordinates{ triangle.TextureCoordinates };
+        triangle.VisibilityId = m_frameBuffer.DeferTexturedTriangle(vertices.at(0),
+            vertices.at(1), vertices.at(2), textureCoordinates.at(0), textureCoordinates.at(1),
+            textureCoordinates.at(2), triangle.Texture, m_pipelineState);
+    }
+    if (m_tileRasterizer)
+    {
+        m_tileRasterizer->Submit(triangle);
+    }
+    else
+    {
+        RasterizeTriangle(triangle, m_frameBuffer.Bounds());
+    }
+}
+
+void Renderer::RasterizeTriangle(RasterTriangle const& triangle, ScreenRect const& clipRect)
+{
+    auto const& vertices{ triangle.Vertices };
+    auto const& textureCoordinates{ triangle.TextureCoordinates };
+    if (m_renderMode == RenderMode::VisibilityBuffer)
+    {
+        m_frameBuffer.DrawTriangleVisibility(vertices.at(0), vertices.at(1), vertices.at(2),
+            triangle.VisibilityId, clipRect, m_pipelineState);
+    }
+    else
+    {
+        m_frameBuffer.DrawTexturedTriangle(vertices.at(0), vertices.at(1), vertices.at(2),
+            textureCoordinates.at(0), textureCoordinates.at(1), textureCoordinates.at(2),
+            triangle.Texture, clipRect, m_pipelineState);
+    }
+}
+
+void Renderer::ResolveVisibilityBuffer()
+{
+    auto const taskCount{ (m_resolution.Height + c_resolveRowsPerTask - 1) /
+        c_resolveRowsPerTask };
+    m_threadPool.ParallelFor(taskCount, [this](size_t taskIndex)
+        {
+            auto const firstRow{ static_cast<uint16_t>(taskIndex * c_resolveRowsPerTask) };
+            auto const lastRow{ static_cast<uint16_t>(std::min<size_t>(
+                (firstRow + c_resolveRowsPerTask - 1), (m_resolution.Height - 1))) };
+            m_frameBuffer.ResolveVisibility(firstRow, lastRow);
+        });
+    m_frameBuffer.EndVisibilityPass();
+}
 }
\ No newline at end of file
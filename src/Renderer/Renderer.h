@@ -1,7 +1,10 @@
 #pragma once
 #include "../Configuration.h"
+#include "../Mesh/MeshStreamer.h"
 #include "../Overlay/Overlay.h"
+#include "DrawList.h"
 #include "RenderTarget.h"
+#include "TileRasterizer.h"
 #include "../Simulation.h"
 
 enum class FrustumPlaneKind
@@ -17,24 +20,89 @@ enum class FrustumPlaneKind
 
 namespace game
 {
+// Planes in homogeneous clip space, as coefficients whose dot product with a vertex is
+// positive on the inside
+using ClipPlanes = std::array<Eigen::Vector4f, static_cast<size_t>(FrustumPlaneKind::MAX)>;
+
 struct Renderer
 {
     Renderer(std::shared_ptr<SDL_Window> window, VideoConfiguration const& resolution);
     void Render(SimulationState const& simulationState);
     void AddOverlay(std::shared_ptr<Overlay> overlay);
+    void SetRenderMode(RenderMode mode);
+    // State every triangle of the scene is drawn with
+    void SetPipelineState(PipelineState const& state);
+    // Meshes it manages are drawn at whatever level of detail is resident
+    void SetMeshStreamer(MeshStreamer* meshStreamer);
 
 private:
+    // World-space bounds of an entity together with all of its descendants
+    struct EntityBounds
+    {
+        std::optional<BoundingSphere> Sphere;
+        // Number of entities in the subtree, including the entity itself
+        size_t EntityCount;
+        size_t MeshCount;
+        size_t FaceCount;
+    };
+
+    // A mesh that survived culling, waiting for the frame's levels of detail to be settled
+    struct MeshDraw
+    {
+        Eigen::Matrix4f ModelView;
+        Mesh const* Source;
+        // Level of the mesh's chain to draw: 0 for the mesh itself, then its levels of detail
+        size_t Level;
+        // From the camera to the nearest point of the mesh's bounds
+        float Distance;
+    };
+
     std::shared_ptr<SDL_Window> const m_window;
     VideoConfiguration const m_resolution;
     SDLRendererPtr const m_renderer;
     RenderTarget m_frameBuffer;
+    ThreadPool m_threadPool;
+    std::unique_ptr<TileRasterizer> const m_tileRasterizer;
+    DrawList m_drawList;
     SDLTexturePtr const m_frameBufferTexture;
     Eigen::Matrix4f const m_projectionMatrix;
-    std::unordered_map<FrustumPlaneKind, Plane> const m_frustumPlanes; // TODO: Again, should be generated by/from the Camera entity.
+    // Triangles entirely outside one of the view frustum planes are dropped. The rest are
+    // only clipped geometrically against the near and far planes and a guard band around
+    // the screen; anything else past the screen edges is scissored by the rasterizer.
+    ClipPlanes const m_frustumPlanes; // TODO: Again, should be generated by/from the Camera entity.
+    ClipPlanes const m_clippingPlanes;
+    // The view frustum planes in camera space, normalized so they give signed distances
+    ClipPlanes const m_viewFrustumPlanes;
+    // Size on screen, in pixels, of one unit of length at a distance of one unit
+    float const m_pixelsPerUnitAtUnitDistance;
     std::vector<std::shared_ptr<Overlay>> m_overlays;
+    // Scratch space for the vertices of the mesh being drawn, reused from mesh to mesh
+    std::vector<Eigen::Vector4f> m_viewSpaceVertices;
+    std::vector<Eigen::Vector4f> m_clipSpaceVertices;
+    std::vector<Eigen::Vector2f> m_textureCoordinates;
+    // Bounds of every entity in the scene for the current frame, in depth-first order
+    std::vector<EntityBounds> m_entityBounds;
+    // Meshes to draw in the current frame, in the order they were found
+    std::vector<MeshDraw> m_meshDraws;
+    RenderMode m_renderMode;
+    PipelineState m_pipelineState{ .IsWireframe = true };
+    MeshStreamer* m_meshStreamer{ nullptr };
 
     void DrawScene(CameraEntity const* cameraEntity, Entity const* sceneEntity);
-    void DrawEntityTreeMeshes(Eigen::Matrix4f const& viewMatrix, Entity const* rootEntity);
-    void DrawEntityMesh(Eigen::Matrix4f const& viewMatrix, Entity const* entity, Mesh const* mesh);
+    size_t GatherEntityBounds(Entity const* rootEntity);
+    bool IsInViewFrustum(Eigen::Vector3f const& viewSpaceCenter, float radius) const;
+    void QueueEntityTreeMeshes(Eigen::Matrix4f const& viewMatrix, Entity const* rootEntity,
+        size_t boundsIndex);
+    size_t SelectLevelOfDetail(Mesh const* mesh, float distance) const;
+    void QueueEntityMesh(Eigen::Matrix4f const& viewMatrix, Entity const* entity,
+        Mesh const* mesh);
+    // Coarsens the queued meshes until their triangles fit the budget
+    void FitTriangleBudget();
+    void DrawMesh(MeshDraw const& draw);
+    // Draws one face of the mesh whose vertices were last transformed into the scratch space
+    void DrawMeshFace(std::array<size_t, 3> const& face, PngTexture* texture);
+    void SubmitTriangle(RasterTriangle triangle);
+    void RasterizeTriangle(RasterTriangle const& triangle, ScreenRect const& clipRect);
+    void ResolveVisibilityBuffer();
 };
 }
\ No newline at end of file
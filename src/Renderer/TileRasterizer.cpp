@@ -0,0 +1,94 @@
+#include <pch.h>
+#include "TileRasterizer.h"
+
+namespace
+{
+    constexpr uint16_t c_tileSize{ 64 };
+
+    uint16_t TileCount(uint16_t pixels)
+    {
+        return static_cast<uint16_t>((pixels + c_tileSize - 1) / c_tileSize);
+    }
+}
+
+namespace game
+{
+TileRasterizer::TileRasterizer(RenderTarget* target, ThreadPool* threadPool) :
+    m_target{ target }, m_tileCountX{ TileCount(target->Width) },
+    m_tileCountY{ TileCount(target->Height) }, m_tileBins(m_tileCountX * m_tileCountY),
+    m_threadPool{ threadPool }
+{
+    // The thread calling Flush rasterizes tiles too, so it counts as one of the workers
+    SPDLOG_INFO("Tile rasterizer using {} threads for {}x{} tiles",
+        (m_threadPool->ThreadCount() + 1), m_tileCountX, m_tileCountY);
+}
+
+void TileRasterizer::Submit(RasterTriangle const& triangle)
+{
+    // Bin against the triangle's screen-space bounding box. This is the same box the
+    // RenderTarget walks when filling the triangle, and it also contains its wireframe.
+    auto const& a{ triangle.Vertices.at(0) };
+    auto const& b{ triangle.Vertices.at(1) };
+    auto const& c{ triangle.Vertices.at(2) };
+    float minX{ std::floor(std::min({ a.x(), b.x(), c.x() })) };
+    float minY{ std::floor(std::min({ a.y(), b.y(), c.y() })) };
+    float maxX{ std::ceil(std::max({ a.x(), b.x(), c.x() })) };
+    float maxY{ std::ceil(std::max({ a.y(), b.y(), c.y() })) };
+    if ((maxX < 0.0f) || (maxY < 0.0f) ||
+        (minX >= m_target->Width) || (minY >= m_target->Height))
+    {
+        return;
+    }
+    auto tileMinX{ static_cast<uint16_t>(std::max(minX, 0.0f) / c_tileSize) };
+    auto tileMinY{ static_cast<uint16_t>(std::max(minY, 0.0f) / c_tileSize) };
+    auto tileMaxX{ static_cast<uint16_t>(
+        std::min(maxX, static_cast<float>(m_target->Width - 1)) / c_tileSize) };
+    auto tileMaxY{ static_cast<uint16_t>(
+        std::min(maxY, static_cast<float>(m_target->Height - 1)) / c_tileSize) };
+
+    auto triangleIndex{ static_cast<uint32_t>(m_triangles.size()) };
+    m_triangles.push_back(triangle);
+    for (uint16_t tileY{ tileMinY }; tileY <= tileMaxY; ++tileY)
+    {
+        for (uint16_t tileX{ tileMinX }; tileX <= tileMaxX; ++tileX)
+        {
+            m_tileBins.at((tileY * m_tileCountX) + tileX).push_back(triangleIndex);
+        }
+    }
+}
+
+void TileRasterizer::Flush(RasterizeFunction const& rasterize)
+{
+    m_threadPool->ParallelFor(m_tileBins.size(), [this, &rasterize](size_t tileIndex)
+        {
+            ScreenRect const tileRect{ TileRect(tileIndex) };
+            for (auto triangleIndex : m_tileBins.at(tileIndex))
+            {
+                rasterize(m_triangles.at(triangleIndex), tileRect);
+            }
+        });
+
+    // Keep the bin allocations around for the next frame
+    m_triangles.clear();
+    for (auto& bin : m_tileBins)
+    {
+        bin.clear();
+    }
+}
+
+ScreenRect TileRasterizer::TileRect(size_t tileIndex) const
+{
+    auto tileX{ static_cast<uint16_t>(tileIndex % m_tileCountX) };
+    auto tileY{ static_cast<uint16_t>(tileIndex / m_tileCountX) };
+    auto minX{ static_cast<uint16_t>(tileX * c_tileSize) };
+    auto minY{ static_cast<uint16_t>(tileY * c_tileSize) };
+    return ScreenRect{
+        .MinX = minX,
+        .MinY = minY,
+        .MaxX = std::min(static_cast<uint16_t>(minX + c_tileSize - 1),
+            static_cast<uint16_t>(m_target->Width - 1)),
+        .MaxY = std::min(static_cast<uint16_t>(minY + c_tileSize - 1),
+            static_cast<uint16_t>(m_target->Height - 1)),
+    };
+}
+}
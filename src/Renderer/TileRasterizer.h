@@ -0,0 +1,40 @@
+#pragma once
+#include "RenderTarget.h"
+#include "../Utility/ThreadPool.h"
+
+namespace game
+{
+// A triangle that has already been projected to screen space and is ready to be drawn.
+struct RasterTriangle
+{
+    std::array<Eigen::Vector4f, 3> Vertices;
+    std::array<Eigen::Vector2f, 3> TextureCoordinates;
+    PngTexture* Texture;
+    // Index of the triangle's shading in the render target when drawing a visibility buffer
+    uint32_t VisibilityId;
+};
+
+// Sort-middle rasterizer. Submitted triangles are binned into fixed-size screen tiles, and
+// on Flush the tiles are rasterized in parallel. Every tile only ever touches its own
+// slice of the render target's pixel and depth buffers, so workers need no locking, and
+// triangles within a tile are drawn in submission order so the result matches drawing
+// them one at a time.
+struct TileRasterizer
+{
+    using RasterizeFunction = std::function<void(RasterTriangle const&, ScreenRect const&)>;
+
+    TileRasterizer(RenderTarget* target, ThreadPool* threadPool);
+    void Submit(RasterTriangle const& triangle);
+    void Flush(RasterizeFunction const& rasterize);
+
+private:
+    RenderTarget* const m_target;
+    uint16_t const m_tileCountX;
+    uint16_t const m_tileCountY;
+    std::vector<RasterTriangle> m_triangles;
+    std::vector<std::vector<uint32_t>> m_tileBins;
+    ThreadPool* const m_threadPool;
+
+    ScreenRect TileRect(size_t tileIndex) const;
+};
+}
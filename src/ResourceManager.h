@@ -1,5 +1,8 @@
 #pragma once
+#include "AssetRegistry.h"
+#include "Configuration.h"
 #include "Mesh/Mesh.h"
+#include "Mesh/MeshStreamer.h"
 #include "Painter/TextPainter.h"
 
 namespace game
@@ -15,17 +18,54 @@ enum class MeshResourceKind
 {
     UNKNOWN = 0,
     SandyLandscape,
+    F22,
     MAX_VALUE,
 };
 
 struct ResourceManager
 {
-    static void Initialize();
+    // Starts loading every resource on a pool of worker threads, and returns without waiting
+    // for any of them to finish
+    static void Initialize(StreamingConfiguration const& configuration);
+    // Waits for loads still running and stops the worker threads. Called before exiting, so
+    // no load is left running while static objects it uses, such as the logger, are
+    // destroyed. No resource can be loaded afterwards.
+    static void Shutdown();
+    // Resources that may still be loading. The getters below wait on these, so only the
+    // first use of a resource blocks, and only until that one resource is ready.
+    static std::shared_future<std::shared_ptr<TextPainter>> GetTextPainterAsync(
+        TextPainterResourceKind kind);
+    static std::shared_future<std::shared_ptr<Mesh>> GetMeshAsync(MeshResourceKind kind);
+    static std::shared_future<std::vector<std::shared_ptr<Mesh>>> GetMeshChunksAsync(
+        MeshResourceKind kind);
     static std::shared_ptr<TextPainter> GetTextPainter(TextPainterResourceKind kind);
     static std::shared_ptr<Mesh> GetMesh(MeshResourceKind kind);
+    // The mesh of the given kind split into spatial chunks that can be culled separately
+    static std::vector<std::shared_ptr<Mesh>> const& GetMeshChunks(MeshResourceKind kind);
+    // Assets by path. However often one is asked for, it is only loaded once, and every
+    // handle to it shares the one copy. Each layout and format of a texture is loaded as a
+    // texture of its own.
+    static AssetHandle<PngTexture> LoadTexture(std::filesystem::path const& path,
+        PngTexture::Layout layout = PngTexture::Layout::Linear,
+        PngTexture::Format format = PngTexture::Format::Argb);
+    // A prop mesh along with its levels of detail. Loading the same mesh with another texture,
+    // or the same texture in another format, gives a mesh of its own.
+    static AssetHandle<Mesh> LoadMesh(std::filesystem::path const& objFilePath,
+        std::filesystem::path const& textureFilePath,
+        PngTexture::Format textureFormat = PngTexture::Format::Argb);
+    static std::vector<AssetRegistry::AssetInfo> Assets();
+    // Decides which levels of detail of the loaded meshes are resident
+    static MeshStreamer& GetMeshStreamer();
 
 private:
-    static std::unordered_map<TextPainterResourceKind, std::shared_ptr<TextPainter>> m_textPainters;
-    static std::unordered_map<MeshResourceKind, std::shared_ptr<Mesh>> m_meshes;
+    static std::unique_ptr<AssetRegistry> m_assets;
+    static std::unique_ptr<ThreadPool> m_loadingThreadPool;
+    static std::unique_ptr<MeshStreamer> m_meshStreamer;
+    static std::unordered_map<TextPainterResourceKind,
+        std::shared_future<std::shared_ptr<TextPainter>>> m_textPainters;
+    static std::unordered_map<MeshResourceKind, std::shared_future<std::shared_ptr<Mesh>>>
+        m_meshes;
+    static std::unordered_map<MeshResourceKind,
+        std::shared_future<std::vector<std::shared_ptr<Mesh>>>> m_meshChunks;
 };
-}
\ No newline at end of file
+}
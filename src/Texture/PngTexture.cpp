@@ -4,35 +4,410 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-std::shared_ptr<PngTexture> PngTexture::FromPngFile(const std::filesystem::path &file)
-{
-    return std::shared_ptr<PngTexture>(new PngTexture(file));
-}
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GAME_HAS_X86_SWIZZLE 1
+#include <immintrin.h>
+// MSVC allows intrinsics for any instruction set, GCC and Clang need each function that
+// uses them to opt in to the target.
+#ifdef _MSC_VER
+#define TARGET_SSE41
+#else
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#endif
+#endif
 
-const uint16_t &PngTexture::Width()
+namespace
 {
-    return m_width;
-}
+    using SwizzleFunction = void (*)(std::byte const* rgba, uint32_t* argb, size_t count);
 
-const uint16_t &PngTexture::Height()
-{
-    return m_height;
+    void SwizzleScalar(std::byte const* rgba, uint32_t* argb, size_t count)
+    {
+        for (size_t i{ 0 }; i < count; ++i)
+        {
+            auto const* pixel{ rgba + (i * 4) };
+            // Internal 32-bit pixel format is 0xAARRGGBB
+            argb[i] = static_cast<uint32_t>(pixel[2]) |
+                (static_cast<uint32_t>(pixel[1]) << 8) |
+                (static_cast<uint32_t>(pixel[0]) << 16) |
+                (static_cast<uint32_t>(pixel[3]) << 24);
+        }
+    }
+
+#ifdef GAME_HAS_X86_SWIZZLE
+    // Reorders each pixel's bytes from R, G, B, A to B, G, R, A, which is 0xAARRGGBB read
+    // as a little-endian word, four pixels per shuffle
+    TARGET_SSE41 void SwizzleSse41(std::byte const* rgba, uint32_t* argb, size_t count)
+    {
+        __m128i const order{ _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12,
+            15) };
+        size_t i{ 0 };
+        for (; (i + 4) <= count; i += 4)
+        {
+            __m128i const pixels{ _mm_loadu_si128(
+                reinterpret_cast<__m128i const*>(rgba + (i * 4))) };
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(argb + i),
+                _mm_shuffle_epi8(pixels, order));
+        }
+        SwizzleScalar(rgba + (i * 4), argb + i, count - i);
+    }
+#endif
+
+    SwizzleFunction SelectSwizzleFunction()
+    {
+#ifdef GAME_HAS_X86_SWIZZLE
+        if (SDL_HasSSE41())
+        {
+            return &SwizzleSse41;
+        }
+#endif
+        return &SwizzleScalar;
+    }
+
+    uint16_t TileCount(uint16_t texels)
+    {
+        return static_cast<uint16_t>((texels + PngTexture::c_tileSize - 1) /
+            PngTexture::c_tileSize);
+    }
+
+    // Spreads the bits of a coordinate within a tile out to every other bit, so the bits
+    // of x and y can be interleaved into a Z-order index
+    constexpr uint32_t SpreadBits(uint32_t value)
+    {
+        return (value & 1u) | ((value & 2u) << 1) | ((value & 4u) << 2);
+    }
+    static_assert(PngTexture::c_tileSize == 8, "SpreadBits spreads three bits per coordinate");
+
+    // Texels along one side of a mip level
+    uint16_t MipSize(uint16_t size, size_t level)
+    {
+        return static_cast<uint16_t>(std::max(size >> level, 1));
+    }
+
+    uint16_t BlockCount(uint16_t texels)
+    {
+        return static_cast<uint16_t>((texels + PngTexture::c_bc1BlockSize - 1) /
+            PngTexture::c_bc1BlockSize);
+    }
+    static_assert(PngTexture::c_tileSize == (2 * PngTexture::c_bc1BlockSize),
+        "A tile holds 2x2 Bc1 blocks");
+
+    // Words holding one mip level of the given size, not counting any palette
+    size_t LevelStorageSize(uint16_t width, uint16_t height, PngTexture::Layout layout,
+        PngTexture::Format format)
+    {
+        bool const isTiled{ layout == PngTexture::Layout::Tiled };
+        if (format == PngTexture::Format::Bc1)
+        {
+            size_t const blocks{ isTiled ?
+                (static_cast<size_t>(TileCount(width)) * TileCount(height) * 4) :
+                (static_cast<size_t>(BlockCount(width)) * BlockCount(height)) };
+            return blocks * 2;
+        }
+        size_t const texels{ isTiled ?
+            (static_cast<size_t>(TileCount(width)) * TileCount(height) *
+                PngTexture::c_tileSize * PngTexture::c_tileSize) :
+            (static_cast<size_t>(width) * height) };
+        return (format == PngTexture::Format::Palettized) ? ((texels + 3) / 4) : texels;
+    }
+
+    uint32_t Channel(uint32_t color, size_t channel)
+    {
+        return (color >> (channel * 8)) & 0xFF;
+    }
+
+    uint32_t ColorDistance(uint32_t a, uint32_t b, size_t channelCount)
+    {
+        uint32_t distance{ 0 };
+        for (size_t channel{ 0 }; channel < channelCount; ++channel)
+        {
+            auto const difference{ static_cast<int32_t>(Channel(a, channel)) -
+                static_cast<int32_t>(Channel(b, channel)) };
+            distance += static_cast<uint32_t>(difference * difference);
+        }
+        return distance;
+    }
+
+    // Picks a palette for the given colours by median cut: starting from one box holding
+    // them all, the box spanning the widest range of any channel is split at its median
+    // along that channel until there are enough boxes, and each box gives its mean colour
+    std::vector<uint32_t> BuildPalette(std::vector<uint32_t> colors)
+    {
+        // Each distinct colour, with how many texels have it
+        std::ranges::sort(colors);
+        std::vector<std::pair<uint32_t, size_t>> counts;
+        for (auto const color : colors)
+        {
+            if (!counts.empty() && (counts.back().first == color))
+            {
+                ++counts.back().second;
+            }
+            else
+            {
+                counts.emplace_back(color, 1);
+            }
+        }
+
+        struct Box
+        {
+            size_t Begin;
+            size_t End;
+            size_t WidestChannel;
+            uint32_t Range;
+        };
+        auto const makeBox{ [&counts](size_t begin, size_t end)
+            {
+                Box box{ begin, end, 0, 0 };
+                for (size_t channel{ 0 }; channel < 4; ++channel)
+                {
+                    auto const [least, most]{ std::ranges::minmax(std::ranges::subrange(
+                        counts.begin() + begin, counts.begin() + end), {},
+                        [channel](auto const& count) { return Channel(count.first, channel); }) };
+                    auto const range{ Channel(most.first, channel) -
+                        Channel(least.first, channel) };
+                    if (range > box.Range)
+                    {
+                        box.WidestChannel = channel;
+                        box.Range = range;
+                    }
+                }
+                return box;
+            } };
+        std::vector<Box> boxes{ makeBox(0, counts.size()) };
+        while (boxes.size() < PngTexture::c_paletteSize)
+        {
+            auto const widest{ std::ranges::max_element(boxes, {}, &Box::Range) };
+            if ((widest == boxes.end()) || (widest->Range == 0))
+            {
+                break;
+            }
+            auto const box{ *widest };
+            auto const begin{ counts.begin() + box.Begin };
+            auto const end{ counts.begin() + box.End };
+            std::sort(begin, end, [channel{ box.WidestChannel }](auto const& a, auto const& b)
+                {
+                    return Channel(a.first, channel) < Channel(b.first, channel);
+                });
+            size_t texelCount{ 0 };
+            for (auto it{ begin }; it != end; ++it)
+            {
+                texelCount += it->second;
+            }
+            // Splits after the colour that takes the running count past half the texels,
+            // keeping at least one colour on each side
+            size_t split{ box.Begin + 1 };
+            for (size_t seen{ begin->second }; (split + 1) < box.End; ++split)
+            {
+                if ((seen * 2) >= texelCount)
+                {
+                    break;
+                }
+                seen += counts.at(split).second;
+            }
+            *widest = makeBox(box.Begin, split);
+            boxes.push_back(makeBox(split, box.End));
+        }
+
+        std::vector<uint32_t> palette(PngTexture::c_paletteSize, 0);
+        for (size_t i{ 0 }; i < boxes.size(); ++i)
+        {
+            std::array<size_t, 4> channelSums{};
+            size_t texelCount{ 0 };
+            for (size_t j{ boxes.at(i).Begin }; j < boxes.at(i).End; ++j)
+            {
+                auto const& [color, count]{ counts.at(j) };
+                for (size_t channel{ 0 }; channel < channelSums.size(); ++channel)
+                {
+                    channelSums.at(channel) += Channel(color, channel) * count;
+                }
+                texelCount += count;
+            }
+            for (size_t channel{ 0 }; (texelCount > 0) && (channel < channelSums.size());
+                ++channel)
+            {
+                palette.at(i) |= static_cast<uint32_t>(
+                    (channelSums.at(channel) + (texelCount / 2)) / texelCount) << (channel * 8);
+            }
+        }
+        return palette;
+    }
+
+    uint32_t Rgb565ToArgb(uint32_t color)
+    {
+        uint32_t const red{ (color >> 11) & 0x1F };
+        uint32_t const green{ (color >> 5) & 0x3F };
+        uint32_t const blue{ color & 0x1F };
+        return 0xFF000000 | (((red << 3) | (red >> 2)) << 16) |
+            (((green << 2) | (green >> 4)) << 8) | ((blue << 3) | (blue >> 2));
+    }
+
+    uint32_t ArgbToRgb565(uint32_t color)
+    {
+        auto const quantize{ [color](size_t channel, uint32_t most)
+            {
+                return ((Channel(color, channel) * most) + 127) / 255;
+            } };
+        return (quantize(2, 31) << 11) | (quantize(1, 63) << 5) | quantize(0, 31);
+    }
+
+    // Colour of a texel of a BC1 block with the given end colours, from its two-bit index
+    uint32_t DecodeBc1Texel(uint32_t endColors, uint32_t index)
+    {
+        uint32_t const first{ endColors & 0xFFFF };
+        uint32_t const second{ endColors >> 16 };
+        if (index < 2)
+        {
+            return Rgb565ToArgb((index == 0) ? first : second);
+        }
+        bool const isFourColor{ first > second };
+        if (!isFourColor && (index == 3))
+        {
+            return 0;
+        }
+        // Two thirds of the way from one end colour to the other, or halfway
+        uint32_t const firstWeight{ isFourColor ? ((index == 2) ? 2u : 1u) : 1u };
+        uint32_t const secondWeight{ isFourColor ? (3 - firstWeight) : 1u };
+        auto const a{ Rgb565ToArgb(first) };
+        auto const b{ Rgb565ToArgb(second) };
+        uint32_t color{ 0xFF000000 };
+        for (size_t channel{ 0 }; channel < 3; ++channel)
+        {
+            auto const total{ firstWeight + secondWeight };
+            color |= (((Channel(a, channel) * firstWeight) + (Channel(b, channel) * secondWeight) +
+                (total / 2)) / total) << (channel * 8);
+        }
+        return color;
+    }
+
+    // Encodes a block of texels, row by row, as BC1. The end colours are the texels
+    // furthest apart along the direction the opaque texels' colours vary most. Texels less
+    // than half opaque make the block use three colours and transparent black.
+    std::array<uint32_t, 2> EncodeBc1Block(
+        std::array<uint32_t, PngTexture::c_bc1BlockSize * PngTexture::c_bc1BlockSize> const&
+            texels)
+    {
+        auto const isOpaque{ [](uint32_t texel) { return Channel(texel, 3) >= 0x80; } };
+        auto const toVector{ [](uint32_t texel)
+            {
+                return Eigen::Vector3f{ static_cast<float>(Channel(texel, 2)),
+                    static_cast<float>(Channel(texel, 1)), static_cast<float>(Channel(texel, 0)) };
+            } };
+        Eigen::Vector3f mean{ Eigen::Vector3f::Zero() };
+        size_t opaqueCount{ 0 };
+        for (auto const texel : texels)
+        {
+            if (isOpaque(texel))
+            {
+                mean += toVector(texel);
+                ++opaqueCount;
+            }
+        }
+        if (opaqueCount == 0)
+        {
+            return { 0, 0xFFFFFFFF };
+        }
+        mean /= static_cast<float>(opaqueCount);
+        Eigen::Matrix3f covariance{ Eigen::Matrix3f::Zero() };
+        for (auto const texel : texels)
+        {
+            if (isOpaque(texel))
+            {
+                Eigen::Vector3f const offset{ toVector(texel) - mean };
+                covariance += offset * offset.transpose();
+            }
+        }
+        // A few rounds of power iteration find the covariance's principal axis well enough
+        // to pick end colours by, starting from the column of the channel that varies most
+        Eigen::Index widestChannel;
+        covariance.diagonal().maxCoeff(&widestChannel);
+        Eigen::Vector3f axis{ covariance.col(widestChannel) };
+        for (int i{ 0 }; i < 8; ++i)
+        {
+            Eigen::Vector3f const next{ covariance * axis };
+            float const length{ next.norm() };
+            if (!(length > 0.0f))
+            {
+                break;
+            }
+            axis = next / length;
+        }
+        uint32_t least{ 0 };
+        uint32_t most{ 0 };
+        float leastProjection{ std::numeric_limits<float>::max() };
+        float mostProjection{ std::numeric_limits<float>::lowest() };
+        for (auto const texel : texels)
+        {
+            if (!isOpaque(texel))
+            {
+                continue;
+            }
+            float const projection{ axis.dot(toVector(texel)) };
+            if (projection < leastProjection)
+            {
+                leastProjection = projection;
+                least = texel;
+            }
+            if (projection > mostProjection)
+            {
+                mostProjection = projection;
+                most = texel;
+            }
+        }
+
+        bool const hasTransparency{ opaqueCount < texels.size() };
+        auto first{ ArgbToRgb565(most) };
+        auto second{ ArgbToRgb565(least) };
+        // Four colours need the first end colour greater, three with transparency need it
+        // no greater
+        if (hasTransparency == (first > second))
+        {
+            std::swap(first, second);
+        }
+        uint32_t const endColors{ first | (second << 16) };
+        std::array<uint32_t, 4> colors;
+        for (uint32_t index{ 0 }; index < colors.size(); ++index)
+        {
+            colors.at(index) = DecodeBc1Texel(endColors, index);
+        }
+        uint32_t const opaqueColorCount{ (first > second) ? 4u : 3u };
+        uint32_t indices{ 0 };
+        for (size_t i{ 0 }; i < texels.size(); ++i)
+        {
+            uint32_t best{ 3 };
+            if (isOpaque(texels.at(i)))
+            {
+                best = 0;
+                for (uint32_t index{ 1 }; index < opaqueColorCount; ++index)
+                {
+                    if (ColorDistance(texels.at(i), colors.at(index), 3) <
+                        ColorDistance(texels.at(i), colors.at(best), 3))
+                    {
+                        best = index;
+                    }
+                }
+            }
+            indices |= best << (i * 2);
+        }
+        return { endColors, indices };
+    }
 }
 
-const uint32_t &PngTexture::ColorAt(uint16_t x, uint16_t y)
+namespace game
+{
+void ConvertRgbaToArgb(std::span<std::byte const> rgba, std::span<uint32_t> argb)
 {
-    auto index = (y * m_width) + x;
-    return m_pixels.at(index);
+    static SwizzleFunction const swizzle{ SelectSwizzleFunction() };
+    swizzle(rgba.data(), argb.data(), std::min(rgba.size() / 4, argb.size()));
+}
 }
 
-PngTexture::PngTexture(const std::filesystem::path& file)
+std::shared_ptr<PngTexture> PngTexture::FromPngFile(const std::filesystem::path &file)
 {
     SPDLOG_INFO("Loading texture from PNG file '{}'...", file.string());
     int width;
     int height;
     int componentsPerPixel;
-    unsigned char* data{ stbi_load(
-        file.string().c_str(), &width, &height, &componentsPerPixel, 4) };
+    std::unique_ptr<unsigned char, decltype(&stbi_image_free)> const data{ stbi_load(
+        file.string().c_str(), &width, &height, &componentsPerPixel, 4), &stbi_image_free };
     if (data == nullptr)
     {
         SPDLOG_ERROR("Error loading PNG data for '{}'", file.string());
@@ -43,27 +418,368 @@ PngTexture::PngTexture(const std::filesystem::path& file)
         SPDLOG_ERROR("PNG file '{}' is not 4 channels per pixel - cannot load", file.string());
         throw std::invalid_argument("PNG specified with invalid channels (4 expected)");
     }
-    m_width = static_cast<uint16_t>(width);
-    m_height = static_cast<uint16_t>(height);
-    m_pixels.reserve(width * height);
-    for (int i{ 0 }; i < height; ++i)
+    auto const pixelCount{ static_cast<size_t>(width) * static_cast<size_t>(height) };
+    auto pixels{ std::make_shared<std::vector<uint32_t>>(pixelCount) };
+    game::ConvertRgbaToArgb(
+        std::as_bytes(std::span{ data.get(), pixelCount * 4 }), *pixels);
+    SPDLOG_INFO("Loaded texture '{}' @ {}x{} pixels", file.filename().string(), width,
+        height);
+    std::span<uint32_t const> const pixelSpan{ *pixels };
+    return FromPixels(static_cast<uint16_t>(width), static_cast<uint16_t>(height),
+        pixelSpan, std::move(pixels));
+}
+
+std::shared_ptr<PngTexture> PngTexture::FromPixels(uint16_t width, uint16_t height,
+    std::span<uint32_t const> pixels, std::shared_ptr<void const> storage, Layout layout,
+    size_t mipLevelCount, Format format)
+{
+    if ((mipLevelCount == 0) || (mipLevelCount > FullMipLevelCount(width, height)) ||
+        (pixels.size() != StorageSize(width, height, layout, mipLevelCount, format)))
+    {
+        SPDLOG_ERROR("{} pixels given for a {}x{} texture with {} mip levels", pixels.size(),
+            width, height, mipLevelCount);
+        throw std::invalid_argument("Texture pixel count doesn't match its size");
+    }
+    return std::shared_ptr<PngTexture>(new PngTexture(width, height, pixels,
+        std::move(storage), layout, mipLevelCount, format));
+}
+
+size_t PngTexture::StorageSize(uint16_t width, uint16_t height, Layout layout,
+    size_t mipLevelCount, Format format)
+{
+    size_t size{ (format == Format::Palettized) ? c_paletteSize : 0 };
+    for (size_t level{ 0 }; level < mipLevelCount; ++level)
+    {
+        size += LevelStorageSize(MipSize(width, level), MipSize(height, level), layout, format);
+    }
+    return size;
+}
+
+size_t PngTexture::FullMipLevelCount(uint16_t width, uint16_t height)
+{
+    return static_cast<size_t>(std::bit_width(std::max<unsigned>({ width, height, 1u })));
+}
+
+const uint16_t &PngTexture::Width()
+{
+    return m_width;
+}
+
+const uint16_t &PngTexture::Height()
+{
+    return m_height;
+}
+
+uint32_t PngTexture::ColorAt(uint16_t x, uint16_t y, size_t level)
+{
+    auto const& mipLevel{ m_mipLevels.at(level) };
+    if ((x >= mipLevel.Width) || (y >= mipLevel.Height))
+    {
+        throw std::out_of_range("Texture coordinate out of range");
+    }
+    switch (m_format)
     {
-        for (int j{ 0 }; j < width; ++j)
+    case Format::Palettized:
+    {
+        auto const index{ PixelIndex(mipLevel, x, y) };
+        return m_palette[(mipLevel.Pixels[index / 4] >> ((index % 4) * 8)) & 0xFF];
+    }
+    case Format::Bc1:
+    {
+        auto const block{ mipLevel.Pixels.subspan(BlockIndex(mipLevel, x, y) * 2, 2) };
+        auto const texel{ ((y % c_bc1BlockSize) * c_bc1BlockSize) + (x % c_bc1BlockSize) };
+        return DecodeBc1Texel(block[0], (block[1] >> (texel * 2)) & 0x3);
+    }
+    default:
+        return mipLevel.Pixels[PixelIndex(mipLevel, x, y)];
+    }
+}
+
+std::span<uint32_t const> PngTexture::Pixels() const
+{
+    return m_pixels;
+}
+
+PngTexture::Layout PngTexture::GetLayout() const
+{
+    return m_layout;
+}
+
+PngTexture::Format PngTexture::GetFormat() const
+{
+    return m_format;
+}
+
+size_t PngTexture::MipLevelCount() const
+{
+    return m_mipLevels.size();
+}
+
+PngTexture::MipLevel const& PngTexture::GetMipLevel(size_t level) const
+{
+    return m_mipLevels.at(level);
+}
+
+std::shared_ptr<PngTexture> PngTexture::WithLayout(Layout layout)
+{
+    if (layout == m_layout)
+    {
+        return std::shared_ptr<PngTexture>(new PngTexture(m_width, m_height, m_pixels,
+            m_storage, m_layout, m_mipLevels.size(), m_format));
+    }
+    if (m_format != Format::Argb)
+    {
+        // Compact formats are rearranged as decoded colours, then encoded again
+        return WithFormat(Format::Argb)->WithLayout(layout)->WithFormat(m_format);
+    }
+    auto pixels{ std::make_shared<std::vector<uint32_t>>(
+        StorageSize(m_width, m_height, layout, m_mipLevels.size())) };
+    PngTexture const laidOut{ m_width, m_height, *pixels, nullptr, layout, m_mipLevels.size(),
+        Format::Argb };
+    for (size_t level{ 0 }; level < m_mipLevels.size(); ++level)
+    {
+        auto const& from{ m_mipLevels.at(level) };
+        auto const& to{ laidOut.m_mipLevels.at(level) };
+        auto const toOffset{ static_cast<size_t>(to.Pixels.data() - laidOut.m_pixels.data()) };
+        for (uint16_t y{ 0 }; y < from.Height; ++y)
         {
-            int index{ (i * componentsPerPixel * width) + (j * componentsPerPixel) };
-            unsigned char red{   data[index] };
-            unsigned char green{ data[index + 1] };
-            unsigned char blue{  data[index + 2] };
-            unsigned char alpha{ data[index + 3] }; 
-            // Internal 32-bit pixel format is 0xAARRGGBB
-            uint32_t color{ static_cast<uint32_t>(blue) |
-                (static_cast<uint32_t>(green) << 8) |
-                (static_cast<uint32_t>(red) << 16) |
-                (static_cast<uint32_t>(alpha) << 24) };
-            m_pixels.emplace_back(color);
+            for (uint16_t x{ 0 }; x < from.Width; ++x)
+            {
+                pixels->at(toOffset + laidOut.PixelIndex(to, x, y)) =
+                    from.Pixels[PixelIndex(from, x, y)];
+            }
+        }
+    }
+    std::span<uint32_t const> const pixelSpan{ *pixels };
+    return FromPixels(m_width, m_height, pixelSpan, std::move(pixels), layout,
+        m_mipLevels.size());
+}
+
+std::shared_ptr<PngTexture> PngTexture::WithMipmaps()
+{
+    if (m_format != Format::Argb)
+    {
+        return WithFormat(Format::Argb)->WithMipmaps()->WithFormat(m_format);
+    }
+    auto const mipLevelCount{ FullMipLevelCount(m_width, m_height) };
+    auto pixels{ std::make_shared<std::vector<uint32_t>>(
+        StorageSize(m_width, m_height, Layout::Linear, mipLevelCount)) };
+    auto const& base{ m_mipLevels.front() };
+    for (uint16_t y{ 0 }; y < m_height; ++y)
+    {
+        for (uint16_t x{ 0 }; x < m_width; ++x)
+        {
+            pixels->at((static_cast<size_t>(y) * m_width) + x) =
+                base.Pixels[PixelIndex(base, x, y)];
         }
     }
-    stbi_image_free(data);
-    SPDLOG_INFO("Loaded texture '{}' @ {}x{} pixels", file.filename().string(), m_width,
-        m_height);
-}
\ No newline at end of file
+    // Each level averages 2x2 texels of the one above it. Where a side has an odd number
+    // of texels, its last texel is averaged with itself.
+    size_t from{ 0 };
+    for (size_t level{ 1 }; level < mipLevelCount; ++level)
+    {
+        auto const fromWidth{ MipSize(m_width, level - 1) };
+        auto const fromHeight{ MipSize(m_height, level - 1) };
+        auto const width{ MipSize(m_width, level) };
+        auto const height{ MipSize(m_height, level) };
+        auto const to{ from + (static_cast<size_t>(fromWidth) * fromHeight) };
+        for (uint16_t y{ 0 }; y < height; ++y)
+        {
+            for (uint16_t x{ 0 }; x < width; ++x)
+            {
+                std::array<size_t, 2> const columns{ x * 2u,
+                    std::min<size_t>((x * 2u) + 1, fromWidth - 1) };
+                std::array<size_t, 2> const rows{ y * 2u,
+                    std::min<size_t>((y * 2u) + 1, fromHeight - 1) };
+                std::array<uint32_t, 4> channelSums{};
+                for (auto const row : rows)
+                {
+                    for (auto const column : columns)
+                    {
+                        auto const texel{ pixels->at(from + (row * fromWidth) + column) };
+                        for (size_t channel{ 0 }; channel < channelSums.size(); ++channel)
+                        {
+                            channelSums.at(channel) += (texel >> (channel * 8)) & 0xFF;
+                        }
+                    }
+                }
+                uint32_t texel{ 0 };
+                for (size_t channel{ 0 }; channel < channelSums.size(); ++channel)
+                {
+                    texel |= ((channelSums.at(channel) + 2) / 4) << (channel * 8);
+                }
+                pixels->at(to + (static_cast<size_t>(y) * width) + x) = texel;
+            }
+        }
+        from = to;
+    }
+    std::span<uint32_t const> const pixelSpan{ *pixels };
+    return FromPixels(m_width, m_height, pixelSpan, std::move(pixels), Layout::Linear,
+        mipLevelCount)->WithLayout(m_layout);
+}
+
+std::shared_ptr<PngTexture> PngTexture::WithFormat(Format format)
+{
+    if (format == m_format)
+    {
+        return std::shared_ptr<PngTexture>(new PngTexture(m_width, m_height, m_pixels,
+            m_storage, m_layout, m_mipLevels.size(), m_format));
+    }
+    if ((m_format != Format::Argb) && (format != Format::Argb))
+    {
+        return WithFormat(Format::Argb)->WithFormat(format);
+    }
+    auto pixels{ std::make_shared<std::vector<uint32_t>>(
+        StorageSize(m_width, m_height, m_layout, m_mipLevels.size(), format)) };
+    PngTexture const encoded{ m_width, m_height, *pixels, nullptr, m_layout,
+        m_mipLevels.size(), format };
+    // Calls onLevel(from, to, offset) for each mip level, with the offset of its words
+    auto const forEachLevel{ [this, &encoded](auto const& onLevel)
+        {
+            for (size_t level{ 0 }; level < m_mipLevels.size(); ++level)
+            {
+                auto const& to{ encoded.m_mipLevels.at(level) };
+                onLevel(level, to,
+                    static_cast<size_t>(to.Pixels.data() - encoded.m_pixels.data()));
+            }
+        } };
+
+    if (format == Format::Argb)
+    {
+        forEachLevel([&](size_t level, MipLevel const& to, size_t offset)
+            {
+                for (uint16_t y{ 0 }; y < to.Height; ++y)
+                {
+                    for (uint16_t x{ 0 }; x < to.Width; ++x)
+                    {
+                        pixels->at(offset + encoded.PixelIndex(to, x, y)) = ColorAt(x, y, level);
+                    }
+                }
+            });
+    }
+    else if (format == Format::Palettized)
+    {
+        std::vector<uint32_t> colors;
+        colors.reserve(StorageSize(m_width, m_height, Layout::Linear, m_mipLevels.size()));
+        forEachLevel([&](size_t level, MipLevel const& to, size_t)
+            {
+                for (uint16_t y{ 0 }; y < to.Height; ++y)
+                {
+                    for (uint16_t x{ 0 }; x < to.Width; ++x)
+                    {
+                        colors.push_back(ColorAt(x, y, level));
+                    }
+                }
+            });
+        auto const palette{ BuildPalette(std::move(colors)) };
+        std::ranges::copy(palette, pixels->begin());
+        // Many texels share a colour, so each colour's nearest entry is only searched once
+        std::unordered_map<uint32_t, uint32_t> nearestEntries;
+        auto const nearestEntry{ [&](uint32_t color)
+            {
+                auto const [found, isAdded]{ nearestEntries.try_emplace(color, 0) };
+                if (isAdded)
+                {
+                    for (uint32_t entry{ 1 }; entry < palette.size(); ++entry)
+                    {
+                        if (ColorDistance(color, palette.at(entry), 4) <
+                            ColorDistance(color, palette.at(found->second), 4))
+                        {
+                            found->second = entry;
+                        }
+                    }
+                }
+                return found->second;
+            } };
+        forEachLevel([&](size_t level, MipLevel const& to, size_t offset)
+            {
+                for (uint16_t y{ 0 }; y < to.Height; ++y)
+                {
+                    for (uint16_t x{ 0 }; x < to.Width; ++x)
+                    {
+                        auto const index{ encoded.PixelIndex(to, x, y) };
+                        pixels->at(offset + (index / 4)) |=
+                            nearestEntry(ColorAt(x, y, level)) << ((index % 4) * 8);
+                    }
+                }
+            });
+    }
+    else
+    {
+        // Blocks reaching past the edge of a level repeat its last row and column
+        forEachLevel([&](size_t level, MipLevel const& to, size_t offset)
+            {
+                for (uint16_t blockY{ 0 }; blockY < to.Height; blockY += c_bc1BlockSize)
+                {
+                    for (uint16_t blockX{ 0 }; blockX < to.Width; blockX += c_bc1BlockSize)
+                    {
+                        std::array<uint32_t, c_bc1BlockSize * c_bc1BlockSize> texels;
+                        for (size_t i{ 0 }; i < texels.size(); ++i)
+                        {
+                            texels.at(i) = ColorAt(
+                                std::min<uint16_t>(blockX + (i % c_bc1BlockSize), to.Width - 1),
+                                std::min<uint16_t>(blockY + (i / c_bc1BlockSize), to.Height - 1),
+                                level);
+                        }
+                        auto const block{ EncodeBc1Block(texels) };
+                        auto const blockOffset{ offset +
+                            (encoded.BlockIndex(to, blockX, blockY) * 2) };
+                        pixels->at(blockOffset) = block.at(0);
+                        pixels->at(blockOffset + 1) = block.at(1);
+                    }
+                }
+            });
+    }
+    SPDLOG_INFO("Encoded {}x{} texture in {} KiB, from {} KiB", m_width, m_height,
+        (pixels->size() * sizeof(uint32_t)) / 1024, m_pixels.size_bytes() / 1024);
+    std::span<uint32_t const> const pixelSpan{ *pixels };
+    return FromPixels(m_width, m_height, pixelSpan, std::move(pixels), m_layout,
+        m_mipLevels.size(), format);
+}
+
+PngTexture::PngTexture(uint16_t width, uint16_t height, std::span<uint32_t const> pixels,
+    std::shared_ptr<void const> storage, Layout layout, size_t mipLevelCount, Format format) :
+    m_width{ width }, m_height{ height }, m_layout{ layout }, m_format{ format },
+    m_pixels{ pixels }, m_storage{ std::move(storage) }
+{
+    size_t offset{ 0 };
+    if (format == Format::Palettized)
+    {
+        m_palette = pixels.first(c_paletteSize);
+        offset = c_paletteSize;
+    }
+    for (size_t level{ 0 }; level < mipLevelCount; ++level)
+    {
+        auto const levelWidth{ MipSize(width, level) };
+        auto const levelHeight{ MipSize(height, level) };
+        auto const size{ LevelStorageSize(levelWidth, levelHeight, layout, format) };
+        m_mipLevels.push_back(MipLevel{ levelWidth, levelHeight, TileCount(levelWidth),
+            BlockCount(levelWidth), pixels.subspan(offset, size) });
+        offset += size;
+    }
+}
+
+size_t PngTexture::PixelIndex(MipLevel const& level, uint16_t x, uint16_t y) const
+{
+    if (m_layout == Layout::Linear)
+    {
+        return (static_cast<size_t>(y) * level.Width) + x;
+    }
+    size_t const tile{ (static_cast<size_t>(y / c_tileSize) * level.TileCountX) +
+        (x / c_tileSize) };
+    return (tile * c_tileSize * c_tileSize) | SpreadBits(x % c_tileSize) |
+        (SpreadBits(y % c_tileSize) << 1);
+}
+
+size_t PngTexture::BlockIndex(MipLevel const& level, uint16_t x, uint16_t y) const
+{
+    if (m_layout == Layout::Linear)
+    {
+        return (static_cast<size_t>(y / c_bc1BlockSize) * level.BlockCountX) +
+            (x / c_bc1BlockSize);
+    }
+    size_t const tile{ (static_cast<size_t>(y / c_tileSize) * level.TileCountX) +
+        (x / c_tileSize) };
+    return (tile * 4) | SpreadBits((x % c_tileSize) / c_bc1BlockSize) |
+        (SpreadBits((y % c_tileSize) / c_bc1BlockSize) << 1);
+}
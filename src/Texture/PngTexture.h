@@ -2,13 +2,106 @@
 
 struct PngTexture
 {
+    // How the pixels are ordered in memory
+    enum class Layout : uint32_t
+    {
+        // Row by row
+        Linear,
+        // Tiles of c_tileSize by c_tileSize texels, row by row, with each tile's texels in
+        // Z (Morton) order. Texels that are close in either direction share cache lines,
+        // which suits textures sampled at an angle. Rows and columns are padded out to
+        // whole tiles.
+        Tiled,
+    };
+    static constexpr uint16_t c_tileSize{ 8 };
+
+    // How each texel is encoded
+    enum class Format : uint32_t
+    {
+        // A 32-bit 0xAARRGGBB word per texel
+        Argb,
+        // A byte per texel, indexing a palette of c_paletteSize colours shared by every mip
+        // level, which is stored ahead of them. Texels are packed four to a word, from the
+        // low byte up.
+        Palettized,
+        // Blocks of c_bc1BlockSize by c_bc1BlockSize texels in two words, as in BC1: two
+        // RGB565 end colours, then two bits per texel picking one of four colours along the
+        // line between them. Where the first end colour is no greater than the second, the
+        // line has three colours and the fourth is transparent black. Blocks are ordered as
+        // the texels of a Linear or Tiled texture are, with a Tiled texture's tiles holding
+        // 2x2 blocks in Z order.
+        Bc1,
+    };
+    static constexpr size_t c_paletteSize{ 256 };
+    static constexpr uint16_t c_bc1BlockSize{ 4 };
+
+    // One level of the mip chain. Level 0 is the texture itself, and each level after it
+    // is half the size of the one before, down to 1x1.
+    struct MipLevel
+    {
+        uint16_t Width;
+        uint16_t Height;
+        uint16_t TileCountX;
+        // Blocks across a row of a Bc1 texture, padding included
+        uint16_t BlockCountX;
+        // The level's words in the texture's format
+        std::span<uint32_t const> Pixels;
+    };
+
     static std::shared_ptr<PngTexture> FromPngFile(const std::filesystem::path& file);
+    // A texture over pixels already encoded in the given format and layout, which stay
+    // wherever storage keeps them. The pixels hold the given number of mip levels, one after
+    // another.
+    static std::shared_ptr<PngTexture> FromPixels(uint16_t width, uint16_t height,
+        std::span<uint32_t const> pixels, std::shared_ptr<void const> storage,
+        Layout layout = Layout::Linear, size_t mipLevelCount = 1, Format format = Format::Argb);
+    // Words needed to store a texture of the given size in the given layout and format
+    static size_t StorageSize(uint16_t width, uint16_t height, Layout layout,
+        size_t mipLevelCount, Format format = Format::Argb);
+    // Mip levels in a complete chain for a texture of the given size
+    static size_t FullMipLevelCount(uint16_t width, uint16_t height);
     const uint16_t& Width();
     const uint16_t& Height();
-    const uint32_t& ColorAt(uint16_t x, uint16_t y);
+    // The texel's colour in the internal 0xAARRGGBB format, decoded from the texture's format
+    uint32_t ColorAt(uint16_t x, uint16_t y, size_t level = 0);
+    // The words of every mip level in storage order, padding and any palette included
+    std::span<uint32_t const> Pixels() const;
+    Layout GetLayout() const;
+    Format GetFormat() const;
+    size_t MipLevelCount() const;
+    MipLevel const& GetMipLevel(size_t level) const;
+    // A copy of the texture with its pixels rearranged into another layout. A texture
+    // already in that layout shares its pixels with the copy.
+    std::shared_ptr<PngTexture> WithLayout(Layout layout);
+    // A copy of the texture with a complete mip chain built from its first level, in the
+    // same layout
+    std::shared_ptr<PngTexture> WithMipmaps();
+    // A copy of the texture encoded in another format, with the same layout and mip levels.
+    // Both compact formats are lossy: Palettized quantizes the colours of every level to
+    // one palette, and Bc1 keeps four colours per block and only opaque or transparent.
+    std::shared_ptr<PngTexture> WithFormat(Format format);
 private:
     uint16_t m_width;
     uint16_t m_height;
-    std::vector<uint32_t> m_pixels;
-    PngTexture(const std::filesystem::path& file);
-};
\ No newline at end of file
+    Layout m_layout;
+    Format m_format;
+    std::span<uint32_t const> m_pixels;
+    std::span<uint32_t const> m_palette;
+    std::vector<MipLevel> m_mipLevels;
+    // Keeps whatever the pixels point into alive
+    std::shared_ptr<void const> m_storage;
+    PngTexture(uint16_t width, uint16_t height, std::span<uint32_t const> pixels,
+        std::shared_ptr<void const> storage, Layout layout, size_t mipLevelCount,
+        Format format);
+    // Index of a texel within its mip level's texels
+    size_t PixelIndex(MipLevel const& level, uint16_t x, uint16_t y) const;
+    // Index of the Bc1 block holding a texel within its mip level's blocks
+    size_t BlockIndex(MipLevel const& level, uint16_t x, uint16_t y) const;
+};
+
+namespace game
+{
+// Converts pixels of RGBA bytes, as PNG decoders produce them, to the internal 0xAARRGGBB
+// format, using the widest SIMD kernel the running CPU supports
+void ConvertRgbaToArgb(std::span<std::byte const> rgba, std::span<uint32_t> argb);
+}
@@ -0,0 +1,186 @@
+#include <pch.h>
+#include "TextureCache.h"
+#include "../Utility/MappedFile.h"
+
+namespace
+{
+    constexpr std::array<char, 4> c_cacheMagic{ 'T', 'E', 'X', 'C' };
+    // Bump whenever the layout below, or the pixel format, changes. Caches of any other
+    // version are rebuilt.
+    constexpr uint32_t c_cacheVersion{ 4 };
+
+    // The file is a header followed by the words of the texture in its format: the palette
+    // of a Palettized texture, then each mip level in turn, in the texture's layout. Values
+    // are stored in the byte order of the machine that wrote them; a cache from a machine of
+    // the other byte order fails the version check and is rebuilt.
+    struct CacheHeader
+    {
+        std::array<char, 4> Magic;
+        uint32_t Version;
+        uint32_t Width;
+        uint32_t Height;
+        PngTexture::Layout Layout;
+        uint32_t MipLevelCount;
+        PngTexture::Format Format;
+    };
+    static_assert(std::is_trivially_copyable_v<CacheHeader>);
+    // Keeps the pixels that follow the header aligned for 32-bit reads
+    static_assert((sizeof(CacheHeader) % alignof(uint32_t)) == 0);
+}
+
+namespace game
+{
+std::shared_ptr<PngTexture> LoadTextureCache(std::filesystem::path const& cachePath,
+    std::filesystem::path const& sourcePath)
+{
+    std::error_code error;
+    if (!std::filesystem::exists(cachePath, error))
+    {
+        SPDLOG_INFO("No texture cache at '{}'", cachePath.string());
+        return nullptr;
+    }
+    if (std::filesystem::exists(sourcePath, error) &&
+        (std::filesystem::last_write_time(sourcePath, error) >
+            std::filesystem::last_write_time(cachePath, error)))
+    {
+        SPDLOG_INFO("Texture cache '{}' is older than '{}'", cachePath.string(),
+            sourcePath.string());
+        return nullptr;
+    }
+    auto const file{ MappedFile::Open(cachePath) };
+    if (!file)
+    {
+        return nullptr;
+    }
+
+    auto const bytes{ file->Bytes() };
+    CacheHeader header;
+    if (bytes.size() < sizeof(header))
+    {
+        SPDLOG_INFO("Texture cache '{}' is not version {}", cachePath.string(), c_cacheVersion);
+        return nullptr;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if ((header.Magic != c_cacheMagic) || (header.Version != c_cacheVersion))
+    {
+        SPDLOG_INFO("Texture cache '{}' is not version {}", cachePath.string(), c_cacheVersion);
+        return nullptr;
+    }
+    if ((header.Width > std::numeric_limits<uint16_t>::max()) ||
+        (header.Height > std::numeric_limits<uint16_t>::max()) ||
+        ((header.Layout != PngTexture::Layout::Linear) &&
+            (header.Layout != PngTexture::Layout::Tiled)) ||
+        (header.Format > PngTexture::Format::Bc1))
+    {
+        SPDLOG_WARN("Texture cache '{}' is damaged", cachePath.string());
+        return nullptr;
+    }
+    auto const width{ static_cast<uint16_t>(header.Width) };
+    auto const height{ static_cast<uint16_t>(header.Height) };
+    if ((header.MipLevelCount == 0) ||
+        (header.MipLevelCount > PngTexture::FullMipLevelCount(width, height)))
+    {
+        SPDLOG_WARN("Texture cache '{}' is damaged", cachePath.string());
+        return nullptr;
+    }
+    auto const pixelCount{ PngTexture::StorageSize(width, height, header.Layout,
+        header.MipLevelCount, header.Format) };
+    if (pixelCount > ((bytes.size() - sizeof(header)) / sizeof(uint32_t)))
+    {
+        SPDLOG_WARN("Texture cache '{}' is damaged", cachePath.string());
+        return nullptr;
+    }
+    std::span<uint32_t const> const pixels{
+        reinterpret_cast<uint32_t const*>(bytes.data() + sizeof(header)),
+        pixelCount };
+    SPDLOG_INFO("Mapped texture from cache '{}' @ {}x{} pixels", cachePath.string(), width,
+        height);
+    return PngTexture::FromPixels(width, height, pixels, file, header.Layout,
+        header.MipLevelCount, header.Format);
+}
+
+bool WriteTextureCache(std::filesystem::path const& cachePath, PngTexture& texture)
+{
+    // Write to a temporary file first, so a run that stops part way can't leave a
+    // damaged cache behind
+    auto temporaryPath{ cachePath };
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file{ temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc };
+        if (!file.is_open())
+        {
+            SPDLOG_WARN("Could not open texture cache '{}' for writing", temporaryPath.string());
+            return false;
+        }
+        CacheHeader const header{ c_cacheMagic, c_cacheVersion, texture.Width(),
+            texture.Height(), texture.GetLayout(),
+            static_cast<uint32_t>(texture.MipLevelCount()), texture.GetFormat() };
+        auto const pixels{ std::as_bytes(texture.Pixels()) };
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(reinterpret_cast<char const*>(pixels.data()),
+            static_cast<std::streamsize>(pixels.size()));
+        if (!file.good())
+        {
+            SPDLOG_WARN("Could not write texture cache '{}'", temporaryPath.string());
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, cachePath, error);
+    if (error)
+    {
+        SPDLOG_WARN("Could not replace texture cache '{}': {}", cachePath.string(),
+            error.message());
+        return false;
+    }
+    SPDLOG_INFO("Wrote texture to cache '{}'", cachePath.string());
+    return true;
+}
+
+std::string TextureVariant(PngTexture::Layout layout, PngTexture::Format format)
+{
+    std::string_view const layoutName{ (layout == PngTexture::Layout::Tiled) ? "tiled" :
+        "linear" };
+    switch (format)
+    {
+    case PngTexture::Format::Palettized:
+        return fmt::format("{}.palettized", layoutName);
+    case PngTexture::Format::Bc1:
+        return fmt::format("{}.bc1", layoutName);
+    default:
+        return fmt::format("{}.argb", layoutName);
+    }
+}
+
+std::shared_ptr<PngTexture> LoadCookedTexture(std::filesystem::path const& pngPath,
+    PngTexture::Layout layout, PngTexture::Format format)
+{
+    auto cachePath{ pngPath };
+    cachePath += fmt::format(".{}.texcache", TextureVariant(layout, format));
+    auto texture{ LoadTextureCache(cachePath, pngPath) };
+    auto const isMipmapped{ [](PngTexture& cached)
+        {
+            return cached.MipLevelCount() ==
+                PngTexture::FullMipLevelCount(cached.Width(), cached.Height());
+        } };
+    if (texture && (texture->GetLayout() == layout) && (texture->GetFormat() == format) &&
+        isMipmapped(*texture))
+    {
+        return texture;
+    }
+    // A cache that is only missing its mip chain still saves decoding the PNG, but one in a
+    // lossy format would lose colours on the way to the new one
+    if (!texture || (texture->GetFormat() != PngTexture::Format::Argb))
+    {
+        texture = PngTexture::FromPngFile(pngPath);
+    }
+    texture = texture->WithLayout(layout);
+    if (!isMipmapped(*texture))
+    {
+        texture = texture->WithMipmaps();
+    }
+    texture = texture->WithFormat(format);
+    WriteTextureCache(cachePath, *texture);
+    return texture;
+}
+}
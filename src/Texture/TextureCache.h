@@ -0,0 +1,25 @@
+#pragma once
+#include "PngTexture.h"
+
+namespace game
+{
+// Textures saved with their pixels already encoded in the texture's format, in a binary
+// file that is mapped straight back into memory and sampled from as is, rather than being
+// decoded from PNG on every run.
+
+// Returns the texture in the cache, if the cache was written by this version of the format
+// and is no older than its source file.
+std::shared_ptr<PngTexture> LoadTextureCache(std::filesystem::path const& cachePath,
+    std::filesystem::path const& sourcePath);
+// Writes a texture to a cache. Returns false if it couldn't.
+bool WriteTextureCache(std::filesystem::path const& cachePath, PngTexture& texture);
+// Names a layout and format together, telling apart the textures cooked from one file
+std::string TextureVariant(PngTexture::Layout layout, PngTexture::Format format);
+// Maps a PNG file's texture, along with its full mip chain, in from the cache beside it when
+// that's up to date. Otherwise decodes the PNG, builds the mip chain, encodes it and writes a
+// new cache for next time. Each layout and format is cached in a file of its own, named
+// after the PNG and the variant.
+std::shared_ptr<PngTexture> LoadCookedTexture(std::filesystem::path const& pngPath,
+    PngTexture::Layout layout = PngTexture::Layout::Linear,
+    PngTexture::Format format = PngTexture::Format::Argb);
+}
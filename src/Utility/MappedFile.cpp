@@ -0,0 +1,147 @@
+#include <pch.h>
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // The range of a file of the given size to map, if the file holds it
+    std::optional<std::pair<uint64_t, uint64_t>> ResolveRange(uint64_t fileSize, uint64_t offset,
+        std::optional<uint64_t> length)
+    {
+        if (offset > fileSize)
+        {
+            return std::nullopt;
+        }
+        auto const rangeLength{ length.value_or(fileSize - offset) };
+        if (rangeLength > (fileSize - offset))
+        {
+            return std::nullopt;
+        }
+        return std::make_pair(offset, rangeLength);
+    }
+}
+
+namespace game
+{
+#ifdef _WIN32
+std::shared_ptr<MappedFile> MappedFile::Open(std::filesystem::path const& path,
+    uint64_t offset, std::optional<uint64_t> length)
+{
+    std::shared_ptr<MappedFile> file{ new MappedFile{} };
+    file->m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size;
+    if ((file->m_file == INVALID_HANDLE_VALUE) || !GetFileSizeEx(file->m_file, &size))
+    {
+        SPDLOG_ERROR("Could not open '{}' for mapping", path.string());
+        return nullptr;
+    }
+    auto const range{ ResolveRange(static_cast<uint64_t>(size.QuadPart), offset, length) };
+    if (!range)
+    {
+        SPDLOG_ERROR("'{}' is too short to map {} bytes from offset {}", path.string(),
+            length.value_or(0), offset);
+        return nullptr;
+    }
+    file->m_size = static_cast<size_t>(range->second);
+    if (file->m_size == 0)
+    {
+        return file;
+    }
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    uint64_t const mappingOffset{ offset - (offset % systemInfo.dwAllocationGranularity) };
+    file->m_mappingSize = static_cast<size_t>(offset - mappingOffset) + file->m_size;
+    file->m_fileMapping = CreateFileMappingW(file->m_file, nullptr, PAGE_READONLY, 0, 0,
+        nullptr);
+    file->m_mapping = (file->m_fileMapping != nullptr) ?
+        MapViewOfFile(file->m_fileMapping, FILE_MAP_READ,
+            static_cast<DWORD>(mappingOffset >> 32), static_cast<DWORD>(mappingOffset),
+            file->m_mappingSize) : nullptr;
+    if (file->m_mapping == nullptr)
+    {
+        SPDLOG_ERROR("Could not map '{}' into memory", path.string());
+        return nullptr;
+    }
+    file->m_data = static_cast<std::byte const*>(file->m_mapping) + (offset - mappingOffset);
+    return file;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_mapping != nullptr)
+    {
+        UnmapViewOfFile(m_mapping);
+    }
+    if (m_fileMapping != nullptr)
+    {
+        CloseHandle(m_fileMapping);
+    }
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+    }
+}
+#else
+std::shared_ptr<MappedFile> MappedFile::Open(std::filesystem::path const& path,
+    uint64_t offset, std::optional<uint64_t> length)
+{
+    int const descriptor{ open(path.c_str(), O_RDONLY) };
+    struct stat status;
+    if ((descriptor < 0) || (fstat(descriptor, &status) != 0))
+    {
+        SPDLOG_ERROR("Could not open '{}' for mapping", path.string());
+        if (descriptor >= 0)
+        {
+            close(descriptor);
+        }
+        return nullptr;
+    }
+    auto const range{ ResolveRange(static_cast<uint64_t>(status.st_size), offset, length) };
+    if (!range)
+    {
+        SPDLOG_ERROR("'{}' is too short to map {} bytes from offset {}", path.string(),
+            length.value_or(0), offset);
+        close(descriptor);
+        return nullptr;
+    }
+    std::shared_ptr<MappedFile> file{ new MappedFile{} };
+    file->m_size = static_cast<size_t>(range->second);
+    if (file->m_size > 0)
+    {
+        auto const pageSize{ static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) };
+        uint64_t const mappingOffset{ offset - (offset % pageSize) };
+        file->m_mappingSize = static_cast<size_t>(offset - mappingOffset) + file->m_size;
+        void* mapping{ mmap(nullptr, file->m_mappingSize, PROT_READ, MAP_PRIVATE, descriptor,
+            static_cast<off_t>(mappingOffset)) };
+        if (mapping != MAP_FAILED)
+        {
+            file->m_mapping = mapping;
+            file->m_data = static_cast<std::byte const*>(mapping) + (offset - mappingOffset);
+        }
+    }
+    // The mapping stays valid once the descriptor is closed
+    close(descriptor);
+    if ((file->m_size > 0) && (file->m_data == nullptr))
+    {
+        SPDLOG_ERROR("Could not map '{}' into memory", path.string());
+        return nullptr;
+    }
+    return file;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_mapping != nullptr)
+    {
+        munmap(m_mapping, m_mappingSize);
+    }
+}
+#endif
+}
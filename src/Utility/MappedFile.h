@@ -0,0 +1,37 @@
+#pragma once
+
+namespace game
+{
+// A file, or a range of bytes of one, mapped read-only into memory for as long as the
+// object lives
+struct MappedFile
+{
+    // Maps the bytes from offset up to offset + length, or to the end of the file if no
+    // length is given. Returns nullptr if the file can't be opened or mapped, or is too
+    // short to hold the range.
+    static std::shared_ptr<MappedFile> Open(std::filesystem::path const& path,
+        uint64_t offset = 0, std::optional<uint64_t> length = std::nullopt);
+    ~MappedFile();
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    std::span<std::byte const> Bytes() const
+    {
+        return { static_cast<std::byte const*>(m_data), m_size };
+    }
+
+private:
+    // The mapping itself starts at a page boundary at or before the range asked for
+    void* m_mapping{ nullptr };
+    size_t m_mappingSize{ 0 };
+    void const* m_data{ nullptr };
+    size_t m_size{ 0 };
+#ifdef _WIN32
+    HANDLE m_file{ INVALID_HANDLE_VALUE };
+    HANDLE m_fileMapping{ nullptr };
+#endif
+
+    MappedFile() = default;
+};
+}
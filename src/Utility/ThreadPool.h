@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+namespace game
+{
+struct ThreadPool
+{
+    ThreadPool(size_t threadCount)
+    {
+        m_threads.reserve(threadCount);
+        for (size_t i{ 0 }; i < threadCount; ++i)
+        {
+            m_threads.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::scoped_lock lock{ m_queueMutex };
+            m_isStopping = true;
+        }
+        m_queueCondition.notify_all();
+        for (auto& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    size_t ThreadCount() const
+    {
+        return m_threads.size();
+    }
+
+    template<typename F>
+    std::future<std::invoke_result_t<F>> Enqueue(F&& task)
+    {
+        using ResultType = std::invoke_result_t<F>;
+        auto packagedTask{ std::make_shared<std::packaged_task<ResultType()>>(
+            std::forward<F>(task)) };
+        std::future<ResultType> result{ packagedTask->get_future() };
+        {
+            std::scoped_lock lock{ m_queueMutex };
+            m_queue.emplace([packagedTask]() { (*packagedTask)(); });
+        }
+        m_queueCondition.notify_one();
+        return result;
+    }
+
+    // Calls task(i) for every i in [0, count), spread over the pool's threads and the
+    // calling thread, and returns once every call has finished.
+    template<typename F>
+    void ParallelFor(size_t count, F const& task)
+    {
+        std::atomic<size_t> nextIndex{ 0 };
+        auto const runTasks{ [&nextIndex, &task, count]()
+            {
+                for (size_t i{ nextIndex++ }; i < count; i = nextIndex++)
+                {
+                    task(i);
+                }
+            } };
+        std::vector<std::future<void>> workers;
+        workers.reserve(m_threads.size());
+        for (size_t i{ 0 }; (i < m_threads.size()) && (i < count); ++i)
+        {
+            workers.push_back(Enqueue(runTasks));
+        }
+        runTasks();
+        for (auto& worker : workers)
+        {
+            worker.get();
+        }
+    }
+
+private:
+    std::vector<std::thread> m_threads;
+    std::queue<std::function<void()>> m_queue;
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCondition;
+    bool m_isStopping{ false };
+
+    void WorkerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock lock{ m_queueMutex };
+                m_queueCondition.wait(lock, [this]() { return m_isStopping || !m_queue.empty(); });
+                if (m_isStopping && m_queue.empty())
+                {
+                    return;
+                }
+                task = std::move(m_queue.front());
+                m_queue.pop();
+            }
+            task();
+        }
+    }
+};
+}
@@ -1,6 +1,7 @@
 // C++ standard library
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cassert>
 #include <chrono>
 #include <cstdint>
@@ -0,0 +1,374 @@
+#include <testpch.h>
+#include <AssetRegistry.h>
+#include <Texture/TextureCache.h>
+
+namespace
+{
+    // Writes a small file under the temporary directory, returning its path
+    std::filesystem::path WriteTemporaryFile(std::string_view name, std::string_view contents)
+    {
+        auto const path{ std::filesystem::temp_directory_path() / name };
+        std::ofstream file{ path, std::ios::binary };
+        file << contents;
+        return path;
+    }
+}
+
+TEST_CASE("Asset registry", "[assets]")
+{
+    auto const first{ WriteTemporaryFile("AssetTests.first.txt", "same contents") };
+    auto const copy{ WriteTemporaryFile("AssetTests.copy.txt", "same contents") };
+    auto const other{ WriteTemporaryFile("AssetTests.other.txt", "other contents") };
+    auto const lookalike{ WriteTemporaryFile("AssetTests.lookalike.txt", "some contents") };
+    std::atomic<size_t> loadCount{ 0 };
+    auto const load{ [&loadCount](std::filesystem::path const& path)
+        {
+            ++loadCount;
+            std::ifstream file{ path, std::ios::binary };
+            return std::make_shared<std::string>(std::istreambuf_iterator<char>{ file },
+                std::istreambuf_iterator<char>{});
+        } };
+
+    SECTION("Each file is loaded once, however often it is asked for")
+    {
+        game::ThreadPool threadPool{ 2 };
+        game::AssetRegistry registry{ &threadPool };
+        std::vector<game::AssetHandle<std::string>> handles;
+        for (size_t i{ 0 }; i < 1000; ++i)
+        {
+            handles.push_back(registry.Load<std::string>(first, load));
+        }
+        for (auto const& handle : handles)
+        {
+            REQUIRE(handle.Get() == handles.front().Get());
+        }
+        REQUIRE(*handles.front().Get() == "same contents");
+        REQUIRE(loadCount == 1);
+        auto const assets{ registry.Assets() };
+        REQUIRE(assets.size() == 1);
+        REQUIRE(assets.front().ReferenceCount == 1000);
+        REQUIRE(assets.front().IsLoaded);
+        handles.resize(10);
+        REQUIRE(registry.Assets().front().ReferenceCount == 10);
+    }
+    SECTION("Files with the same contents share one asset")
+    {
+        game::AssetRegistry registry{ nullptr };
+        auto const firstHandle{ registry.Load<std::string>(first, load) };
+        auto const copyHandle{ registry.Load<std::string>(copy, load) };
+        auto const otherHandle{ registry.Load<std::string>(other, load) };
+        REQUIRE(firstHandle.Get() == copyHandle.Get());
+        REQUIRE(firstHandle.Get() != otherHandle.Get());
+        REQUIRE(loadCount == 2);
+        REQUIRE(registry.Assets().size() == 3);
+    }
+    SECTION("Files of the same size but different contents are kept apart")
+    {
+        game::AssetRegistry registry{ nullptr };
+        auto const firstHandle{ registry.Load<std::string>(first, load) };
+        auto const lookalikeHandle{ registry.Load<std::string>(lookalike, load) };
+        REQUIRE(*firstHandle.Get() == "same contents");
+        REQUIRE(*lookalikeHandle.Get() == "some contents");
+        REQUIRE(loadCount == 2);
+    }
+    SECTION("Variants of one file are kept apart")
+    {
+        game::AssetRegistry registry{ nullptr };
+        auto const plain{ registry.Load<std::string>(first, load) };
+        auto const variant{ registry.Load<std::string>(first, load, "variant") };
+        auto const copyVariant{ registry.Load<std::string>(copy, load, "variant") };
+        REQUIRE(plain.Get() != variant.Get());
+        REQUIRE(variant.Get() == copyVariant.Get());
+        REQUIRE(loadCount == 2);
+    }
+    SECTION("Assets of different types at one path are kept apart")
+    {
+        game::AssetRegistry registry{ nullptr };
+        auto const text{ registry.Load<std::string>(first, load) };
+        auto const size{ registry.Load<size_t>(first, [](std::filesystem::path const& path)
+            {
+                return std::make_shared<size_t>(std::filesystem::file_size(path));
+            }) };
+        REQUIRE(*size.Get() == text.Get()->size());
+        REQUIRE(loadCount == 1);
+    }
+    std::filesystem::remove(first);
+    std::filesystem::remove(copy);
+    std::filesystem::remove(other);
+    std::filesystem::remove(lookalike);
+}
+
+TEST_CASE("Texture cache", "[assets][texture]")
+{
+    SECTION("RGBA pixels are swizzled to ARGB, whatever the pixel count")
+    {
+        std::vector<std::byte> rgba;
+        for (size_t i{ 0 }; i < (4 * 11); ++i)
+        {
+            rgba.push_back(static_cast<std::byte>(i));
+        }
+        std::vector<uint32_t> argb(11);
+        game::ConvertRgbaToArgb(rgba, argb);
+        for (uint32_t i{ 0 }; i < argb.size(); ++i)
+        {
+            uint32_t const r{ 4 * i };
+            REQUIRE(argb.at(i) == (((r + 3) << 24) | (r << 16) | ((r + 1) << 8) | (r + 2)));
+        }
+    }
+    SECTION("A cached texture maps back with the same pixels")
+    {
+        auto const pixels{ std::make_shared<std::vector<uint32_t>>(
+            std::vector<uint32_t>{ 0xFF000000, 0xFFFF0000, 0x8000FF00, 0x000000FF, 1, 2 }) };
+        auto const texture{ PngTexture::FromPixels(3, 2, *pixels, pixels) };
+        auto const cachePath{ std::filesystem::temp_directory_path() / "AssetTests.texcache" };
+        REQUIRE(game::WriteTextureCache(cachePath, *texture));
+        {
+            auto const loaded{ game::LoadTextureCache(cachePath, "AssetTests.png") };
+            REQUIRE(loaded != nullptr);
+            REQUIRE(loaded->Width() == 3);
+            REQUIRE(loaded->Height() == 2);
+            REQUIRE(std::ranges::equal(loaded->Pixels(), *pixels));
+            REQUIRE(loaded->ColorAt(2, 1) == 2);
+        }
+        std::filesystem::remove(cachePath);
+        REQUIRE(game::LoadTextureCache(cachePath, "AssetTests.png") == nullptr);
+    }
+    SECTION("Each format of a texture is cached apart")
+    {
+        auto const pngPath{ std::filesystem::temp_directory_path() / "AssetTests.cube.png" };
+        std::filesystem::copy_file("cube.png", pngPath,
+            std::filesystem::copy_options::overwrite_existing);
+        auto const cachePath{ [&pngPath](PngTexture::Format format)
+            {
+                auto path{ pngPath };
+                path += "." + game::TextureVariant(PngTexture::Layout::Linear, format) +
+                    ".texcache";
+                return path;
+            } };
+        auto const argb{ game::LoadCookedTexture(pngPath) };
+        auto const palettized{ game::LoadCookedTexture(pngPath, PngTexture::Layout::Linear,
+            PngTexture::Format::Palettized) };
+        REQUIRE(std::filesystem::exists(cachePath(PngTexture::Format::Argb)));
+        REQUIRE(std::filesystem::exists(cachePath(PngTexture::Format::Palettized)));
+        // Loading one format again neither rebuilds nor overwrites the other's cache
+        auto const argbCached{ game::LoadTextureCache(cachePath(PngTexture::Format::Argb),
+            pngPath) };
+        REQUIRE(argbCached != nullptr);
+        REQUIRE(argbCached->GetFormat() == PngTexture::Format::Argb);
+        REQUIRE(game::LoadCookedTexture(pngPath)->GetFormat() == PngTexture::Format::Argb);
+        auto const palettizedCached{ game::LoadTextureCache(
+            cachePath(PngTexture::Format::Palettized), pngPath) };
+        REQUIRE(palettizedCached != nullptr);
+        REQUIRE(palettizedCached->GetFormat() == PngTexture::Format::Palettized);
+        for (auto const format : { PngTexture::Format::Argb, PngTexture::Format::Palettized })
+        {
+            std::filesystem::remove(cachePath(format));
+        }
+        std::filesystem::remove(pngPath);
+    }
+}
+
+TEST_CASE("Tiled textures", "[assets][texture]")
+{
+    // Neither side a whole number of tiles, so the padding is exercised too
+    uint16_t const width{ 11 };
+    uint16_t const height{ 19 };
+    auto const pixels{ std::make_shared<std::vector<uint32_t>>(size_t{ width } * height) };
+    std::iota(pixels->begin(), pixels->end(), 0);
+    auto const linear{ PngTexture::FromPixels(width, height, *pixels, pixels) };
+    auto const tiled{ linear->WithLayout(PngTexture::Layout::Tiled) };
+    REQUIRE(tiled->GetLayout() == PngTexture::Layout::Tiled);
+    REQUIRE(tiled->Pixels().size() == (16 * 24));
+    // The first cache line's worth of texels is a 4x4 block
+    REQUIRE(tiled->Pixels()[15] == ((3 * width) + 3));
+    auto const relinear{ tiled->WithLayout(PngTexture::Layout::Linear) };
+    REQUIRE(std::ranges::equal(relinear->Pixels(), *pixels));
+
+    auto const cachePath{ std::filesystem::temp_directory_path() / "AssetTests.tiled.texcache" };
+    REQUIRE(game::WriteTextureCache(cachePath, *tiled));
+    {
+        auto const loaded{ game::LoadTextureCache(cachePath, "AssetTests.png") };
+        REQUIRE(loaded != nullptr);
+        REQUIRE(loaded->GetLayout() == PngTexture::Layout::Tiled);
+        for (uint16_t y{ 0 }; y < height; ++y)
+        {
+            for (uint16_t x{ 0 }; x < width; ++x)
+            {
+                REQUIRE(loaded->ColorAt(x, y) == linear->ColorAt(x, y));
+            }
+        }
+    }
+    std::filesystem::remove(cachePath);
+}
+
+TEST_CASE("Texture mipmaps", "[assets][texture]")
+{
+    auto const pixels{ std::make_shared<std::vector<uint32_t>>(std::vector<uint32_t>{
+        0xFF000000, 0xFF040404, 0x00000000, 0x00000000,
+        0xFF080808, 0xFF0C0C0C, 0x80FFFFFF, 0x80FFFFFF }) };
+    auto const texture{ PngTexture::FromPixels(4, 2, *pixels, pixels)->WithMipmaps() };
+    REQUIRE(texture->MipLevelCount() == 3);
+    REQUIRE(texture->GetMipLevel(1).Width == 2);
+    REQUIRE(texture->GetMipLevel(1).Height == 1);
+    REQUIRE(texture->GetMipLevel(2).Width == 1);
+    // Each channel is averaged on its own, rounding to nearest
+    REQUIRE(texture->ColorAt(0, 0, 1) == 0xFF060606);
+    REQUIRE(texture->ColorAt(1, 0, 1) == 0x40808080);
+    REQUIRE(texture->ColorAt(0, 0, 2) == 0xA0434343);
+    REQUIRE(texture->ColorAt(3, 1) == 0x80FFFFFF);
+
+    auto const tiled{ texture->WithLayout(PngTexture::Layout::Tiled) };
+    REQUIRE(tiled->MipLevelCount() == 3);
+    REQUIRE(tiled->ColorAt(1, 0, 1) == 0x40808080);
+    REQUIRE(tiled->WithMipmaps()->ColorAt(0, 0, 2) == 0xA0434343);
+
+    auto const cachePath{ std::filesystem::temp_directory_path() / "AssetTests.mip.texcache" };
+    REQUIRE(game::WriteTextureCache(cachePath, *tiled));
+    {
+        auto const loaded{ game::LoadTextureCache(cachePath, "AssetTests.png") };
+        REQUIRE(loaded != nullptr);
+        REQUIRE(loaded->MipLevelCount() == 3);
+        REQUIRE(loaded->ColorAt(0, 0, 2) == 0xA0434343);
+    }
+    std::filesystem::remove(cachePath);
+}
+
+TEST_CASE("Compact texture formats", "[assets][texture]")
+{
+    // Neither side a whole number of blocks or tiles
+    uint16_t const width{ 11 };
+    uint16_t const height{ 19 };
+    auto const makeTexture{ [](auto const& colorAt)
+        {
+            auto const pixels{ std::make_shared<std::vector<uint32_t>>() };
+            for (uint16_t y{ 0 }; y < height; ++y)
+            {
+                for (uint16_t x{ 0 }; x < width; ++x)
+                {
+                    pixels->push_back(colorAt(x, y));
+                }
+            }
+            return PngTexture::FromPixels(width, height, *pixels, pixels);
+        } };
+    auto const requireSameColors{ [](PngTexture& a, PngTexture& b)
+        {
+            for (size_t level{ 0 }; level < a.MipLevelCount(); ++level)
+            {
+                auto const& mipLevel{ a.GetMipLevel(level) };
+                for (uint16_t y{ 0 }; y < mipLevel.Height; ++y)
+                {
+                    for (uint16_t x{ 0 }; x < mipLevel.Width; ++x)
+                    {
+                        REQUIRE(a.ColorAt(x, y, level) == b.ColorAt(x, y, level));
+                    }
+                }
+            }
+        } };
+
+    SECTION("A palette holds up to 256 colours exactly")
+    {
+        auto const texture{ makeTexture([](uint16_t x, uint16_t y)
+            {
+                return 0x80000000 | static_cast<uint32_t>((((x * 7) + (y * 13)) % 200) * 0x010101);
+            })->WithMipmaps() };
+        for (auto const layout : { PngTexture::Layout::Linear, PngTexture::Layout::Tiled })
+        {
+            auto const palettized{ texture->WithLayout(layout)->WithFormat(
+                PngTexture::Format::Palettized) };
+            REQUIRE(palettized->GetFormat() == PngTexture::Format::Palettized);
+            REQUIRE(palettized->MipLevelCount() == texture->MipLevelCount());
+            // The base level packs four texels to a word after the palette
+            REQUIRE(palettized->Pixels().size() < (PngTexture::c_paletteSize +
+                PngTexture::StorageSize(width, height, layout, texture->MipLevelCount())));
+            REQUIRE(palettized->ColorAt(10, 18) == texture->ColorAt(10, 18));
+        }
+        requireSameColors(*texture,
+            *texture->WithFormat(PngTexture::Format::Palettized));
+    }
+    SECTION("More colours than the palette holds are quantized to nearby ones")
+    {
+        auto const texture{ makeTexture([](uint16_t x, uint16_t y)
+            {
+                return 0xFF000000 | (static_cast<uint32_t>(x * 23) << 16) |
+                    (static_cast<uint32_t>(y * 13) << 8) | ((x * y) & 0xFF);
+            }) };
+        auto const palettized{ texture->WithFormat(PngTexture::Format::Palettized) };
+        for (uint16_t y{ 0 }; y < height; ++y)
+        {
+            for (uint16_t x{ 0 }; x < width; ++x)
+            {
+                for (size_t channel{ 0 }; channel < 4; ++channel)
+                {
+                    auto const expected{ (texture->ColorAt(x, y) >> (channel * 8)) & 0xFF };
+                    auto const actual{ (palettized->ColorAt(x, y) >> (channel * 8)) & 0xFF };
+                    REQUIRE(std::abs(static_cast<int>(expected) - static_cast<int>(actual)) <= 24);
+                }
+            }
+        }
+    }
+    SECTION("Bc1 keeps two colours per block and transparency")
+    {
+        // Red and blue are exact in RGB565; a transparent texel where x and y are both 0 mod 3
+        auto const texture{ makeTexture([](uint16_t x, uint16_t y)
+            {
+                if (((x % 3) == 0) && ((y % 3) == 0))
+                {
+                    return 0x00000000u;
+                }
+                return (((x + y) % 2) == 0) ? 0xFFFF0000u : 0xFF0000FFu;
+            }) };
+        for (auto const layout : { PngTexture::Layout::Linear, PngTexture::Layout::Tiled })
+        {
+            auto const compressed{ texture->WithLayout(layout)->WithFormat(
+                PngTexture::Format::Bc1) };
+            REQUIRE(compressed->GetLayout() == layout);
+            // Two words per 4x4 block, an eighth of the Argb texels padded to whole blocks
+            REQUIRE((compressed->Pixels().size() * 8) ==
+                PngTexture::StorageSize(12, 20, layout, 1));
+            requireSameColors(*texture, *compressed);
+        }
+    }
+    SECTION("Bc1 blocks follow the colours they are made from")
+    {
+        auto const texture{ makeTexture([](uint16_t x, uint16_t y)
+            {
+                return 0xFF000000 | (static_cast<uint32_t>(x * 8) << 16) |
+                    (static_cast<uint32_t>(y * 4) << 8) | 0x40;
+            })->WithMipmaps() };
+        auto const compressed{ texture->WithFormat(PngTexture::Format::Bc1) };
+        for (uint16_t y{ 0 }; y < height; ++y)
+        {
+            for (uint16_t x{ 0 }; x < width; ++x)
+            {
+                for (size_t channel{ 0 }; channel < 4; ++channel)
+                {
+                    auto const expected{ (texture->ColorAt(x, y) >> (channel * 8)) & 0xFF };
+                    auto const actual{ (compressed->ColorAt(x, y) >> (channel * 8)) & 0xFF };
+                    REQUIRE(std::abs(static_cast<int>(expected) - static_cast<int>(actual)) <= 16);
+                }
+            }
+        }
+        requireSameColors(*compressed, *compressed->WithFormat(PngTexture::Format::Argb));
+    }
+    SECTION("A compact texture maps back from its cache")
+    {
+        auto const texture{ makeTexture([](uint16_t x, uint16_t y)
+            {
+                return 0xFF000000 | (static_cast<uint32_t>(x * 20) << 8) | (y * 10);
+            })->WithMipmaps() };
+        auto const cachePath{ std::filesystem::temp_directory_path() /
+            "AssetTests.compact.texcache" };
+        for (auto const format : { PngTexture::Format::Palettized, PngTexture::Format::Bc1 })
+        {
+            auto const encoded{ texture->WithLayout(PngTexture::Layout::Tiled)->WithFormat(
+                format) };
+            REQUIRE(game::WriteTextureCache(cachePath, *encoded));
+            auto const loaded{ game::LoadTextureCache(cachePath, "AssetTests.png") };
+            REQUIRE(loaded != nullptr);
+            REQUIRE(loaded->GetFormat() == format);
+            REQUIRE(loaded->MipLevelCount() == texture->MipLevelCount());
+            requireSameColors(*encoded, *loaded);
+        }
+        std::filesystem::remove(cachePath);
+    }
+}
@@ -1,6 +1,11 @@
 #include <testpch.h>
 #include <MathHelpers.h>
 #include <Mesh/Mesh.h>
+#include <Mesh/MeshCache.h>
+#include <Mesh/MeshStreamer.h>
+#include <Mesh/ObjParser.h>
+#include <Mesh/Simplifier.h>
+#include <Mesh/Terrain.h>
 
 TEST_CASE("Translation transformation", "[math][matrix][transformation]")
 {
@@ -68,4 +73,461 @@ TEST_CASE("Rotation transformation", "[math][matrix][transformation]")
 //         printf("Clipped vertex: %f, %f, %f\n", static_cast<float>(vertex.x),static_cast<float>(vertex.y),static_cast<float>(vertex.z));
 //     }
 //     REQUIRE(clippedPolygon.Vertices.at(0).x == FixedUnit{ 2 });
-// }
\ No newline at end of file
+// }
+
+TEST_CASE("Bounding sphere merging", "[math][bounds]")
+{
+    game::BoundingSphere const a{ Eigen::Vector3f{ 0.0f, 0.0f, 0.0f }, 1.0f };
+    game::BoundingSphere const b{ Eigen::Vector3f{ 4.0f, 0.0f, 0.0f }, 1.0f };
+    auto const merged{ game::MergeBoundingSpheres(a, b) };
+    REQUIRE(merged.Radius == 3.0f);
+    REQUIRE(merged.Center.isApprox(Eigen::Vector3f{ 2.0f, 0.0f, 0.0f }));
+
+    // A sphere already containing the other is returned unchanged
+    game::BoundingSphere const inner{ Eigen::Vector3f{ 0.5f, 0.0f, 0.0f }, 0.25f };
+    REQUIRE(game::MergeBoundingSpheres(a, inner).Radius == 1.0f);
+    REQUIRE(game::MergeBoundingSpheres(inner, a).Radius == 1.0f);
+}
+
+TEST_CASE("Mesh bounds", "[math][bounds]")
+{
+    auto const cube{ Mesh::Cube() };
+    REQUIRE(cube->Bounds.Min.isApprox(Eigen::Vector3f{ -0.5f, -0.5f, -0.5f }));
+    REQUIRE(cube->Bounds.Max.isApprox(Eigen::Vector3f{ 0.5f, 0.5f, 0.5f }));
+    REQUIRE(cube->Bounds.Sphere.Center.isZero());
+    REQUIRE(game::AreEqual(cube->Bounds.Sphere.Radius, std::sqrt(0.75f)));
+}
+
+namespace
+{
+    // A grid of size x size vertices, one unit apart, with a single raised vertex
+    Mesh HeightfieldWithPeak(size_t size, float peakHeight, size_t peakX = 1, size_t peakZ = 1)
+    {
+        std::vector<Eigen::Vector3f> vertices;
+        std::vector<Eigen::Vector2f> textureCoordinates;
+        for (size_t z{ 0 }; z < size; ++z)
+        {
+            for (size_t x{ 0 }; x < size; ++x)
+            {
+                bool const isPeak{ (x == peakX) && (z == peakZ) };
+                vertices.emplace_back(static_cast<float>(x), isPeak ? peakHeight : 0.0f,
+                    static_cast<float>(z));
+                textureCoordinates.emplace_back(static_cast<float>(x), static_cast<float>(z));
+            }
+        }
+        std::vector<MeshFace> faces;
+        for (size_t z{ 0 }; (z + 1) < size; ++z)
+        {
+            for (size_t x{ 0 }; (x + 1) < size; ++x)
+            {
+                std::array<size_t, 3> const first{ (z * size) + x, ((z + 1) * size) + x,
+                    (z * size) + x + 1 };
+                std::array<size_t, 3> const second{ (z * size) + x + 1, ((z + 1) * size) + x,
+                    ((z + 1) * size) + x + 1 };
+                faces.push_back(MeshFace{ first, first, 0 });
+                faces.push_back(MeshFace{ second, second, 0 });
+            }
+        }
+        auto bounds{ MeshBounds::FromVertices(vertices) };
+        return Mesh{ vertices, textureCoordinates, faces, nullptr, bounds, {}, {}, {} };
+    }
+}
+
+TEST_CASE("Terrain levels of detail", "[math][terrain]")
+{
+    SECTION("Flat terrain needs no skirts")
+    {
+        auto const chunks{ game::BuildTerrainChunks(HeightfieldWithPeak(9, 0.0f), 2) };
+        REQUIRE(chunks.size() == 4);
+        for (auto const& chunk : chunks)
+        {
+            REQUIRE(chunk->Faces.size() == 32);
+            REQUIRE(chunk->LevelsOfDetail.size() == 2);
+            REQUIRE(chunk->LevelsOfDetail.at(0).Simplified->Faces.size() == 8);
+            REQUIRE(chunk->LevelsOfDetail.at(1).Simplified->Faces.size() == 2);
+            REQUIRE(chunk->LevelsOfDetail.at(1).GeometricError == 0.0f);
+        }
+    }
+    SECTION("Coarser levels are never more accurate")
+    {
+        auto const chunks{ game::BuildTerrainChunks(HeightfieldWithPeak(9, 2.0f), 2) };
+        REQUIRE(chunks.size() == 4);
+        auto const& peakChunk{ *chunks.at(0) };
+        REQUIRE(peakChunk.LevelsOfDetail.at(0).GeometricError == 2.0f);
+        REQUIRE(peakChunk.LevelsOfDetail.at(1).GeometricError == 2.0f);
+        // The peak is inside its chunk, so every border is drawn the same at every level
+        for (auto const& chunk : chunks)
+        {
+            REQUIRE(chunk->Faces.size() == 32);
+        }
+        REQUIRE(chunks.at(3)->LevelsOfDetail.at(1).GeometricError == 0.0f);
+    }
+    SECTION("Skirts reach as deep as the crack on their side")
+    {
+        // The peak sits on the border between the first two chunks, off every coarser
+        // level's grid lines
+        auto const chunks{ game::BuildTerrainChunks(HeightfieldWithPeak(9, 2.0f, 4, 1), 2) };
+        REQUIRE(chunks.size() == 4);
+        auto const lowest{ [](Mesh const& mesh)
+            {
+                float lowest{ 0.0f };
+                for (auto const& vertex : mesh.Vertices)
+                {
+                    lowest = std::min(lowest, vertex.y());
+                }
+                return lowest;
+            } };
+        for (size_t i : { 0, 1 })
+        {
+            auto const& chunk{ *chunks.at(i) };
+            // Only the shared border gets a skirt, of two triangles per segment
+            REQUIRE(chunk.Faces.size() == (32 + (4 * 2)));
+            REQUIRE(chunk.LevelsOfDetail.at(0).Simplified->Faces.size() == (8 + (2 * 2)));
+            // At full detail only the neighbour can be off; at coarser levels both can
+            REQUIRE(game::AreEqual(lowest(chunk), -2.1f));
+            REQUIRE(game::AreEqual(lowest(*chunk.LevelsOfDetail.at(0).Simplified), -4.1f));
+            REQUIRE(game::AreEqual(lowest(*chunk.LevelsOfDetail.at(1).Simplified), -4.1f));
+        }
+        for (size_t i : { 2, 3 })
+        {
+            REQUIRE(chunks.at(i)->Faces.size() == 32);
+        }
+    }
+}
+
+namespace
+{
+    // Checks every corner of every face still has the texture coordinate the grid gave it
+    void RequireGridTextureCoordinates(Mesh const& mesh)
+    {
+        for (auto const& face : mesh.Faces)
+        {
+            for (size_t i{ 0 }; i < face.MeshVertexIndices.size(); ++i)
+            {
+                auto const& vertex{ mesh.Vertices.at(face.MeshVertexIndices.at(i)) };
+                auto const& textureCoordinate{ mesh.TextureCoordinates.at(
+                    face.MeshTextureCoordinateIndices.at(i)) };
+                REQUIRE(textureCoordinate == Eigen::Vector2f{ vertex.x(), vertex.z() });
+            }
+        }
+    }
+}
+
+TEST_CASE("Mesh simplification", "[math][simplification]")
+{
+    auto heightfield{ HeightfieldWithPeak(9, 0.0f) };
+    SECTION("Without UV seams")
+    {
+        // Every vertex has the one texture coordinate, shared by all the faces around it
+        REQUIRE(heightfield.TextureCoordinates.size() == heightfield.Vertices.size());
+    }
+    SECTION("With a UV seam down the middle")
+    {
+        // Faces right of x = 4 get their own copies of the texture coordinates along it
+        std::vector<size_t> seamCopies(heightfield.TextureCoordinates.size(), SIZE_MAX);
+        for (auto& face : heightfield.Faces)
+        {
+            bool const isRightOfSeam{ std::ranges::all_of(face.MeshVertexIndices,
+                [&heightfield](size_t index)
+                {
+                    return heightfield.Vertices.at(index).x() >= 4.0f;
+                }) };
+            for (auto& index : face.MeshTextureCoordinateIndices)
+            {
+                if (isRightOfSeam && (heightfield.TextureCoordinates.at(index).x() == 4.0f))
+                {
+                    if (seamCopies.at(index) == SIZE_MAX)
+                    {
+                        seamCopies.at(index) = heightfield.TextureCoordinates.size();
+                        heightfield.TextureCoordinates.push_back(
+                            heightfield.TextureCoordinates.at(index));
+                    }
+                    index = seamCopies.at(index);
+                }
+            }
+        }
+    }
+
+    auto const levels{ game::SimplifyMesh(heightfield) };
+    REQUIRE(!levels.empty());
+    auto previousFaceCount{ heightfield.Faces.size() };
+    for (auto const& level : levels)
+    {
+        auto const& mesh{ *level.Simplified };
+        REQUIRE(mesh.Faces.size() < previousFaceCount);
+        previousFaceCount = mesh.Faces.size();
+        // Collapsing edges of a flat grid never moves the surface
+        REQUIRE(level.GeometricError == 0.0f);
+        REQUIRE(mesh.Bounds.Min.isApprox(Eigen::Vector3f{ 0.0f, 0.0f, 0.0f }));
+        REQUIRE(mesh.Bounds.Max.isApprox(Eigen::Vector3f{ 8.0f, 0.0f, 8.0f }));
+        RequireGridTextureCoordinates(mesh);
+    }
+}
+
+TEST_CASE("Meshes without texture coordinates are not simplified", "[math][simplification]")
+{
+    auto heightfield{ HeightfieldWithPeak(9, 0.0f) };
+    SECTION("None at all, as read from a file without any")
+    {
+        heightfield.TextureCoordinates.clear();
+        for (auto& face : heightfield.Faces)
+        {
+            face.MeshTextureCoordinateIndices = { 0, 0, 0 };
+        }
+    }
+    SECTION("Some faces refer to ones that don't exist")
+    {
+        heightfield.TextureCoordinates.resize(heightfield.TextureCoordinates.size() / 2);
+    }
+    REQUIRE(game::SimplifyMesh(heightfield).empty());
+}
+
+TEST_CASE("Mesh packing", "[math][packing]")
+{
+    auto const heightfield{ HeightfieldWithPeak(9, 2.0f) };
+    auto const requirePackedFaces{ [&heightfield](game::PackedMesh const& packed, float tolerance)
+        {
+            auto const& indices{ std::get<std::span<uint16_t const>>(packed.Indices) };
+            REQUIRE(indices.size() == (heightfield.Faces.size() * 3));
+            for (size_t i{ 0 }; i < indices.size(); ++i)
+            {
+                auto const& face{ heightfield.Faces.at(i / 3) };
+                Eigen::Vector3f const position{ heightfield.Vertices.at(
+                    face.MeshVertexIndices.at(i % 3)) };
+                auto const vertex{ std::visit([&indices, i](auto const& vertices)
+                    {
+                        std::array<float, game::PackedMesh::c_vertexStride> components;
+                        for (size_t j{ 0 }; j < components.size(); ++j)
+                        {
+                            components.at(j) = static_cast<float>(vertices[
+                                (indices[i] * game::PackedMesh::c_vertexStride) + j]);
+                        }
+                        return components;
+                    }, packed.Vertices) };
+                for (size_t j{ 0 }; j < 3; ++j)
+                {
+                    float const dequantized{ packed.Offset.at(j) +
+                        (packed.Scale.at(j) * vertex.at(j)) };
+                    REQUIRE(std::abs(dequantized - position(j)) <= tolerance);
+                }
+            }
+        } };
+
+    SECTION("Full precision")
+    {
+        auto const packed{ game::PackedMesh::FromMesh(heightfield, false) };
+        REQUIRE(packed.VertexCount() == heightfield.Vertices.size());
+        REQUIRE(packed.TriangleCount() == heightfield.Faces.size());
+        REQUIRE(std::holds_alternative<std::span<float const>>(packed.Vertices));
+        requirePackedFaces(packed, 0.0f);
+    }
+    SECTION("Quantized")
+    {
+        auto const packed{ game::PackedMesh::FromMesh(heightfield, true) };
+        REQUIRE(packed.VertexCount() == heightfield.Vertices.size());
+        REQUIRE(std::holds_alternative<std::span<uint16_t const>>(packed.Vertices));
+        // Each component is off by at most half a quantization step
+        requirePackedFaces(packed, 8.0f / 65535.0f);
+        REQUIRE(packed.MemoryUsage() <
+            game::PackedMesh::FromMesh(heightfield, false).MemoryUsage());
+    }
+}
+
+TEST_CASE("Mesh cache", "[math][packing]")
+{
+    auto mesh{ std::make_shared<Mesh>(HeightfieldWithPeak(9, 2.0f)) };
+    mesh->LevelsOfDetail.push_back(MeshLevelOfDetail{
+        std::make_shared<Mesh>(HeightfieldWithPeak(5, 2.0f)), 0.5f });
+    mesh->Pack(true);
+    auto const cachePath{ std::filesystem::temp_directory_path() / "MathTests.meshcache" };
+    REQUIRE(game::WriteMeshCache(cachePath, std::array{ mesh }));
+
+    auto const requireSamePacking{ [](game::PackedMesh const& expected,
+        game::PackedMesh const& actual)
+        {
+            auto const& expectedVertices{ std::get<std::span<uint16_t const>>(expected.Vertices) };
+            auto const& actualVertices{ std::get<std::span<uint16_t const>>(actual.Vertices) };
+            REQUIRE(std::ranges::equal(expectedVertices, actualVertices));
+            auto const& expectedIndices{ std::get<std::span<uint16_t const>>(expected.Indices) };
+            auto const& actualIndices{ std::get<std::span<uint16_t const>>(actual.Indices) };
+            REQUIRE(std::ranges::equal(expectedIndices, actualIndices));
+            REQUIRE(expected.Offset == actual.Offset);
+            REQUIRE(expected.Scale == actual.Scale);
+        } };
+    {
+        auto const meshes{ game::LoadMeshCache(cachePath, "MathTests.obj", nullptr) };
+        REQUIRE(meshes.has_value());
+        REQUIRE(meshes->size() == 1);
+        auto const& loaded{ *meshes->front() };
+        requireSamePacking(mesh->Packed, loaded.Packed);
+        REQUIRE(loaded.Bounds.Min == mesh->Bounds.Min);
+        REQUIRE(loaded.Bounds.Max == mesh->Bounds.Max);
+        REQUIRE(loaded.LevelsOfDetail.size() == 1);
+        REQUIRE(loaded.LevelsOfDetail.front().GeometricError == 0.5f);
+        requireSamePacking(mesh->LevelsOfDetail.front().Simplified->Packed,
+            loaded.LevelsOfDetail.front().Simplified->Packed);
+    }
+    std::filesystem::remove(cachePath);
+}
+
+TEST_CASE("Damaged mesh caches are rejected", "[math][packing]")
+{
+    auto mesh{ std::make_shared<Mesh>(HeightfieldWithPeak(9, 2.0f)) };
+    mesh->Pack(false);
+    auto const cachePath{ std::filesystem::temp_directory_path() / "MathTests.damaged.meshcache" };
+    REQUIRE(game::WriteMeshCache(cachePath, std::array{ mesh }));
+    std::vector<char> cache(std::filesystem::file_size(cachePath));
+    {
+        std::ifstream file{ cachePath, std::ios::binary };
+        file.read(cache.data(), static_cast<std::streamsize>(cache.size()));
+    }
+    auto const loadDamaged{ [&cachePath](std::vector<char> const& damaged)
+        {
+            {
+                std::ofstream file{ cachePath, std::ios::binary | std::ios::trunc };
+                file.write(damaged.data(), static_cast<std::streamsize>(damaged.size()));
+            }
+            return game::LoadMeshCache(cachePath, "MathTests.obj", nullptr);
+        } };
+
+    SECTION("Mesh count larger than the file")
+    {
+        auto damaged{ cache };
+        // The mesh count follows the magic and the version
+        uint32_t const meshCount{ UINT32_MAX };
+        std::memcpy(damaged.data() + 8, &meshCount, sizeof(meshCount));
+        REQUIRE(!loadDamaged(damaged).has_value());
+    }
+    SECTION("Index past the last vertex")
+    {
+        auto const& indices{ std::get<std::span<uint16_t const>>(mesh->Packed.Indices) };
+        auto const indexBytes{ std::as_bytes(indices) };
+        auto const found{ std::ranges::search(cache, indexBytes, {}, {},
+            [](std::byte byte) { return static_cast<char>(byte); }) };
+        REQUIRE(!found.empty());
+        auto damaged{ cache };
+        uint16_t const index{ static_cast<uint16_t>(mesh->Packed.VertexCount()) };
+        std::memcpy(damaged.data() + std::distance(cache.begin(), found.begin()), &index,
+            sizeof(index));
+        REQUIRE(!loadDamaged(damaged).has_value());
+    }
+    std::filesystem::remove(cachePath);
+}
+
+TEST_CASE("Mesh streaming", "[math][packing]")
+{
+    auto mesh{ std::make_shared<Mesh>(HeightfieldWithPeak(9, 2.0f)) };
+    mesh->LevelsOfDetail.push_back(MeshLevelOfDetail{
+        std::make_shared<Mesh>(HeightfieldWithPeak(5, 2.0f)), 0.5f });
+    mesh->Pack(true);
+    auto const cachePath{ std::filesystem::temp_directory_path() / "MathTests.stream.meshcache" };
+    REQUIRE(game::WriteMeshCache(cachePath, std::array{ mesh }));
+    {
+        auto const loaded{ game::LoadMeshCache(cachePath, "MathTests.obj", nullptr).value() };
+        auto const* const fine{ loaded.front().get() };
+        auto const* const coarse{ fine->LevelsOfDetail.front().Simplified.get() };
+        auto const fineBytes{ fine->Packed.MemoryUsage() };
+        game::MeshStreamer streamer{ nullptr, fineBytes };
+        streamer.Register(loaded.front());
+        REQUIRE(streamer.GetResidency().StreamedLevelCount == 1);
+        REQUIRE(streamer.GetResidency().PinnedBytes == coarse->Packed.MemoryUsage());
+
+        // Within budget, levels stay resident whether drawn or not
+        REQUIRE(streamer.Request(fine, fine) == fine);
+        streamer.Update();
+        streamer.Update();
+        REQUIRE(streamer.GetResidency().ResidentBytes == fineBytes);
+
+        // Over budget, the level not drawn last frame is evicted, and the coarsest level is
+        // drawn in its place until it has been mapped back in
+        streamer.SetBudget(0);
+        streamer.Update();
+        REQUIRE(fine->Packed.VertexCount() == 0);
+        // Its triangles still count towards what is culled or budgeted
+        REQUIRE(fine->TriangleCount == mesh->Packed.TriangleCount());
+        REQUIRE(streamer.GetResidency().ResidentLevelCount == 0);
+        REQUIRE(streamer.Request(fine, fine) == coarse);
+        REQUIRE(streamer.GetResidency().LoadingLevelCount == 1);
+        streamer.SetBudget(fineBytes);
+        streamer.Update();
+        REQUIRE(streamer.Request(fine, fine) == fine);
+        REQUIRE(fine->Packed.TriangleCount() == mesh->Packed.TriangleCount());
+        REQUIRE(streamer.Request(fine, coarse) == coarse);
+    }
+    std::filesystem::remove(cachePath);
+}
+
+TEST_CASE("OBJ parsing", "[mesh][obj]")
+{
+    SECTION("Quads and n-gons are triangulated as fans")
+    {
+        auto const geometry{ game::ParseObj(
+            "# A quad and a pentagon\n"
+            "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv -1 0.5 0\n"
+            "vt 0 0\nvt 1 0\r\nvt 1 1\nvt 0 1\n"
+            "vn 0 0 1\n"
+            "f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+            "f 1//1 2//1 3//1 4//1 5//1\n",
+            "test", 1) };
+        REQUIRE(geometry.has_value());
+        REQUIRE(geometry->Vertices.size() == 5);
+        REQUIRE(geometry->Vertices.at(4) == Eigen::Vector3f{ -1.0f, 0.5f, 0.0f });
+        REQUIRE(geometry->TextureCoordinates.size() == 4);
+        REQUIRE(geometry->Faces.size() == 5);
+        REQUIRE(geometry->Faces.at(0).MeshVertexIndices == std::array<size_t, 3>{ 0, 1, 2 });
+        REQUIRE(geometry->Faces.at(1).MeshVertexIndices == std::array<size_t, 3>{ 0, 2, 3 });
+        REQUIRE(geometry->Faces.at(1).MeshTextureCoordinateIndices ==
+            std::array<size_t, 3>{ 0, 2, 3 });
+        REQUIRE(geometry->Faces.at(4).MeshVertexIndices == std::array<size_t, 3>{ 0, 3, 4 });
+    }
+    SECTION("Negative indices count back from the last element read")
+    {
+        auto const geometry{ game::ParseObj(
+            "v 0 0 0\nv 1 0 0\nv 1 1 0\nvt 0 0\nvt 1 0\nvt 1 1\n"
+            "f -3/-3 -2/-2 -1/-1\n"
+            "v 0 1 0\n"
+            "f -4 -2 -1\n",
+            "test", 1) };
+        REQUIRE(geometry.has_value());
+        REQUIRE(geometry->Faces.at(0).MeshVertexIndices == std::array<size_t, 3>{ 0, 1, 2 });
+        REQUIRE(geometry->Faces.at(0).MeshTextureCoordinateIndices ==
+            std::array<size_t, 3>{ 0, 1, 2 });
+        REQUIRE(geometry->Faces.at(1).MeshVertexIndices == std::array<size_t, 3>{ 0, 2, 3 });
+    }
+    SECTION("Malformed files are rejected")
+    {
+        REQUIRE_FALSE(game::ParseObj("v 0 0 zero\n", "test", 1).has_value());
+        REQUIRE_FALSE(game::ParseObj("v 0 0 0\nv 1 0 0\nf 1 2\n", "test", 1).has_value());
+        REQUIRE_FALSE(game::ParseObj("v 0 0 0\nv 1 0 0\nf 1 2 3\n", "test", 1).has_value());
+        REQUIRE_FALSE(game::ParseObj("v 0 0 0\nv 1 0 0\nv 1 1 0\nvt 0 0\nf 1/1 2 3\n",
+            "test", 1).has_value());
+    }
+    SECTION("Parsing over several threads gives the same geometry")
+    {
+        std::string text;
+        for (size_t i{ 0 }; i < 1000; ++i)
+        {
+            text += fmt::format("v {} {} 0\nvt 0.5 0.25\n", i, i % 7);
+            if (i >= 3)
+            {
+                text += (i % 2) ? "f -1/-1 -2/-2 -3/-3 -4/-4\n" :
+                    fmt::format("f {} {} {}\n", i - 2, i - 1, i);
+            }
+        }
+        auto const serial{ game::ParseObj(text, "test", 1) };
+        auto const parallel{ game::ParseObj(text, "test", 7) };
+        REQUIRE(serial.has_value());
+        REQUIRE(parallel.has_value());
+        REQUIRE(serial->Vertices == parallel->Vertices);
+        REQUIRE(serial->TextureCoordinates == parallel->TextureCoordinates);
+        REQUIRE(serial->Faces.size() == parallel->Faces.size());
+        for (size_t i{ 0 }; i < serial->Faces.size(); ++i)
+        {
+            REQUIRE(serial->Faces.at(i).MeshVertexIndices ==
+                parallel->Faces.at(i).MeshVertexIndices);
+            REQUIRE(serial->Faces.at(i).MeshTextureCoordinateIndices ==
+                parallel->Faces.at(i).MeshTextureCoordinateIndices);
+            REQUIRE(serial->Faces.at(i).ShadeColor == parallel->Faces.at(i).ShadeColor);
+        }
+    }
+}
@@ -0,0 +1,122 @@
+// Times the OBJ parser against the stream-based parser it replaced, over the bundled assets.
+// Run with `meson test --benchmark` from the build directory.
+#include <pch.h>
+#include <sstream>
+#include <thread>
+#include <Mesh/ObjParser.h>
+
+namespace
+{
+    constexpr int c_runCount{ 20 };
+    constexpr std::array<char const*, 4> c_objFiles{
+        "cube.obj",
+        "f22.obj",
+        "sandylandscape.obj",
+        "bigsandylandscape.obj",
+    };
+
+    // The parser Mesh::FromObjFile used before: a string stream per line, and substring
+    // copies and vectors per face. Only handles triangles.
+    size_t ParseWithStreams(std::string const& text)
+    {
+        std::vector<Eigen::Vector3f> vertices;
+        std::vector<Eigen::Vector2f> textureCoordinates;
+        std::vector<MeshFace> faces;
+        std::istringstream objFile{ text };
+        std::string line;
+        while (std::getline(objFile, line))
+        {
+            std::istringstream iss{ line };
+            std::string prefix;
+            iss >> prefix;
+            if (prefix == "v")
+            {
+                float x, y, z;
+                iss >> x >> y >> z;
+                vertices.emplace_back(x, y, z);
+            }
+            else if (prefix == "vt")
+            {
+                float u, v;
+                iss >> u >> v;
+                textureCoordinates.emplace_back(u, v);
+            }
+            else if (prefix == "f")
+            {
+                std::string faceStr;
+                std::vector<size_t> vertexIndices;
+                std::vector<size_t> textureCoordinateIndices;
+                while (iss >> faceStr)
+                {
+                    auto slashIndex{ faceStr.find_first_of('/') };
+                    vertexIndices.push_back(std::stoi(faceStr.substr(0, slashIndex)) - 1);
+                    if (slashIndex != std::string::npos)
+                    {
+                        textureCoordinateIndices.push_back(
+                            std::stoi(faceStr.substr(slashIndex + 1)) - 1);
+                    }
+                }
+                faces.push_back(MeshFace{
+                    { vertexIndices.at(0), vertexIndices.at(1), vertexIndices.at(2) },
+                    { textureCoordinateIndices.at(0), textureCoordinateIndices.at(1),
+                        textureCoordinateIndices.at(2) }, 0 });
+            }
+        }
+        return faces.size();
+    }
+
+    // Fastest of several runs, in microseconds
+    template<typename F>
+    double TimeRuns(F const& parse)
+    {
+        auto best{ std::chrono::microseconds::max() };
+        for (int i{ 0 }; i < c_runCount; ++i)
+        {
+            auto const start{ std::chrono::steady_clock::now() };
+            parse();
+            best = std::min(best, std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start));
+        }
+        return static_cast<double>(std::max<int64_t>(best.count(), 1));
+    }
+}
+
+int main()
+{
+    spdlog::set_level(spdlog::level::warn);
+    size_t const threadCount{ std::max(std::thread::hardware_concurrency(), 1u) };
+    fmt::print("{:<24}{:>8}{:>16}{:>16}{:>16}{:>10}\n", "File", "KiB", "Streams (us)",
+        "1 thread (us)", fmt::format("{} threads (us)", threadCount), "Speedup");
+    for (auto const* objFile : c_objFiles)
+    {
+        std::ifstream file{ objFile, std::ios::binary };
+        if (!file.is_open())
+        {
+            SPDLOG_ERROR("Could not open '{}'", objFile);
+            return 1;
+        }
+        std::string const text{ std::istreambuf_iterator<char>{ file },
+            std::istreambuf_iterator<char>{} };
+        size_t streamFaceCount{ 0 };
+        size_t faceCount{ 0 };
+        auto const streamTime{ TimeRuns([&]() { streamFaceCount = ParseWithStreams(text); }) };
+        auto const serialTime{ TimeRuns([&]()
+            {
+                faceCount = game::ParseObj(text, objFile, 1).value().Faces.size();
+            }) };
+        auto const parallelTime{ TimeRuns([&]()
+            {
+                game::ParseObj(text, objFile, threadCount);
+            }) };
+        if (faceCount != streamFaceCount)
+        {
+            SPDLOG_ERROR("'{}' parsed into {} faces, expected {}", objFile, faceCount,
+                streamFaceCount);
+            return 1;
+        }
+        fmt::print("{:<24}{:>8}{:>16.0f}{:>16.0f}{:>16.0f}{:>9.1f}x\n", objFile,
+            text.size() / 1024, streamTime, serialTime, parallelTime,
+            streamTime / std::min(serialTime, parallelTime));
+    }
+    return 0;
+}
@@ -0,0 +1,461 @@
+#include <testpch.h>
+#include <Renderer/DrawList.h>
+#include <Renderer/RasterCoverage.h>
+#include <Renderer/RenderTarget.h>
+#include <Renderer/TileRasterizer.h>
+
+namespace
+{
+    // Small deterministic generator so failures are reproducible
+    int32_t NextValue(uint32_t& state, int32_t range)
+    {
+        state = (state * 1664525u) + 1013904223u;
+        return static_cast<int32_t>(state >> 8) % range - (range / 2);
+    }
+
+    // A texture with a different colour in every texel, so any texel sampled differently
+    // shows in the pixels drawn
+    std::shared_ptr<PngTexture> GradientTexture()
+    {
+        uint16_t const size{ 16 };
+        auto pixels{ std::make_shared<std::vector<uint32_t>>(size * size) };
+        for (uint32_t i{ 0 }; i < pixels->size(); ++i)
+        {
+            pixels->at(i) = 0xFF000000 | ((i % size) << 20) | ((i / size) << 4);
+        }
+        std::span<uint32_t const> const pixelSpan{ *pixels };
+        return PngTexture::FromPixels(size, size, pixelSpan, std::move(pixels));
+    }
+
+    // Counter-clockwise triangles at random depths, scattered over and a little past a
+    // target of the given size, and large enough to cross several 64 pixel tiles
+    std::vector<game::RasterTriangle> RandomTriangles(size_t count, uint16_t width,
+        uint16_t height, PngTexture* texture)
+    {
+        uint32_t state{ 4321 };
+        std::vector<game::RasterTriangle> triangles(count);
+        for (auto& triangle : triangles)
+        {
+            Eigen::Vector2f const center{
+                static_cast<float>(NextValue(state, width + 40) + (width / 2)),
+                static_cast<float>(NextValue(state, height + 40) + (height / 2)) };
+            float const w{ 1.0f + (static_cast<float>(NextValue(state, 1000) + 500) / 100.0f) };
+            for (size_t i{ 0 }; i < 3; ++i)
+            {
+                triangle.Vertices.at(i) = Eigen::Vector4f{
+                    center.x() + (static_cast<float>(NextValue(state, 16000)) / 100.0f),
+                    center.y() + (static_cast<float>(NextValue(state, 16000)) / 100.0f),
+                    0.0f, w + (static_cast<float>(i) * 0.5f) };
+                triangle.TextureCoordinates.at(i) = Eigen::Vector2f{
+                    static_cast<float>(NextValue(state, 400)) / 100.0f,
+                    static_cast<float>(NextValue(state, 400)) / 100.0f };
+            }
+            auto const& vertices{ triangle.Vertices };
+            Eigen::Vector2f const ab{ (vertices.at(1) - vertices.at(0)).head<2>() };
+            Eigen::Vector2f const ac{ (vertices.at(2) - vertices.at(0)).head<2>() };
+            if (((ab.y() * ac.x()) - (ab.x() * ac.y())) < 0.0f)
+            {
+                std::swap(triangle.Vertices.at(1), triangle.Vertices.at(2));
+                std::swap(triangle.TextureCoordinates.at(1), triangle.TextureCoordinates.at(2));
+            }
+            triangle.Texture = texture;
+        }
+        return triangles;
+    }
+
+    void DrawTriangle(game::RenderTarget& target, game::RasterTriangle const& triangle,
+        game::ScreenRect const& clipRect, game::PipelineState const& state = {})
+    {
+        auto const& [vertices, textureCoordinates, texture, visibilityId]{ triangle };
+        target.DrawTexturedTriangle(vertices.at(0), vertices.at(1), vertices.at(2),
+            textureCoordinates.at(0), textureCoordinates.at(1), textureCoordinates.at(2),
+            texture, clipRect, state);
+    }
+
+    template<typename T>
+    size_t CountDifferences(std::vector<T> const& a, std::vector<T> const& b)
+    {
+        size_t count{ 0 };
+        for (size_t i{ 0 }; i < std::min(a.size(), b.size()); ++i)
+        {
+            count += (a.at(i) != b.at(i)) ? 1 : 0;
+        }
+        return count + std::max(a.size(), b.size()) - std::min(a.size(), b.size());
+    }
+}
+
+TEST_CASE("Scalar coverage honors edge signs", "[renderer][coverage]")
+{
+    // Edge 0 crosses zero between pixel 2 and 3, the others are always inside
+    game::EdgeValues start{ 2, 100, 0 };
+    game::EdgeValues step{ -1, 0, 0 };
+    REQUIRE(game::CoverageScalar(start, step, 8) == 0b0000'0111u);
+    // A value of exactly zero counts as covered
+    REQUIRE(game::CoverageScalar(game::EdgeValues{ 0, 0, 0 }, step, 1) == 0b1u);
+    REQUIRE(game::CoverageScalar(game::EdgeValues{ 5, -1, 5 }, game::EdgeValues{ 0, 0, 0 }, 4) == 0u);
+}
+
+#ifdef GAME_HAS_X86_COVERAGE
+TEST_CASE("SIMD coverage matches scalar coverage", "[renderer][coverage]")
+{
+    uint32_t state{ 1234 };
+    for (int i{ 0 }; i < 10000; ++i)
+    {
+        game::EdgeValues start{ NextValue(state, 1 << 16), NextValue(state, 1 << 16),
+            NextValue(state, 1 << 16) };
+        game::EdgeValues step{ NextValue(state, 1 << 12), NextValue(state, 1 << 12),
+            NextValue(state, 1 << 12) };
+        int32_t count{ 1 + ((i * 7) % game::c_maxCoverageSpan) };
+        uint32_t expected{ game::CoverageScalar(start, step, count) };
+        if (SDL_HasSSE41())
+        {
+            REQUIRE(game::CoverageSse41(start, step, count) == expected);
+        }
+        if (SDL_HasAVX2())
+        {
+            REQUIRE(game::CoverageAvx2(start, step, count) == expected);
+        }
+    }
+}
+#endif
+
+TEST_CASE("Tile-binned rasterization matches drawing triangles one at a time",
+    "[renderer][tiles]")
+{
+    // Not a multiple of the tile size, so the tiles along the far edges are partial
+    uint16_t const width{ 200 };
+    uint16_t const height{ 150 };
+    auto const texture{ GradientTexture() };
+    auto const triangles{ RandomTriangles(200, width, height, texture.get()) };
+    // Outlines too, since a line cut into tiles must land on the same pixels as a whole one
+    game::PipelineState const state{ .IsWireframe = true };
+
+    game::RenderTarget immediate{ width, height };
+    immediate.ClearBuffers();
+    for (auto const& triangle : triangles)
+    {
+        DrawTriangle(immediate, triangle, immediate.Bounds(), state);
+    }
+
+    game::RenderTarget tiled{ width, height };
+    tiled.ClearBuffers();
+    game::ThreadPool threadPool{ 3 };
+    game::TileRasterizer rasterizer{ &tiled, &threadPool };
+    for (auto const& triangle : triangles)
+    {
+        rasterizer.Submit(triangle);
+    }
+    rasterizer.Flush([&tiled, &state](game::RasterTriangle const& triangle,
+        game::ScreenRect const& tileRect)
+        {
+            DrawTriangle(tiled, triangle, tileRect, state);
+        });
+
+    REQUIRE(immediate.Statistics().PixelsWritten > (width * height));
+    REQUIRE(CountDifferences(tiled.Buffer, immediate.Buffer) == 0);
+    REQUIRE(CountDifferences(tiled.ZBuffer, immediate.ZBuffer) == 0);
+}
+
+TEST_CASE("Visibility buffer rendering matches forward rendering", "[renderer][visibility]")
+{
+    uint16_t const width{ 200 };
+    uint16_t const height{ 150 };
+    auto texture{ GradientTexture() };
+    SECTION("Single level texture") { }
+    SECTION("Mipmapped texture")
+    {
+        texture = texture->WithMipmaps();
+    }
+    auto triangles{ RandomTriangles(200, width, height, texture.get()) };
+    // Some untextured ones too, which are filled rather than sampled
+    for (size_t i{ 0 }; i < triangles.size(); i += 4)
+    {
+        triangles.at(i).Texture = nullptr;
+    }
+
+    game::RenderTarget forward{ width, height };
+    forward.ClearBuffers();
+    for (auto const& triangle : triangles)
+    {
+        DrawTriangle(forward, triangle, forward.Bounds());
+    }
+
+    game::RenderTarget deferred{ width, height };
+    deferred.ClearBuffers();
+    deferred.BeginVisibilityPass();
+    for (auto const& [vertices, textureCoordinates, triangleTexture, visibilityId] : triangles)
+    {
+        auto const triangleId{ deferred.DeferTexturedTriangle(vertices.at(0), vertices.at(1),
+            vertices.at(2), textureCoordinates.at(0), textureCoordinates.at(1),
+            textureCoordinates.at(2), triangleTexture) };
+        deferred.DrawTriangleVisibility(vertices.at(0), vertices.at(1), vertices.at(2),
+            triangleId, deferred.Bounds());
+    }
+    // Resolved in two row ranges, as the renderer splits the resolve between threads
+    deferred.ResolveVisibility(0, (height / 3) - 1);
+    deferred.ResolveVisibility(height / 3, height - 1);
+    deferred.EndVisibilityPass();
+
+    REQUIRE(CountDifferences(deferred.Buffer, forward.Buffer) == 0);
+    REQUIRE(CountDifferences(deferred.ZBuffer, forward.ZBuffer) == 0);
+}
+
+TEST_CASE("Draw list orders triangles front to back", "[renderer][drawlist]")
+{
+    auto const triangleAtDepth{ [](float w, uint32_t id)
+        {
+            game::RasterTriangle triangle{};
+            for (auto& vertex : triangle.Vertices)
+            {
+                vertex = Eigen::Vector4f{ 0.0f, 0.0f, 0.0f, w };
+            }
+            triangle.VisibilityId = id;
+            return triangle;
+        } };
+    game::DrawList drawList{ 0.1f };
+    drawList.Add(triangleAtDepth(50.0f, 0));
+    drawList.Add(triangleAtDepth(0.5f, 1));
+    drawList.Add(triangleAtDepth(10.0f, 2));
+    drawList.Add(triangleAtDepth(0.5f, 3));
+    auto const& sorted{ drawList.Sort() };
+    REQUIRE(sorted.size() == 4);
+    // Triangles at the same depth keep the order they were added in
+    REQUIRE(sorted.at(0).VisibilityId == 1);
+    REQUIRE(sorted.at(1).VisibilityId == 3);
+    REQUIRE(sorted.at(2).VisibilityId == 2);
+    REQUIRE(sorted.at(3).VisibilityId == 0);
+}
+
+TEST_CASE("Texturing samples the mip level matching the texel density", "[renderer][mipmap]")
+{
+    // Red at full size, blue at every smaller level, so the colour drawn shows the level
+    uint16_t const size{ 16 };
+    auto const mipLevelCount{ PngTexture::FullMipLevelCount(size, size) };
+    auto const pixels{ std::make_shared<std::vector<uint32_t>>(
+        PngTexture::StorageSize(size, size, PngTexture::Layout::Linear, mipLevelCount),
+        0xFF0000FF) };
+    std::fill_n(pixels->begin(), size * size, 0xFFFF0000);
+    auto const texture{ PngTexture::FromPixels(size, size, *pixels, pixels,
+        PngTexture::Layout::Linear, mipLevelCount) };
+
+    game::RenderTarget target{ 128, 128 };
+    auto const drawTexture{ [&](float screenSize)
+        {
+            target.ClearBuffers();
+            target.DrawTexturedTriangle(Eigen::Vector4f{ 0.0f, 0.0f, 0.0f, 1.0f },
+                Eigen::Vector4f{ 0.0f, screenSize, 0.0f, 1.0f },
+                Eigen::Vector4f{ screenSize, 0.0f, 0.0f, 1.0f }, Eigen::Vector2f{ 0.0f, 0.0f },
+                Eigen::Vector2f{ 0.0f, 1.0f }, Eigen::Vector2f{ 1.0f, 0.0f }, texture.get());
+            auto const inside{ static_cast<uint16_t>(screenSize / 4.0f) };
+            return target.PixelAt(inside, inside);
+        } };
+    // Magnified, and shrunk to a quarter of a texel per pixel
+    REQUIRE(drawTexture(64.0f) == 0xFFFF0000);
+    REQUIRE(drawTexture(4.0f) == 0xFF0000FF);
+}
+
+TEST_CASE("Pipeline state switches depth testing and texture wrapping", "[renderer][pipeline]")
+{
+    game::RenderTarget target{ 64, 64 };
+    std::array<Eigen::Vector4f, 3> const vertices{ Eigen::Vector4f{ 0.0f, 0.0f, 0.0f, 1.0f },
+        Eigen::Vector4f{ 0.0f, 64.0f, 0.0f, 1.0f }, Eigen::Vector4f{ 64.0f, 0.0f, 0.0f, 1.0f } };
+
+    SECTION("Depth")
+    {
+        // A far triangle drawn over a near one only shows without the depth test
+        auto const drawFarOverNear{ [&](game::PipelineState const& state)
+            {
+                target.ClearBuffers();
+                target.DrawShadedTriangle(vertices.at(0), vertices.at(1), vertices.at(2),
+                    0xFFFF0000);
+                std::array<Eigen::Vector4f, 3> far{ vertices };
+                for (auto& vertex : far)
+                {
+                    vertex.w() = 4.0f;
+                }
+                target.DrawShadedTriangle(far.at(0), far.at(1), far.at(2), 0xFF0000FF,
+                    target.Bounds(), state);
+                return target.PixelAt(8, 8);
+            } };
+        REQUIRE(drawFarOverNear(game::PipelineState{}) == 0xFFFF0000);
+        REQUIRE(drawFarOverNear(game::PipelineState{ .IsDepthTested = false }) == 0xFF0000FF);
+    }
+
+    SECTION("Wrap")
+    {
+        // Red on the left, blue on the right, sampled left of its edge
+        std::array<uint32_t, 4> const pixels{ 0xFFFF0000, 0xFF0000FF, 0xFFFF0000, 0xFF0000FF };
+        auto const texture{ PngTexture::FromPixels(2, 2, pixels, nullptr) };
+        auto const drawOutside{ [&](game::PipelineState::WrapMode wrap)
+            {
+                target.ClearBuffers();
+                Eigen::Vector2f const outside{ -0.25f, 0.5f };
+                target.DrawTexturedTriangle(vertices.at(0), vertices.at(1), vertices.at(2),
+                    outside, outside, outside, texture.get(), target.Bounds(),
+                    game::PipelineState{ .Wrap = wrap });
+                return target.PixelAt(8, 8);
+            } };
+        REQUIRE(drawOutside(game::PipelineState::WrapMode::Repeat) == 0xFF0000FF);
+        REQUIRE(drawOutside(game::PipelineState::WrapMode::Clamp) == 0xFFFF0000);
+    }
+
+    SECTION("Wrap without power of two sides")
+    {
+        // Three columns, so wrapping can't mask and takes the fraction instead
+        std::array<uint32_t, 9> pixels{};
+        for (uint32_t i{ 0 }; i < pixels.size(); ++i)
+        {
+            pixels.at(i) = 0xFF000000 | i;
+        }
+        auto const texture{ PngTexture::FromPixels(3, 3, pixels, nullptr) };
+        auto const drawAt{ [&](Eigen::Vector2f const& coordinates,
+            game::PipelineState::WrapMode wrap)
+            {
+                target.ClearBuffers();
+                target.DrawTexturedTriangle(vertices.at(0), vertices.at(1), vertices.at(2),
+                    coordinates, coordinates, coordinates, texture.get(), target.Bounds(),
+                    game::PipelineState{ .Wrap = wrap });
+                return target.PixelAt(8, 8);
+            } };
+        auto const repeat{ game::PipelineState::WrapMode::Repeat };
+        REQUIRE(drawAt(Eigen::Vector2f{ -0.25f, 0.5f }, repeat) == 0xFF000005);
+        REQUIRE(drawAt(Eigen::Vector2f{ 1.5f, 0.5f }, repeat) == 0xFF000004);
+        REQUIRE(drawAt(Eigen::Vector2f{ 3.1f, -1.5f }, repeat) == 0xFF000003);
+        REQUIRE(drawAt(Eigen::Vector2f{ -0.25f, 0.5f }, game::PipelineState::WrapMode::Clamp) ==
+            0xFF000003);
+    }
+
+    SECTION("Depth without writing")
+    {
+        // A near triangle that leaves depth alone shows, but hides nothing drawn after it,
+        // while what is drawn after it still hides what is behind that
+        auto const atDepth{ [&](float w)
+            {
+                std::array<Eigen::Vector4f, 3> moved{ vertices };
+                for (auto& vertex : moved)
+                {
+                    vertex.w() = w;
+                }
+                return moved;
+            } };
+        target.ClearBuffers();
+        auto const near{ atDepth(1.0f) };
+        target.DrawShadedTriangle(near.at(0), near.at(1), near.at(2), 0xFFFF0000,
+            target.Bounds(), game::PipelineState{ .IsDepthWritten = false });
+        REQUIRE(target.PixelAt(8, 8) == 0xFFFF0000);
+        auto const middle{ atDepth(2.0f) };
+        target.DrawShadedTriangle(middle.at(0), middle.at(1), middle.at(2), 0xFF00FF00);
+        REQUIRE(target.PixelAt(8, 8) == 0xFF00FF00);
+        auto const far{ atDepth(4.0f) };
+        target.DrawShadedTriangle(far.at(0), far.at(1), far.at(2), 0xFF0000FF);
+        for (uint16_t i{ 0 }; i < 32; ++i)
+        {
+            REQUIRE(target.PixelAt(i, i) == 0xFF00FF00);
+        }
+    }
+
+    SECTION("Flat fill")
+    {
+        // Untextured triangles fill every pixel they cover with their colour and leave the
+        // rest alone
+        target.ClearBuffers();
+        target.ClearPixelBuffer(0xFF000000);
+        target.DrawShadedTriangle(vertices.at(0), vertices.at(1), vertices.at(2), 0xFF123456);
+        size_t filled{ 0 };
+        for (uint16_t y{ 0 }; y < 64; ++y)
+        {
+            for (uint16_t x{ 0 }; x < 64; ++x)
+            {
+                auto const pixel{ target.PixelAt(x, y) };
+                REQUIRE(((pixel == 0xFF123456) || (pixel == 0xFF000000)));
+                filled += (pixel == 0xFF123456) ? 1 : 0;
+            }
+        }
+        // Every pixel whose centre is below the diagonal x + y = 64, or on it, as the
+        // triangle owns that edge
+        REQUIRE(filled == (64 * 65) / 2);
+        REQUIRE(target.PixelAt(8, 8) == 0xFF123456);
+        REQUIRE(target.PixelAt(56, 56) == 0xFF000000);
+    }
+}
+
+TEST_CASE("Triangles reaching far past the target are covered exactly", "[renderer][coverage]")
+{
+    // Edges span about 2^17 pixels, whose products don't fit 32 bits, and the long edge runs
+    // along the target's diagonal x + y = 64
+    game::RenderTarget target{ 64, 64 };
+    target.ClearBuffers();
+    float const far{ 100000.0f };
+    target.DrawShadedTriangle(Eigen::Vector4f{ -far, -far, 0.0f, 1.0f },
+        Eigen::Vector4f{ -far, far + 64.0f, 0.0f, 1.0f },
+        Eigen::Vector4f{ far + 64.0f, -far, 0.0f, 1.0f }, 0xFFFF0000);
+    size_t wrongPixelCount{ 0 };
+    for (uint16_t y{ 0 }; y < 64; ++y)
+    {
+        for (uint16_t x{ 0 }; x < 64; ++x)
+        {
+            // Pixel centres on the long edge itself are left to the fill rule
+            bool const isInside{ (x + y + 1) < 64 };
+            bool const isOutside{ (x + y + 1) > 64 };
+            bool const isDrawn{ target.PixelAt(x, y) == 0xFFFF0000 };
+            wrongPixelCount += ((isInside && !isDrawn) || (isOutside && isDrawn)) ? 1 : 0;
+        }
+    }
+    REQUIRE(wrongPixelCount == 0);
+}
+
+TEST_CASE("Lines reaching far past the target draw their part on it", "[renderer][lines]")
+{
+    game::RenderTarget target{ 64, 64 };
+    target.ClearBuffers();
+    target.DrawLine(Eigen::Vector2f{ -100000.0f, 10.0f }, Eigen::Vector2f{ 100000.0f, 10.0f },
+        0xFFFF0000);
+    // Steep, and only crossing the target's lower right corner
+    target.DrawLine(Eigen::Vector2f{ 50.0f, 100000.0f }, Eigen::Vector2f{ 60.0f, 50.0f },
+        0xFF0000FF);
+    size_t rowPixelCount{ 0 };
+    for (uint16_t x{ 0 }; x < 64; ++x)
+    {
+        rowPixelCount += (target.PixelAt(x, 10) == 0xFFFF0000) ? 1 : 0;
+    }
+    REQUIRE(rowPixelCount == 64);
+    REQUIRE(target.PixelAt(60, 50) == 0xFF0000FF);
+    REQUIRE(target.PixelAt(60, 63) == 0xFF0000FF);
+}
+
+TEST_CASE("Lines cut into tiles land on the same pixels as whole lines", "[renderer][lines]")
+{
+    // Long enough lines that stepping from a tile's edge rather than the line's start would
+    // round some steps onto neighbouring pixels
+    uint16_t const width{ 640 };
+    uint16_t const height{ 360 };
+    uint16_t const tileSize{ 64 };
+    game::RenderTarget whole{ width, height };
+    game::RenderTarget tiled{ width, height };
+    whole.ClearBuffers();
+    tiled.ClearBuffers();
+    uint32_t state{ 1234 };
+    for (size_t i{ 0 }; i < 2000; ++i)
+    {
+        std::array<Eigen::Vector2f, 2> ends{};
+        for (auto& end : ends)
+        {
+            end = Eigen::Vector2f{
+                static_cast<float>(NextValue(state, width * 100) + (width * 50)) / 100.0f,
+                static_cast<float>(NextValue(state, height * 100) + (height * 50)) / 100.0f };
+        }
+        whole.DrawLine(ends.at(0), ends.at(1), 0xFF00FF00);
+        for (uint16_t tileY{ 0 }; tileY < height; tileY += tileSize)
+        {
+            for (uint16_t tileX{ 0 }; tileX < width; tileX += tileSize)
+            {
+                tiled.DrawLine(ends.at(0), ends.at(1), 0xFF00FF00, game::ScreenRect{ tileX,
+                    tileY, std::min(static_cast<uint16_t>(tileX + tileSize - 1),
+                        static_cast<uint16_t>(width - 1)),
+                    std::min(static_cast<uint16_t>(tileY + tileSize - 1),
+                        static_cast<uint16_t>(height - 1)) });
+            }
+        }
+    }
+    REQUIRE(CountDifferences(tiled.Buffer, whole.Buffer) == 0);
+}
@@ -0,0 +1,270 @@
+// Times texturing the landscape with its texture stored linearly and tiled, in each texel
+// format, from a few views at player height, and counts the cache misses each causes where
+// the OS allows it.
+// Run with `meson test --benchmark` from the build directory.
+#include <pch.h>
+#include <Mesh/Mesh.h>
+#include <Renderer/RenderTarget.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr int c_runCount{ 10 };
+    constexpr uint16_t c_width{ 1280 };
+    constexpr uint16_t c_height{ 720 };
+    constexpr float c_fieldOfView{ 3.14159265f / 2.0f };
+    constexpr float c_nearPlane{ 0.1f };
+    constexpr float c_farPlane{ 100.0f };
+    // The landscape texture, at 900x900, already outgrows L2 but fits in the last-level
+    // cache of many CPUs, so it is also sampled scaled up to about the size of a detailed
+    // terrain texture, which fits in neither
+    constexpr uint16_t c_largeTextureExtent{ 4096 };
+
+    struct Triangle
+    {
+        std::array<Eigen::Vector4f, 3> Vertices;
+        std::array<Eigen::Vector2f, 3> TextureCoordinates;
+    };
+
+    // Hardware cache miss counter for the calling thread, reading zero where unavailable
+    struct CacheMissCounter
+    {
+        enum class Cache
+        {
+            Level1Data,
+            LastLevel,
+        };
+
+        explicit CacheMissCounter(Cache cache)
+        {
+#ifdef __linux__
+            perf_event_attr attributes{};
+            attributes.type = PERF_TYPE_HW_CACHE;
+            attributes.size = sizeof(attributes);
+            attributes.config = ((cache == Cache::Level1Data) ? PERF_COUNT_HW_CACHE_L1D :
+                PERF_COUNT_HW_CACHE_LL) | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            m_descriptor = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1,
+                0));
+#else
+            static_cast<void>(cache);
+#endif
+        }
+
+        ~CacheMissCounter()
+        {
+#ifdef __linux__
+            if (m_descriptor >= 0)
+            {
+                close(m_descriptor);
+            }
+#endif
+        }
+
+        bool IsAvailable() const
+        {
+            return m_descriptor >= 0;
+        }
+
+        void Start()
+        {
+#ifdef __linux__
+            if (IsAvailable())
+            {
+                ioctl(m_descriptor, PERF_EVENT_IOC_RESET, 0);
+                ioctl(m_descriptor, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        uint64_t Stop()
+        {
+            uint64_t count{ 0 };
+#ifdef __linux__
+            if (IsAvailable())
+            {
+                ioctl(m_descriptor, PERF_EVENT_IOC_DISABLE, 0);
+                if (read(m_descriptor, &count, sizeof(count)) != sizeof(count))
+                {
+                    count = 0;
+                }
+            }
+#endif
+            return count;
+        }
+
+    private:
+        int m_descriptor{ -1 };
+    };
+
+    // Projects the landscape's faces as seen from a view, in the front to back order the
+    // renderer draws them in. Faces reaching behind the near plane or far off screen are
+    // dropped rather than clipped, which the comparison doesn't need.
+    std::vector<Triangle> ProjectFaces(Mesh const& mesh, Eigen::Matrix4f const& viewProjection)
+    {
+        std::vector<Triangle> triangles;
+        for (auto const& face : mesh.Faces)
+        {
+            Triangle triangle;
+            bool isDrawn{ true };
+            for (size_t i{ 0 }; i < 3; ++i)
+            {
+                Eigen::Vector4f vertex{ viewProjection *
+                    mesh.Vertices.at(face.MeshVertexIndices.at(i)).homogeneous() };
+                isDrawn = isDrawn && (vertex.w() > c_nearPlane) &&
+                    (std::abs(vertex.x()) < (2.0f * vertex.w())) &&
+                    (std::abs(vertex.y()) < (2.0f * vertex.w()));
+                vertex.x() = ((vertex.x() / vertex.w()) + 1.0f) * (c_width / 2.0f);
+                vertex.y() = ((vertex.y() / vertex.w()) + 1.0f) * (c_height / 2.0f);
+                triangle.Vertices.at(i) = vertex;
+                triangle.TextureCoordinates.at(i) =
+                    mesh.TextureCoordinates.at(face.MeshTextureCoordinateIndices.at(i));
+            }
+            if (isDrawn)
+            {
+                triangles.push_back(triangle);
+            }
+        }
+        auto const nearestW{ [](Triangle const& triangle)
+            {
+                return std::min({ triangle.Vertices.at(0).w(), triangle.Vertices.at(1).w(),
+                    triangle.Vertices.at(2).w() });
+            } };
+        std::ranges::sort(triangles, {}, nearestW);
+        return triangles;
+    }
+
+    std::shared_ptr<PngTexture> Upscale(PngTexture& texture, uint16_t factor)
+    {
+        uint16_t const width{ static_cast<uint16_t>(texture.Width() * factor) };
+        uint16_t const height{ static_cast<uint16_t>(texture.Height() * factor) };
+        auto pixels{ std::make_shared<std::vector<uint32_t>>(size_t{ width } * height) };
+        for (uint16_t y{ 0 }; y < height; ++y)
+        {
+            for (uint16_t x{ 0 }; x < width; ++x)
+            {
+                pixels->at((size_t{ y } * width) + x) = texture.ColorAt(x / factor, y / factor);
+            }
+        }
+        std::span<uint32_t const> const pixelSpan{ *pixels };
+        return PngTexture::FromPixels(width, height, pixelSpan, std::move(pixels));
+    }
+
+    struct Measurement
+    {
+        // Fastest of several runs over every view, in microseconds
+        double Time;
+        uint64_t PixelsWritten;
+        uint64_t L1Misses;
+        uint64_t LastLevelMisses;
+    };
+
+    Measurement DrawViews(std::vector<std::vector<Triangle>> const& views, PngTexture* texture,
+        CacheMissCounter& l1Misses, CacheMissCounter& lastLevelMisses)
+    {
+        game::RenderTarget target{ c_width, c_height };
+        Measurement best{ std::numeric_limits<double>::max(), 0, 0, 0 };
+        for (int run{ 0 }; run < c_runCount; ++run)
+        {
+            Measurement measurement{ 0.0, 0, 0, 0 };
+            for (auto const& triangles : views)
+            {
+                target.ClearBuffers();
+                target.ResetStatistics();
+                l1Misses.Start();
+                lastLevelMisses.Start();
+                auto const start{ std::chrono::steady_clock::now() };
+                for (auto const& [vertices, textureCoordinates] : triangles)
+                {
+                    target.DrawTexturedTriangle(vertices.at(0), vertices.at(1), vertices.at(2),
+                        textureCoordinates.at(0), textureCoordinates.at(1),
+                        textureCoordinates.at(2), texture);
+                }
+                measurement.Time += std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start).count();
+                measurement.LastLevelMisses += lastLevelMisses.Stop();
+                measurement.L1Misses += l1Misses.Stop();
+                measurement.PixelsWritten += target.Statistics().PixelsWritten;
+            }
+            if (measurement.Time < best.Time)
+            {
+                best = measurement;
+            }
+        }
+        return best;
+    }
+}
+
+int main()
+{
+    spdlog::set_level(spdlog::level::warn);
+    auto const mesh{ Mesh::FromObjFile("bigsandylandscape.obj", std::nullopt) };
+    auto const texture{ PngTexture::FromPngFile("bigsandylandscape.png") };
+    if (!mesh)
+    {
+        SPDLOG_ERROR("Could not load 'bigsandylandscape.obj'");
+        return 1;
+    }
+
+    // Look out over the landscape in each direction from just above its middle, tilted
+    // down a little, as the player sees it
+    Eigen::Matrix4f const projection{ game::PerspectiveProjectionTransformMatrix(
+        c_fieldOfView, (static_cast<float>(c_height) / c_width), c_nearPlane, c_farPlane) };
+    Eigen::Vector3f const eye{ mesh->Bounds.Sphere.Center.x(), mesh->Bounds.Max.y() + 1.0f,
+        mesh->Bounds.Sphere.Center.z() };
+    std::vector<std::vector<Triangle>> views;
+    for (int direction{ 0 }; direction < 4; ++direction)
+    {
+        float const angle{ (static_cast<float>(direction) * c_fieldOfView) + 0.3f };
+        Eigen::Vector3f const target{ eye + Eigen::Vector3f{ std::sin(angle), -0.4f,
+            std::cos(angle) } };
+        views.push_back(ProjectFaces(*mesh, projection *
+            game::LookAt(eye, target, Eigen::Vector3f{ 0.0f, 1.0f, 0.0f })));
+    }
+
+    CacheMissCounter l1Misses{ CacheMissCounter::Cache::Level1Data };
+    CacheMissCounter lastLevelMisses{ CacheMissCounter::Cache::LastLevel };
+    if (!l1Misses.IsAvailable() || !lastLevelMisses.IsAvailable())
+    {
+        fmt::print("Cache miss counters are unavailable here; only timing is measured\n");
+    }
+    fmt::print("{:<16}{:>8}{:>12}{:>10}{:>12}{:>14}{:>16}{:>16}\n", "Texture", "Layout",
+        "Format", "KiB", "Time (us)", "Mpixels/s", "L1D miss/pixel", "LLC miss/pixel");
+    constexpr std::array<std::pair<PngTexture::Format, char const*>, 3> formats{
+        std::pair{ PngTexture::Format::Argb, "argb" },
+        std::pair{ PngTexture::Format::Palettized, "palette" },
+        std::pair{ PngTexture::Format::Bc1, "bc1" },
+    };
+    auto const upscaled{ Upscale(*texture, static_cast<uint16_t>(std::max(1,
+        c_largeTextureExtent / std::max(texture->Width(), texture->Height())))) };
+    for (auto const& [name, linear] : { std::pair{ fmt::format("{}x{}", texture->Width(),
+        texture->Height()), texture }, std::pair{ fmt::format("{}x{}", upscaled->Width(),
+        upscaled->Height()), upscaled } })
+    {
+        for (auto const layout : { PngTexture::Layout::Linear, PngTexture::Layout::Tiled })
+        {
+            for (auto const& [format, formatName] : formats)
+            {
+                auto const laidOut{ linear->WithLayout(layout)->WithFormat(format) };
+                auto const measurement{ DrawViews(views, laidOut.get(), l1Misses,
+                    lastLevelMisses) };
+                auto const pixels{ static_cast<double>(std::max<uint64_t>(
+                    measurement.PixelsWritten, 1)) };
+                fmt::print("{:<16}{:>8}{:>12}{:>10}{:>12.0f}{:>14.1f}{:>16.3f}{:>16.4f}\n", name,
+                    (layout == PngTexture::Layout::Linear) ? "linear" : "tiled", formatName,
+                    laidOut->Pixels().size_bytes() / 1024, measurement.Time,
+                    pixels / measurement.Time, measurement.L1Misses / pixels,
+                    measurement.LastLevelMisses / pixels);
+            }
+        }
+    }
+    return 0;
+}